@@ -0,0 +1,615 @@
+// Microbenchmarks for the MultiLibrary buffer and stream classes used on the
+// xconsole hot path. Only depends on the sources in /source, no Garry's Mod
+// or Source SDK headers, so it builds and runs on any box.
+//
+// usage: xconsole_bench [filter]
+//   filter  only run benchmarks whose name contains this string
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <ByteBuffer.hpp>
+#include <Compression.hpp>
+#include <Patterns.hpp>
+#include <SegmentedBuffer.hpp>
+#include <Varint.hpp>
+#include <xconsole/Client.hpp>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+static std::atomic<uint64_t> allocationCount(0);
+
+// Every form of operator new and delete is replaced, so whatever the
+// compiler pairs up always ends up in malloc and free.
+static void* Allocate(std::size_t size) noexcept
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size != 0 ? size : 1);
+}
+
+static void* AllocateOrThrow(std::size_t size)
+{
+	if (void* ptr = Allocate(size))
+		return ptr;
+
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size)
+{
+	return AllocateOrThrow(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return AllocateOrThrow(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	std::free(ptr);
+}
+
+static volatile uint64_t sink = 0;
+
+static void Consume(uint64_t value)
+{
+	sink = sink + value;
+}
+
+struct Record
+{
+	int32_t id;
+	int32_t severity;
+	std::string name;
+	int32_t color;
+	std::string message;
+};
+
+static Record MakeRecord(size_t messageSize)
+{
+	Record record;
+	record.id = 3;
+	record.severity = 0;
+	record.name = "Console";
+	record.color = static_cast<int32_t>(0xFFFFFFFF);
+	record.message.reserve(messageSize);
+	for (size_t i = 0; i + 1 < messageSize; ++i)
+		record.message += static_cast<char>('a' + i % 26);
+
+	record.message += '\n';
+	return record;
+}
+
+static const char* benchFilter = nullptr;
+
+// Runs fn in growing batches until at least 200ms have elapsed, then
+// reports time, throughput and heap allocations per call. Returns the time
+// per call in nanoseconds, 0 when filtered out.
+template<typename Function>
+static double Run(const std::string& name, size_t bytesPerOp, Function fn)
+{
+	if (benchFilter != nullptr && name.find(benchFilter) == std::string::npos)
+		return 0;
+
+	fn(); // warm up caches and any reused buffers
+
+	uint64_t iterations = 0;
+	uint64_t batch = 16;
+	uint64_t allocations = allocationCount.load(std::memory_order_relaxed);
+	auto start = std::chrono::steady_clock::now();
+	std::chrono::nanoseconds elapsed(0);
+	while (elapsed < std::chrono::milliseconds(200))
+	{
+		for (uint64_t i = 0; i < batch; ++i)
+			fn();
+
+		iterations += batch;
+		batch *= 2;
+		elapsed = std::chrono::steady_clock::now() - start;
+	}
+
+	allocations = allocationCount.load(std::memory_order_relaxed) - allocations;
+
+	double nsPerOp = static_cast<double>(elapsed.count()) / iterations;
+	double mbPerSec = bytesPerOp != 0 ? bytesPerOp / nsPerOp * 1e9 / (1024.0 * 1024.0) : 0.0;
+	std::printf("%-44s %12.1f ns/op %10.1f MB/s %8.2f allocs/op\n",
+		name.c_str(), nsPerOp, mbPerSec, static_cast<double>(allocations) / iterations);
+	return nsPerOp;
+}
+
+static size_t EncodeFixed(MultiLibrary::ByteBuffer& buffer, const Record& record)
+{
+	buffer <<
+		record.id <<
+		record.severity <<
+		record.name.c_str() <<
+		record.color <<
+		record.message.c_str() <<
+		"<EOL>";
+
+	return static_cast<size_t>(buffer.Size());
+}
+
+static size_t EncodeCompact(MultiLibrary::ByteBuffer& buffer, const Record& record)
+{
+	buffer.WriteZigZag(record.id);
+	buffer.WriteVarint(static_cast<uint32_t>(record.severity));
+	buffer << record.name.c_str();
+	buffer.WriteVarint(static_cast<uint32_t>(record.color));
+	buffer.WriteVarint(record.message.size());
+	buffer.Write(record.message.data(), record.message.size());
+	return static_cast<size_t>(buffer.Size());
+}
+
+static void BenchEncode(const Record& record)
+{
+	const std::string suffix = "/" + std::to_string(record.message.size());
+
+	MultiLibrary::ByteBuffer sample;
+	size_t fixedSize = EncodeFixed(sample, record);
+
+	// what XConsoleListener::Log did before the segmented buffer: a fresh,
+	// reserved buffer per record with the message copied in
+	Run("encode/fixed/fresh" + suffix, fixedSize, [&]() {
+		MultiLibrary::ByteBuffer buffer;
+		buffer.Reserve(12 + record.name.size() + record.message.size() + 4);
+		Consume(EncodeFixed(buffer, record));
+	});
+
+	MultiLibrary::ByteBuffer reused;
+	Run("encode/fixed/reused" + suffix, fixedSize, [&]() {
+		reused.Clear();
+		Consume(EncodeFixed(reused, record));
+	});
+
+	MultiLibrary::SegmentedBuffer segmented;
+	Run("encode/segmented" + suffix, fixedSize, [&]() {
+		segmented.Clear();
+		segmented << record.id << record.severity << record.name.c_str() << record.color;
+		segmented.Reference(record.message.c_str(), record.message.size() + 1);
+		segmented << "<EOL>";
+
+#ifndef _WIN32
+		iovec vectors[4];
+		Consume(segmented.GetIOVectors(vectors, 4) + vectors[0].iov_len);
+#else
+		Consume(segmented.SegmentCount());
+#endif
+	});
+
+	MultiLibrary::ByteBuffer compact;
+	size_t compactSize = EncodeCompact(compact, record);
+	Run("encode/compact/reused" + suffix, compactSize, [&]() {
+		compact.Clear();
+		Consume(EncodeCompact(compact, record));
+	});
+}
+
+static void BenchDecode(const Record& record)
+{
+	const std::string suffix = "/" + std::to_string(record.message.size());
+
+	MultiLibrary::ByteBuffer fixed;
+	size_t fixedSize = EncodeFixed(fixed, record);
+	Run("decode/fixed" + suffix, fixedSize, [&]() {
+		fixed.Seek(0);
+		int32_t id = 0, severity = 0, color = 0;
+		std::string name, message;
+		fixed >> id >> severity >> name >> color >> message;
+		Consume(id + message.size());
+	});
+
+	MultiLibrary::ByteBuffer compact;
+	size_t compactSize = EncodeCompact(compact, record);
+	Run("decode/compact" + suffix, compactSize, [&]() {
+		compact.Seek(0);
+		int64_t id = 0;
+		uint64_t severity = 0, color = 0, length = 0;
+		std::string name, message;
+		compact.ReadZigZag(id);
+		compact.ReadVarint(severity);
+		compact >> name;
+		compact.ReadVarint(color);
+		compact.ReadVarint(length);
+		message.resize(static_cast<size_t>(length));
+		if (length != 0)
+			compact.Read(&message[0], message.size());
+
+		Consume(id + message.size());
+	});
+}
+
+static void BenchStringExtraction()
+{
+	for (size_t size : {8, 64, 512, 4096})
+	{
+		MultiLibrary::ByteBuffer buffer;
+		buffer << std::string(size, 'x');
+		Run("string/extract/" + std::to_string(size), size, [&]() {
+			buffer.Seek(0);
+			std::string value;
+			buffer >> value;
+			Consume(value.size());
+		});
+	}
+}
+
+static void BenchCapacity()
+{
+	const size_t size = 1024;
+	const uint8_t chunk[32] = { 0 };
+
+	Run("capacity/grow-by-write/1024", size, [&]() {
+		MultiLibrary::ByteBuffer buffer;
+		for (size_t written = 0; written < size; written += sizeof(chunk))
+			buffer.Write(chunk, sizeof(chunk));
+
+		Consume(buffer.Capacity());
+	});
+
+	Run("capacity/reserve-then-write/1024", size, [&]() {
+		MultiLibrary::ByteBuffer buffer;
+		buffer.Reserve(size);
+		for (size_t written = 0; written < size; written += sizeof(chunk))
+			buffer.Write(chunk, sizeof(chunk));
+
+		Consume(buffer.Capacity());
+	});
+
+	Run("capacity/resize/1024", size, [&]() {
+		MultiLibrary::ByteBuffer buffer;
+		buffer.Resize(size);
+		Consume(buffer.Capacity());
+	});
+
+	Run("capacity/reserve-shrink-to-fit/1024", size, [&]() {
+		MultiLibrary::ByteBuffer buffer;
+		buffer.Reserve(size * 4);
+		buffer.Write(chunk, sizeof(chunk));
+		buffer.ShrinkToFit();
+		Consume(buffer.Capacity());
+	});
+}
+
+static bool BenchIntegers()
+{
+	// typical record header values: small channel ids, severities and a
+	// mix of small and full-width colours
+	std::mt19937_64 random(1234);
+	std::vector<int64_t> values(4096);
+	for (size_t i = 0; i < values.size(); ++i)
+		values[i] = (i % 4 == 3) ? static_cast<int64_t>(random()) : static_cast<int64_t>(random() % 64) - 8;
+
+	MultiLibrary::ByteBuffer fixed;
+	for (int64_t value : values)
+		fixed << value;
+
+	MultiLibrary::ByteBuffer varint;
+	for (int64_t value : values)
+		varint.WriteZigZag(value);
+
+	// round trip before timing anything, a fast wrong decoder is worthless
+	varint.Seek(0);
+	for (int64_t value : values)
+	{
+		int64_t decoded = 0;
+		if (varint.ReadZigZag(decoded) == 0 || decoded != value)
+		{
+			std::printf("varint round trip failed for %lld\n", static_cast<long long>(value));
+			return false;
+		}
+	}
+
+	const size_t count = values.size();
+	Run("int/encode/fixed/x4096", count * sizeof(int64_t), [&]() {
+		fixed.Clear();
+		for (int64_t value : values)
+			fixed << value;
+
+		Consume(static_cast<uint64_t>(fixed.Size()));
+	});
+
+	Run("int/encode/zigzag/x4096", static_cast<size_t>(varint.Size()), [&]() {
+		varint.Clear();
+		for (int64_t value : values)
+			varint.WriteZigZag(value);
+
+		Consume(static_cast<uint64_t>(varint.Size()));
+	});
+
+	Run("int/decode/fixed/x4096", count * sizeof(int64_t), [&]() {
+		fixed.Seek(0);
+		uint64_t total = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			int64_t value = 0;
+			fixed >> value;
+			total += static_cast<uint64_t>(value);
+		}
+
+		Consume(total);
+	});
+
+	Run("int/decode/zigzag/x4096", static_cast<size_t>(varint.Size()), [&]() {
+		varint.Seek(0);
+		uint64_t total = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			int64_t value = 0;
+			varint.ReadZigZag(value);
+			total += static_cast<uint64_t>(value);
+		}
+
+		Consume(total);
+	});
+
+	std::printf("%-44s %12zu bytes fixed %8zu bytes zigzag\n", "int/size/x4096",
+		count * sizeof(int64_t), static_cast<size_t>(varint.Size()));
+	return true;
+}
+
+// Console-like batch of framed records: repetitive status and connection
+// lines with changing numbers, like what a busy server logs.
+static std::vector<uint8_t> MakeConsoleBatch(size_t records)
+{
+	static const char* templates[] = {
+		"# %u \"Player%u\" STEAM_0:1:%u %02u:%02u %u %u active\n",
+		"Client \"Player%u\" connected (10.0.%u.%u:27005).\n",
+		"[ERROR] lua/autorun/server/init.lua:%u: attempt to index a nil value (field '%u')\n",
+		"Dropped Player%u from server (Disconnect by user. %u %u)\n"
+	};
+
+	std::mt19937 random(42);
+	MultiLibrary::ByteBuffer batch;
+	for (size_t i = 0; i < records; ++i)
+	{
+		char message[256];
+		std::snprintf(message, sizeof(message), templates[random() % 4], random() % 64, random() % 256, random() % 100000000,
+			random() % 60, random() % 60, random() % 200, random() % 10);
+
+		batch << static_cast<int32_t>(random() % 8) << static_cast<int32_t>(0) << "Console" << static_cast<int32_t>(0xFFFFFFFF) << message << "<EOL>";
+	}
+
+	const uint8_t* data = batch.GetBuffer();
+	return std::vector<uint8_t>(data, data + batch.Size());
+}
+
+static bool BenchCompression()
+{
+	for (size_t records : {1, 16, 64})
+	{
+		std::vector<uint8_t> input = MakeConsoleBatch(records);
+		std::vector<uint8_t> compressed(xconsole::compression::Bound(input.size()));
+		std::vector<uint8_t> output(input.size());
+		size_t compressedSize = xconsole::compression::Compress(input.data(), input.size(), compressed.data());
+		if (!xconsole::compression::Decompress(compressed.data(), compressedSize, output.data(), output.size()) || output != input)
+		{
+			std::printf("compression round trip failed for %zu records\n", records);
+			return false;
+		}
+
+		const std::string suffix = "/x" + std::to_string(records);
+		Run("compress/lz" + suffix, input.size(), [&]() {
+			Consume(xconsole::compression::Compress(input.data(), input.size(), compressed.data()));
+		});
+
+		Run("decompress/lz" + suffix, input.size(), [&]() {
+			Consume(xconsole::compression::Decompress(compressed.data(), compressedSize, output.data(), output.size()));
+		});
+
+		std::printf("%-44s %12zu bytes raw %10zu bytes lz %8.2f ratio\n", ("compress/size" + suffix).c_str(),
+			input.size(), compressedSize, static_cast<double>(input.size()) / compressedSize);
+	}
+
+	return true;
+}
+
+// Scanning a console line for N SteamIDs spread over 8 filters, once with
+// the shared automaton and once pattern by pattern.
+static void BenchPatterns()
+{
+	const std::string line = "[ERROR] Player42 STEAM_0:1:48151623 lua/autorun/server/init.lua:120: attempt to index a nil value\n";
+	for (size_t count : {1, 50, 500})
+	{
+		std::vector<std::string> steamIds;
+		xconsole::patterns::Automaton automaton;
+		for (size_t k = 0; k < count; ++k)
+		{
+			steamIds.push_back("STEAM_0:" + std::to_string(k % 2) + ":" + std::to_string(10000000 + k * 7919));
+			automaton.Add({steamIds.back(), xconsole::patterns::ANCHOR_NONE}, k % 8);
+		}
+
+		automaton.Build();
+
+		const std::string suffix = "/x" + std::to_string(count);
+		Run("match/automaton" + suffix, line.size(), [&]() {
+			Consume(automaton.Match(line.data(), line.size()));
+		});
+
+		Run("match/strstr" + suffix, line.size(), [&]() {
+			uint64_t found = 0;
+			for (size_t k = 0; k < steamIds.size(); ++k)
+				if (std::strstr(line.c_str(), steamIds[k].c_str()) != nullptr)
+					found |= uint64_t(1) << (k % 8);
+
+			Consume(found);
+		});
+	}
+}
+
+// Decodes a stream of records with the client library the way a collector
+// reading the pipe would: 64 KB reads, batches of 256 records.
+static size_t DecodeStream(xconsole::client::Decoder& decoder, const std::vector<uint8_t>& stream)
+{
+	static xconsole::client::Record records[256];
+	size_t decoded = 0;
+	for (size_t offset = 0; offset < stream.size(); )
+	{
+		size_t room;
+		char* target = decoder.Prepare(room);
+		size_t size = std::min<size_t>({room, stream.size() - offset, 65536});
+		std::memcpy(target, stream.data() + offset, size);
+		decoder.Commit(size);
+		offset += size;
+		for (size_t count; (count = decoder.Decode(records, 256)) != 0; )
+			for (size_t k = 0; k < count; ++k)
+				decoded += records[k].message.size();
+	}
+
+	return decoded;
+}
+
+static bool BenchClient()
+{
+	const size_t count = 4096;
+	const std::vector<uint8_t> legacy = MakeConsoleBatch(count);
+	const char* data = reinterpret_cast<const char*>(legacy.data());
+	const char* end = data + legacy.size();
+
+	Run("client/find/simd", legacy.size(), [&]() {
+		size_t found = 0;
+		for (const char* position = data; (position = xconsole::client::FindTerminator(position, end)) != end; position += xconsole::client::TERMINATOR_SIZE)
+			++found;
+
+		Consume(found);
+	});
+
+	Run("client/find/search", legacy.size(), [&]() {
+		size_t found = 0;
+		for (const char* position = data; (position = std::search(position, end, xconsole::client::TERMINATOR, xconsole::client::TERMINATOR + xconsole::client::TERMINATOR_SIZE)) != end; position += xconsole::client::TERMINATOR_SIZE)
+			++found;
+
+		Consume(found);
+	});
+
+	// the same records in format 4 (sequence, tick, timestamp and an empty
+	// span list in front of each), and in compressed blocks of 64 records
+	std::vector<uint8_t> format4;
+	std::vector<uint8_t> compressed;
+	std::vector<uint8_t> block;
+	uint8_t varint[MultiLibrary::Varint::MaxSize];
+	size_t records = 0;
+	for (const char* record = data; record != end; ++records)
+	{
+		const char* next = xconsole::client::FindTerminator(record, end) + xconsole::client::TERMINATOR_SIZE;
+		format4.insert(format4.end(), varint, varint + MultiLibrary::Varint::Encode(records + 1, varint));
+		format4.insert(format4.end(), varint, varint + MultiLibrary::Varint::Encode(records / 4, varint));
+		format4.insert(format4.end(), varint, varint + MultiLibrary::Varint::Encode(1000000000ULL + records * 15000, varint));
+		format4.push_back(0);
+		format4.insert(format4.end(), record, next);
+
+		block.insert(block.end(), record, next);
+		if ((records + 1) % 64 == 0 || next == end)
+		{
+			std::vector<uint8_t> payload(xconsole::compression::Bound(block.size()));
+			payload.resize(xconsole::compression::Compress(block.data(), block.size(), payload.data()));
+			compressed.insert(compressed.end(), varint, varint + MultiLibrary::Varint::Encode(block.size(), varint));
+			compressed.insert(compressed.end(), varint, varint + MultiLibrary::Varint::Encode(payload.size(), varint));
+			compressed.insert(compressed.end(), payload.begin(), payload.end());
+			block.clear();
+		}
+
+		record = next;
+	}
+
+	// a compress on reply switches the decoder over to blocks
+	MultiLibrary::ByteBuffer reply;
+	reply << static_cast<int32_t>(xconsole::client::CONTROL_CHANNEL) << static_cast<int32_t>(0) << "xconsole" << static_cast<int32_t>(0) << "compress on\n" << "<EOL>";
+	compressed.insert(compressed.begin(), reply.GetBuffer(), reply.GetBuffer() + reply.Size());
+
+	struct Case
+	{
+		const char* name;
+		const std::vector<uint8_t>& stream;
+		int format;
+	};
+
+	for (const Case& test : {Case{"format1", legacy, 1}, Case{"format4", format4, 4}, Case{"compressed", compressed, 1}})
+	{
+		xconsole::client::Decoder check(test.format);
+		if (DecodeStream(check, test.stream) == 0 || check.GetMalformed() != 0)
+		{
+			std::printf("client failed to decode the %s stream\n", test.name);
+			return false;
+		}
+
+		const std::string name = std::string("client/decode/") + test.name + "/x" + std::to_string(records);
+		double nanoseconds = Run(name, test.stream.size(), [&]() {
+			xconsole::client::Decoder decoder(test.format);
+			Consume(DecodeStream(decoder, test.stream));
+		});
+
+		if (nanoseconds != 0)
+			std::printf("%-44s %12.2f M records/s\n", name.c_str(), records / nanoseconds * 1e3);
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		benchFilter = argv[1];
+
+	if (!BenchIntegers())
+		return EXIT_FAILURE;
+
+	for (size_t size : {16, 80, 256, 1024, 4096, 16384})
+	{
+		Record record = MakeRecord(size);
+		BenchEncode(record);
+		BenchDecode(record);
+	}
+
+	BenchStringExtraction();
+	BenchCapacity();
+	BenchPatterns();
+	return BenchCompression() && BenchClient() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,803 @@
+#pragma once
+
+// Header-only decoder for what xconsole writes on its output pipe and what
+// xconsole_aggregator serves, for consoles and collectors. Records are
+// decoded in batches straight out of the buffer the stream is read into,
+// as views that point into it, and follow the stream through format and
+// compression changes like the module makes them.
+//
+//	xconsole::client::Decoder decoder;
+//	xconsole::client::Record records[256];
+//	while (decoder.Read(pipe) > 0)
+//		for (size_t count; (count = decoder.Decode(records, 256)) != 0; )
+//			for (size_t k = 0; k < count; ++k)
+//				Handle(records[k]);
+//
+// Only depends on the standard library, C++17.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define XCONSOLE_CLIENT_SSE2
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define XCONSOLE_CLIENT_AVX2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifndef _WIN32
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace xconsole
+{
+
+namespace client
+{
+
+// Channels the module sends records of its own on.
+static const int32_t CONTROL_CHANNEL = -1;  // replies, "xconsole"
+static const int32_t TICK_CHANNEL = -2;     // tick telemetry, "xconsole_tick"
+static const int32_t SAMPLING_CHANNEL = -3; // sampling summaries, "xconsole_sampling"
+static const int32_t EVENT_CHANNEL = -4;    // events from xconsole.Emit
+static const int32_t CVAR_CHANNEL = -5;     // values of watched convars
+
+static const int FORMAT_MIN = 1;
+static const int FORMAT_MAX = 5;
+
+// Terminator of every record on POSIX pipes, including its NUL.
+static const char TERMINATOR[] = "<EOL>";
+static const size_t TERMINATOR_SIZE = sizeof(TERMINATOR);
+
+// Longest varint, 64 bits in groups of 7.
+static const size_t VARINT_MAX_SIZE = 10;
+
+// Decodes a LEB128 varint. Returns its size, 0 when data ends before it
+// does, or VARINT_MAX_SIZE + 1 when it is longer than any valid one.
+inline size_t ReadVarint(const char* data, const char* end, uint64_t& value)
+{
+	value = 0;
+	for (size_t k = 0; k < VARINT_MAX_SIZE; ++k)
+	{
+		if (data + k == end)
+			return 0;
+
+		const uint8_t byte = static_cast<uint8_t>(data[k]);
+		value |= static_cast<uint64_t>(byte & 0x7F) << (7 * k);
+		if ((byte & 0x80) == 0)
+			return k + 1;
+	}
+
+	return VARINT_MAX_SIZE + 1;
+}
+
+inline unsigned CountTrailingZeros(uint32_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return static_cast<unsigned>(index);
+#else
+	return static_cast<unsigned>(__builtin_ctz(value));
+#endif
+}
+
+// Finds the first terminator in [data, end), or returns end. Compares the
+// first and last byte of the terminator (the '<' and its NUL) at 16 or 32
+// positions at once and only checks the rest where both match, which text
+// almost never does.
+inline const char* FindTerminator(const char* data, const char* end)
+{
+	const size_t last = TERMINATOR_SIZE - 1;
+#ifdef XCONSOLE_CLIENT_AVX2
+	const __m256i first32 = _mm256_set1_epi8('<');
+	const __m256i zero32 = _mm256_setzero_si256();
+	for (; end - data >= static_cast<ptrdiff_t>(32 + last); data += 32)
+	{
+		__m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+		__m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + last));
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(head, first32), _mm256_cmpeq_epi8(tail, zero32))));
+		for (; mask != 0; mask &= mask - 1)
+		{
+			const char* candidate = data + CountTrailingZeros(mask);
+			if (std::memcmp(candidate + 1, TERMINATOR + 1, last - 1) == 0)
+				return candidate;
+		}
+	}
+#endif
+#ifdef XCONSOLE_CLIENT_SSE2
+	const __m128i first16 = _mm_set1_epi8('<');
+	const __m128i zero16 = _mm_setzero_si128();
+	for (; end - data >= static_cast<ptrdiff_t>(16 + last); data += 16)
+	{
+		__m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+		__m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + last));
+		uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first16), _mm_cmpeq_epi8(tail, zero16))));
+		for (; mask != 0; mask &= mask - 1)
+		{
+			const char* candidate = data + CountTrailingZeros(mask);
+			if (std::memcmp(candidate + 1, TERMINATOR + 1, last - 1) == 0)
+				return candidate;
+		}
+	}
+#endif
+	while (end - data >= static_cast<ptrdiff_t>(TERMINATOR_SIZE))
+	{
+		const char* candidate = static_cast<const char*>(std::memchr(data, '<', static_cast<size_t>(end - data) - last));
+		if (candidate == nullptr)
+			break;
+
+		if (std::memcmp(candidate, TERMINATOR, TERMINATOR_SIZE) == 0)
+			return candidate;
+
+		data = candidate + 1;
+	}
+
+	return end;
+}
+
+// Decompresses an LZ4 block into exactly outputSize bytes, false when it is
+// malformed. Same as xconsole::compression::Decompress in the module.
+inline bool Decompress(const uint8_t* input, size_t size, uint8_t* output, size_t outputSize)
+{
+	const uint8_t* end = input + size;
+	uint8_t* out = output;
+	uint8_t* outputEnd = output + outputSize;
+	auto readLength = [&input, end](size_t& length) {
+		uint8_t byte;
+		do
+		{
+			if (input == end)
+				return false;
+
+			byte = *input++;
+			length += byte;
+		}
+		while (byte == 255);
+
+		return true;
+	};
+
+	while (input != end)
+	{
+		uint8_t token = *input++;
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !readLength(literalLength))
+			return false;
+
+		if (literalLength > static_cast<size_t>(end - input) || literalLength > static_cast<size_t>(outputEnd - out))
+			return false;
+
+		if (literalLength != 0)
+			std::memcpy(out, input, literalLength);
+
+		input += literalLength;
+		out += literalLength;
+		if (input == end)
+			break;
+
+		if (end - input < 2)
+			return false;
+
+		size_t offset = input[0] | static_cast<size_t>(input[1]) << 8;
+		input += 2;
+		if (offset == 0 || offset > static_cast<size_t>(out - output))
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !readLength(matchLength))
+			return false;
+
+		matchLength += 4;
+		if (matchLength > static_cast<size_t>(outputEnd - out))
+			return false;
+
+		const uint8_t* match = out - offset;
+		if (offset >= matchLength)
+			std::memcpy(out, match, matchLength);
+		else
+			for (size_t k = 0; k < matchLength; ++k)
+				out[k] = match[k];
+
+		out += matchLength;
+	}
+
+	return out == outputEnd;
+}
+
+// Run of bytes of a message printed in one colour.
+struct Span
+{
+	uint32_t length;
+	int32_t color;
+};
+
+// Reads the colour runs of a record, see Record::spans.
+class SpanReader
+{
+public:
+	explicit SpanReader(std::string_view spans) :
+		data(spans.data()),
+		end(spans.data() + spans.size()),
+		remaining(0)
+	{
+		uint64_t count = 0;
+		size_t size = spans.empty() ? 0 : ReadVarint(data, end, count);
+		if (size != 0 && size <= VARINT_MAX_SIZE)
+		{
+			data += size;
+			remaining = count;
+		}
+	}
+
+	bool Next(Span& span)
+	{
+		uint64_t length = 0;
+		size_t size = remaining != 0 ? ReadVarint(data, end, length) : 0;
+		if (size == 0 || size > VARINT_MAX_SIZE || end - data < static_cast<ptrdiff_t>(size + 4))
+			return false;
+
+		uint32_t color = 0;
+		for (int k = 0; k < 4; ++k)
+			color |= static_cast<uint32_t>(static_cast<uint8_t>(data[size + k])) << (k * 8);
+
+		span.length = static_cast<uint32_t>(length);
+		span.color = static_cast<int32_t>(color);
+		data += size + 4;
+		--remaining;
+		return true;
+	}
+
+private:
+	const char* data;
+	const char* end;
+	uint64_t remaining;
+};
+
+enum ValueType
+{
+	VALUE_FALSE = 0,
+	VALUE_TRUE = 1,
+	VALUE_INTEGER = 2,
+	VALUE_NUMBER = 3,
+	VALUE_STRING = 4
+};
+
+// Key or value of an event field.
+struct Value
+{
+	ValueType type;
+	int64_t integer;
+	double number;
+	std::string_view string;
+};
+
+// Reads the fields of an event, see Record::payload.
+class FieldReader
+{
+public:
+	explicit FieldReader(std::string_view payload) :
+		data(payload.data()),
+		end(payload.data() + payload.size()),
+		remaining(0)
+	{
+		uint64_t count = 0;
+		size_t size = payload.empty() ? 0 : ReadVarint(data, end, count);
+		if (size != 0 && size <= VARINT_MAX_SIZE)
+		{
+			data += size;
+			remaining = count;
+		}
+	}
+
+	bool Next(Value& key, Value& value)
+	{
+		if (remaining == 0 || !ReadValue(key) || !ReadValue(value))
+			return false;
+
+		--remaining;
+		return true;
+	}
+
+private:
+	bool ReadValue(Value& value)
+	{
+		if (data == end)
+			return false;
+
+		value = Value();
+		value.type = static_cast<ValueType>(static_cast<uint8_t>(*data++));
+		uint64_t raw = 0;
+		size_t size;
+		switch (value.type)
+		{
+		case VALUE_FALSE:
+		case VALUE_TRUE:
+			return true;
+
+		case VALUE_INTEGER:
+			size = ReadVarint(data, end, raw);
+			if (size == 0 || size > VARINT_MAX_SIZE)
+				return false;
+
+			value.integer = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+			value.number = static_cast<double>(value.integer);
+			data += size;
+			return true;
+
+		case VALUE_NUMBER:
+			if (end - data < 8)
+				return false;
+
+			for (int k = 0; k < 8; ++k)
+				raw |= static_cast<uint64_t>(static_cast<uint8_t>(data[k])) << (k * 8);
+
+			std::memcpy(&value.number, &raw, sizeof(value.number));
+			value.integer = static_cast<int64_t>(value.number);
+			data += 8;
+			return true;
+
+		case VALUE_STRING:
+			size = ReadVarint(data, end, raw);
+			if (size == 0 || size > VARINT_MAX_SIZE || raw > static_cast<uint64_t>(end - data) - size)
+				return false;
+
+			value.string = std::string_view(data + size, static_cast<size_t>(raw));
+			data += size + raw;
+			return true;
+		}
+
+		return false;
+	}
+
+	const char* data;
+	const char* end;
+	uint64_t remaining;
+};
+
+// Decoded record. The views point into the decoder that produced it.
+struct Record
+{
+	uint32_t server;    // id of the server it came from in aggregated streams, 0 otherwise
+	uint64_t sequence;  // format 2 and up, 0 for replies
+	uint32_t tick;      // format 3 and up
+	uint64_t timestamp; // format 3 and up, monotonic nanoseconds
+	int32_t channel;
+	int32_t severity;
+	int32_t color;
+	std::string_view name;
+	std::string_view message; // without its NUL, empty for events
+	std::string_view payload; // events only: field count and fields, see FieldReader
+	std::string_view spans;   // format 4 and up, colour runs for SpanReader, empty for a single colour
+
+	bool IsEvent() const
+	{
+		return channel == EVENT_CHANNEL;
+	}
+};
+
+// Incremental decoder of one stream. Data is read into its buffer with
+// Prepare and Commit (or Read), then Decode hands out the whole records it
+// holds. The buffer only moves the tail of a record cut in two back to its
+// start when it runs out of room, and grows when a single record doesn't
+// fit in it.
+class Decoder
+{
+public:
+	// Longest a record can get before the decoder gives up on it and skips
+	// to the next terminator.
+	static const size_t MAX_RECORD_SIZE = 64 * 1024 * 1024;
+
+	// format is the one the stream is in at the start, which the decoder
+	// then follows through the replies of the module. Streams of the
+	// aggregator have server ids, are always in format 3, and the replies
+	// in them are those of their servers, which are left alone.
+	explicit Decoder(int format = FORMAT_MIN, bool serverIds = false, size_t capacity = 1024 * 1024) :
+		buffer(capacity < 4096 ? 4096 : capacity),
+		begin(0),
+		end(0),
+		blockBegin(0),
+		blockEnd(0),
+		format(serverIds ? 3 : format),
+		serverIds(serverIds),
+		compressed(false),
+		decompressing(false),
+		malformed(0)
+	{ }
+
+	// Returns where to write at least a quarter of the capacity of data to
+	// and sets size to how much room there is.
+	char* Prepare(size_t& size)
+	{
+		const size_t wanted = buffer.size() / 4;
+		if (buffer.size() - end < wanted)
+		{
+			std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+			end -= begin;
+			begin = 0;
+			if (buffer.size() - end < wanted)
+				buffer.resize(buffer.size() * 2);
+		}
+
+		size = buffer.size() - end;
+		return buffer.data() + end;
+	}
+
+	// Adds size bytes written where Prepare said.
+	void Commit(size_t size)
+	{
+		end += size;
+	}
+
+#ifndef _WIN32
+	// Reads what is available from a descriptor, returns what read did.
+	ssize_t Read(int descriptor)
+	{
+		size_t size;
+		char* target = Prepare(size);
+		ssize_t result;
+		do
+			result = read(descriptor, target, size);
+		while (result == -1 && errno == EINTR);
+
+		if (result > 0)
+			Commit(static_cast<size_t>(result));
+
+		return result;
+	}
+#endif
+
+	// Decodes up to maxRecords of the whole records received so far into
+	// records and returns how many. The records stay valid until the next
+	// call to Prepare, Read or Decode.
+	size_t Decode(Record* records, size_t maxRecords)
+	{
+		size_t count = 0;
+
+		// records handed out of a block point into it, so once one is, the
+		// next block waits for the next call rather than going over them
+		bool blockUsed = false;
+		while (count != maxRecords)
+		{
+			if (blockBegin != blockEnd)
+			{
+				if (DecodeOne(block.data(), blockBegin, blockEnd, records[count]) != DECODED)
+				{
+					// blocks only hold whole records
+					++malformed;
+					blockBegin = blockEnd;
+				}
+				else
+				{
+					++count;
+					blockUsed = true;
+				}
+
+				if (blockBegin == blockEnd && !compressed)
+					decompressing = false;
+
+				continue;
+			}
+
+			if (decompressing)
+			{
+				if (blockUsed || !DecompressBlock())
+					break;
+
+				continue;
+			}
+
+			Result result = DecodeOne(buffer.data(), begin, end, records[count]);
+			if (result == NEEDS_MORE)
+			{
+				if (end - begin > MAX_RECORD_SIZE)
+					Skip();
+
+				break;
+			}
+
+			if (result == DECODED)
+				++count;
+
+			decompressing = compressed;
+		}
+
+		return count;
+	}
+
+	// Decodes a record that came on its own, without a terminator, like
+	// every message of the Windows pipe. Returns false if it is malformed.
+	bool DecodeMessage(const char* data, size_t size, Record& record)
+	{
+		const char* messageEnd = data + size;
+		const char* body = data;
+		if (DecodePrefix(data, messageEnd, record, body) != DECODED || !DecodeBody(body, messageEnd, record))
+		{
+			++malformed;
+			return false;
+		}
+
+		Follow(record);
+		return true;
+	}
+
+	int GetFormat() const
+	{
+		return format;
+	}
+
+	bool IsCompressed() const
+	{
+		return compressed;
+	}
+
+	// Records and blocks that couldn't be decoded and were skipped.
+	uint64_t GetMalformed() const
+	{
+		return malformed;
+	}
+
+private:
+	enum Result
+	{
+		DECODED,
+		NEEDS_MORE,
+		SKIPPED
+	};
+
+	// Reads the varints in front of a record in the current format, and its
+	// colour runs, and sets body to where the record starts.
+	Result DecodePrefix(const char* data, const char* limit, Record& record, const char*& body) const
+	{
+		uint64_t values[4] = {0, 0, 0, 0};
+		const size_t count = (serverIds ? 1 : 0) + (format >= 3 ? 3 : format >= 2 ? 1 : 0);
+		for (size_t k = 0; k < count; ++k)
+		{
+			size_t size = ReadVarint(data, limit, values[k]);
+			if (size == 0)
+				return NEEDS_MORE;
+
+			if (size > VARINT_MAX_SIZE)
+				return SKIPPED;
+
+			data += size;
+		}
+
+		const uint64_t* value = values;
+		record.server = serverIds ? static_cast<uint32_t>(*value++) : 0;
+		record.sequence = format >= 2 ? *value++ : 0;
+		record.tick = format >= 3 ? static_cast<uint32_t>(*value++) : 0;
+		record.timestamp = format >= 3 ? *value++ : 0;
+		record.spans = std::string_view();
+		body = data;
+		if (format < 4)
+			return DECODED;
+
+		const char* spans = data;
+		uint64_t spanCount = 0;
+		size_t size = ReadVarint(data, limit, spanCount);
+		if (size == 0)
+			return NEEDS_MORE;
+
+		if (size > VARINT_MAX_SIZE)
+			return SKIPPED;
+
+		data += size;
+		for (uint64_t k = 0; k < spanCount; ++k)
+		{
+			uint64_t length;
+			size = ReadVarint(data, limit, length);
+			if (size == 0)
+				return NEEDS_MORE;
+
+			if (size > VARINT_MAX_SIZE)
+				return SKIPPED;
+
+			if (limit - data < static_cast<ptrdiff_t>(size + 4))
+				return NEEDS_MORE;
+
+			data += size + 4;
+		}
+
+		if (spanCount != 0)
+			record.spans = std::string_view(spans, static_cast<size_t>(data - spans));
+
+		body = data;
+		return DECODED;
+	}
+
+	// Decodes a record in the legacy layout without its terminator:
+	// int32 channel, int32 severity, name\0, int32 colour, then message\0,
+	// or a varint sized payload for events.
+	static bool DecodeBody(const char* data, const char* limit, Record& record)
+	{
+		if (limit - data < 8)
+			return false;
+
+		std::memcpy(&record.channel, data, sizeof(record.channel));
+		std::memcpy(&record.severity, data + 4, sizeof(record.severity));
+		const char* name = data + 8;
+		const char* nameEnd = static_cast<const char*>(std::memchr(name, '\0', static_cast<size_t>(limit - name)));
+		if (nameEnd == nullptr || limit - nameEnd < 1 + 4)
+			return false;
+
+		record.name = std::string_view(name, static_cast<size_t>(nameEnd - name));
+		std::memcpy(&record.color, nameEnd + 1, sizeof(record.color));
+		const char* body = nameEnd + 1 + 4;
+		record.message = std::string_view();
+		record.payload = std::string_view();
+		if (record.channel == EVENT_CHANNEL)
+		{
+			uint64_t size = 0;
+			size_t sizeSize = ReadVarint(body, limit, size);
+			if (sizeSize == 0 || sizeSize > VARINT_MAX_SIZE || size != static_cast<uint64_t>(limit - body) - sizeSize)
+				return false;
+
+			record.payload = std::string_view(body + sizeSize, static_cast<size_t>(size));
+			return true;
+		}
+
+		if (body == limit || limit[-1] != '\0')
+			return false;
+
+		record.message = std::string_view(body, static_cast<size_t>(limit - body - 1));
+		return true;
+	}
+
+	// Finds where the terminator of an event starting at data has to be, at
+	// least 8 bytes of it are there.
+	static Result FindEventEnd(const char* data, const char* limit, const char*& terminator)
+	{
+		const char* nameEnd = static_cast<const char*>(std::memchr(data + 8, '\0', static_cast<size_t>(limit - data - 8)));
+		if (nameEnd == nullptr || limit - nameEnd < 1 + 4)
+			return NEEDS_MORE;
+
+		const char* body = nameEnd + 1 + 4;
+		uint64_t size = 0;
+		size_t sizeSize = ReadVarint(body, limit, size);
+		if (sizeSize == 0)
+			return NEEDS_MORE;
+
+		if (sizeSize > VARINT_MAX_SIZE || size > static_cast<uint64_t>(MAX_RECORD_SIZE))
+			return SKIPPED;
+
+		if (static_cast<uint64_t>(limit - body) - sizeSize < size + TERMINATOR_SIZE)
+			return NEEDS_MORE;
+
+		terminator = body + sizeSize + size;
+		return std::memcmp(terminator, TERMINATOR, TERMINATOR_SIZE) == 0 ? DECODED : SKIPPED;
+	}
+
+	// Decodes the record at data[position], moving position past it unless
+	// more data is needed.
+	Result DecodeOne(const char* data, size_t& position, size_t limitPosition, Record& record)
+	{
+		const char* start = data + position;
+		const char* limit = data + limitPosition;
+		const char* body = start;
+		Result prefix = DecodePrefix(start, limit, record, body);
+		if (prefix == NEEDS_MORE)
+			return NEEDS_MORE;
+
+		const char* terminator = nullptr;
+		if (prefix == DECODED)
+		{
+			if (limit - body < 8)
+				return NEEDS_MORE;
+
+			int32_t channel;
+			std::memcpy(&channel, body, sizeof(channel));
+			// payloads are binary and can hold anything, events are found by
+			// their size, anything else by its terminator
+			if (channel == EVENT_CHANNEL && FindEventEnd(body, limit, terminator) == NEEDS_MORE)
+				return NEEDS_MORE;
+		}
+
+		if (terminator == nullptr)
+		{
+			terminator = FindTerminator(body, limit);
+			if (terminator == limit)
+				return NEEDS_MORE;
+		}
+
+		position = static_cast<size_t>(terminator - data) + TERMINATOR_SIZE;
+		if (prefix != DECODED || !DecodeBody(body, terminator, record))
+		{
+			++malformed;
+			return SKIPPED;
+		}
+
+		Follow(record);
+		return DECODED;
+	}
+
+	// Applies the replies of the module that change what comes after them.
+	void Follow(const Record& record)
+	{
+		if (serverIds || record.channel != CONTROL_CHANNEL || record.name != "xconsole")
+			return;
+
+		if (record.message == "compress on\n")
+			compressed = true;
+		else if (record.message == "compress off\n")
+			compressed = false;
+		else if (record.message.size() == 9 && record.message.compare(0, 7, "format ") == 0 && record.message[8] == '\n')
+		{
+			int value = record.message[7] - '0';
+			if (value >= FORMAT_MIN && value <= FORMAT_MAX)
+				format = value;
+		}
+	}
+
+	// Decompresses the next block of the stream, a varint size of its
+	// records, a varint size of its payload and the payload, stored as is
+	// when both sizes are the same.
+	bool DecompressBlock()
+	{
+		const char* start = buffer.data() + begin;
+		const char* limit = buffer.data() + end;
+		uint64_t rawSize = 0, payloadSize = 0;
+		size_t header = ReadVarint(start, limit, rawSize);
+		size_t payloadHeader = header != 0 && header <= VARINT_MAX_SIZE ? ReadVarint(start + header, limit, payloadSize) : 0;
+		if (header > VARINT_MAX_SIZE || payloadHeader > VARINT_MAX_SIZE || rawSize > MAX_RECORD_SIZE || payloadSize > MAX_RECORD_SIZE)
+		{
+			// nothing left to sync on
+			++malformed;
+			begin = end;
+			return false;
+		}
+
+		if (payloadHeader == 0 || static_cast<uint64_t>(limit - start) - header - payloadHeader < payloadSize)
+			return false;
+
+		const uint8_t* payload = reinterpret_cast<const uint8_t*>(start + header + payloadHeader);
+		block.resize(static_cast<size_t>(rawSize));
+		begin += header + payloadHeader + static_cast<size_t>(payloadSize);
+		blockBegin = 0;
+		blockEnd = block.size();
+		if (payloadSize == rawSize)
+			std::memcpy(block.data(), payload, block.size());
+		else if (!Decompress(payload, static_cast<size_t>(payloadSize), reinterpret_cast<uint8_t*>(block.data()), block.size()))
+		{
+			++malformed;
+			blockEnd = 0;
+		}
+
+		return true;
+	}
+
+	// Gives up on a record too big to be one.
+	void Skip()
+	{
+		++malformed;
+		const char* terminator = FindTerminator(buffer.data() + begin, buffer.data() + end);
+		begin = terminator == buffer.data() + end ? end - (TERMINATOR_SIZE - 1) : static_cast<size_t>(terminator - buffer.data()) + TERMINATOR_SIZE;
+	}
+
+	std::vector<char> buffer;
+	size_t begin;
+	size_t end;
+	std::vector<char> block;
+	size_t blockBegin;
+	size_t blockEnd;
+	int format;
+	bool serverIds;
+	bool compressed;    // the module said the stream is in blocks now
+	bool decompressing; // the stream is in blocks from begin onwards
+	uint64_t malformed;
+};
+
+} // namespace client
+
+} // namespace xconsole
\ No newline at end of file
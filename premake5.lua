@@ -9,6 +9,41 @@ newoption({
 include(assert(_OPTIONS.gmcommon or os.getenv("GARRYSMOD_COMMON"),
 	"you didn't provide a path to your garrysmod_common (https://github.com/danielga/garrysmod_common) directory"))
 
+-- MultiLibrary buffer and stream classes, shared by the module and the tools
+local multilibrary_files = {
+	"source/ByteBuffer.cpp",
+	"source/IOStream.cpp",
+	"source/InputStream.cpp",
+	"source/OutputStream.cpp",
+	"source/SegmentedBuffer.cpp",
+	"source/Stream.cpp",
+	"source/Varint.cpp"
+}
+
+-- module core that doesn't depend on Lua, shared by the module and the load generator
+local core_files = {
+	"source/Capture.cpp",
+	"source/Compression.cpp",
+	"source/Console.cpp",
+	"source/Cvars.cpp",
+	"source/EgressQueue.cpp",
+	"source/Endpoints.cpp",
+	"source/Events.cpp",
+	"source/Lines.cpp",
+	"source/LoggingApi.cpp",
+	"source/Memory.cpp",
+	"source/Outbound.cpp",
+	"source/Patterns.cpp",
+	"source/Sampling.cpp",
+	"source/Scrollback.cpp",
+	"source/SharedRing.cpp",
+	"source/Stats.cpp",
+	"source/Status.cpp",
+	"source/Subscriptions.cpp",
+	"source/Ticks.cpp",
+	"source/Watches.cpp"
+}
+
 CreateWorkspace({name = "xconsole"})
 	CreateProject({serverside = true})
 		warnings("Default")
@@ -17,4 +52,68 @@ CreateWorkspace({name = "xconsole"})
 		IncludeSDKTier1()
 
 		filter("system:linux")
-			links({"pthread", "dl"})
+			links({"pthread", "dl", "rt"})
+
+		filter({})
+
+	-- standalone benchmarks for the buffer and stream classes, no SDK needed
+	project("xconsole_bench")
+		kind("ConsoleApp")
+		language("C++")
+		cppdialect("C++17")
+		warnings("Default")
+		includedirs({"source", "include"})
+		files(multilibrary_files)
+		files({"bench/bench.cpp", "source/Compression.cpp", "source/Memory.cpp", "source/Patterns.cpp"})
+
+	-- unit tests for what doesn't need the engine, no SDK needed
+	project("xconsole_tests")
+		kind("ConsoleApp")
+		language("C++")
+		cppdialect("C++17")
+		warnings("Default")
+		includedirs({"source", "include"})
+		files(multilibrary_files)
+		files({"source/Memory.cpp", "source/Outbound.cpp", "source/Patterns.cpp", "source/Sampling.cpp", "source/Stats.cpp", "source/Subscriptions.cpp", "tests/tests.cpp"})
+
+	-- drives the module core against stub engine interfaces, no SDK needed
+	if os.target() ~= "windows" then
+		project("xconsole_loadgen")
+			kind("ConsoleApp")
+			language("C++")
+			cppdialect("C++17")
+			warnings("Default")
+			includedirs({"tools/loadgen/sdk", "source"})
+			files(multilibrary_files)
+			files(core_files)
+			files({"tools/loadgen/*.cpp"})
+			links({"pthread"})
+
+			filter("system:linux")
+				links({"rt"})
+
+			filter({})
+	end
+
+	-- merges the streams of every server on the host into one, epoll based
+	if os.target() == "linux" then
+		project("xconsole_aggregator")
+			kind("ConsoleApp")
+			language("C++")
+			cppdialect("C++17")
+			warnings("Default")
+			includedirs({"source"})
+			files({"tools/aggregator/*.cpp", "source/Endpoints.cpp", "source/SharedRing.cpp", "source/Varint.cpp"})
+			links({"rt"})
+	end
+
+	-- replays a command capture against a server and measures its impact
+	if os.target() ~= "windows" then
+		project("xconsole_replay")
+			kind("ConsoleApp")
+			language("C++")
+			cppdialect("C++17")
+			warnings("Default")
+			includedirs({"source", "include"})
+			files({"tools/replay/*.cpp", "source/Capture.cpp", "source/Endpoints.cpp", "source/Varint.cpp"})
+	end
@@ -35,6 +35,7 @@
  *************************************************************************/
 
 #include <ByteBuffer.hpp>
+#include <Varint.hpp>
 #include <stdexcept>
 #include <cassert>
 #include <cstring>
@@ -204,4 +205,23 @@ size_t ByteBuffer::Write( const void *value, size_t size )
 	return size;
 }
 
+size_t ByteBuffer::ReadVarint( uint64_t &value )
+{
+	if( buffer_offset >= buffer_internal.size( ) )
+	{
+		end_of_file = true;
+		return 0;
+	}
+
+	size_t read = Varint::Decode( &buffer_internal[buffer_offset], buffer_internal.size( ) - buffer_offset, value );
+	if( read == 0 )
+	{
+		end_of_file = true;
+		return 0;
+	}
+
+	buffer_offset += read;
+	return read;
+}
+
 } // namespace MultiLibrary
\ No newline at end of file
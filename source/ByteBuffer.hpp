@@ -245,6 +245,19 @@ public:
 	 */
 	size_t Write( const void *value, size_t size );
 
+	/*!
+	 \brief Read a LEB128 variable-length integer.
+
+	 Decodes straight from the internal buffer instead of going through
+	 Read one byte at a time.
+
+	 \param value Where to store the data.
+
+	 \return Amount of read bytes, 0 if the buffer ended before the value
+	 did or the value is malformed.
+	 */
+	size_t ReadVarint( uint64_t &value );
+
 private:
 	bool end_of_file;
 	std::vector<uint8_t> buffer_internal;
@@ -0,0 +1,162 @@
+#include <Capture.hpp>
+
+#include <Varint.hpp>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <cctype>
+#include <cstring>
+
+namespace xconsole
+{
+
+namespace capture
+{
+
+// larger commands mean the file is damaged
+static const uint64_t MAX_COMMAND_SIZE = 16 * 1024 * 1024;
+
+static FILE* file = nullptr;
+static uint64_t last = 0;
+static uint64_t count = 0;
+
+static bool Write(const uint8_t* data, size_t size)
+{
+	return std::fwrite(data, 1, size, file) == size;
+}
+
+bool Start(const std::string& path, uint64_t now)
+{
+	Stop();
+
+	file = std::fopen(path.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+
+	uint8_t start[MultiLibrary::Varint::MaxSize];
+	size_t size = MultiLibrary::Varint::Encode(now, start);
+	if (!Write(reinterpret_cast<const uint8_t*>(MAGIC), MAGIC_SIZE) || !Write(start, size) || std::fflush(file) != 0)
+	{
+		Stop();
+		return false;
+	}
+
+	last = now;
+	count = 0;
+	return true;
+}
+
+bool StartNamed(const std::string& name, uint64_t now)
+{
+	if (name.empty() || name[0] == '.')
+		return false;
+
+	for (char character : name)
+		if (!std::isalnum(static_cast<unsigned char>(character)) && character != '-' && character != '_' && character != '.')
+			return false;
+
+#ifdef _WIN32
+	CreateDirectoryA(DIRECTORY, nullptr);
+	return Start(std::string(DIRECTORY) + "\\" + name, now);
+#else
+	mkdir(DIRECTORY, 0755);
+	return Start(std::string(DIRECTORY) + "/" + name, now);
+#endif
+}
+
+void Record(uint64_t timestamp, uint32_t client, const char* command, size_t size)
+{
+	if (file == nullptr)
+		return;
+
+	uint8_t header[3 * MultiLibrary::Varint::MaxSize];
+	size_t headerSize = MultiLibrary::Varint::Encode(timestamp > last ? timestamp - last : 0, header);
+	headerSize += MultiLibrary::Varint::Encode(client, header + headerSize);
+	headerSize += MultiLibrary::Varint::Encode(size, header + headerSize);
+
+	// flushed every time so the capture survives a crash, commands come in
+	// far too slowly for that to matter
+	if (!Write(header, headerSize) || !Write(reinterpret_cast<const uint8_t*>(command), size) || std::fflush(file) != 0)
+	{
+		Stop();
+		return;
+	}
+
+	last = timestamp > last ? timestamp : last;
+	++count;
+}
+
+uint64_t Stop()
+{
+	if (file != nullptr)
+	{
+		std::fclose(file);
+		file = nullptr;
+	}
+
+	return count;
+}
+
+bool IsActive()
+{
+	return file != nullptr;
+}
+
+Reader::~Reader()
+{
+	if (file != nullptr)
+		std::fclose(file);
+}
+
+bool Reader::Open(const char* path)
+{
+	file = std::fopen(path, "rb");
+	if (file == nullptr)
+		return false;
+
+	char magic[MAGIC_SIZE];
+	return std::fread(magic, 1, MAGIC_SIZE, file) == MAGIC_SIZE && std::memcmp(magic, MAGIC, MAGIC_SIZE) == 0 && ReadVarint(timestamp);
+}
+
+bool Reader::Next(Command& command)
+{
+	uint64_t delta;
+	uint64_t client;
+	uint64_t size;
+	if (file == nullptr || !ReadVarint(delta) || !ReadVarint(client) || !ReadVarint(size) || size > MAX_COMMAND_SIZE)
+		return false;
+
+	command.text.resize(static_cast<size_t>(size));
+	if (size != 0 && std::fread(&command.text[0], 1, command.text.size(), file) != command.text.size())
+		return false;
+
+	timestamp += delta;
+	command.timestamp = timestamp;
+	command.client = static_cast<uint32_t>(client);
+	return true;
+}
+
+bool Reader::ReadVarint(uint64_t& value)
+{
+	uint8_t buffer[MultiLibrary::Varint::MaxSize];
+	for (size_t size = 0; size < sizeof(buffer); ++size)
+	{
+		int byte = std::fgetc(file);
+		if (byte == EOF)
+			return false;
+
+		buffer[size] = static_cast<uint8_t>(byte);
+		if ((byte & 0x80) == 0)
+			return MultiLibrary::Varint::Decode(buffer, size + 1, value) == size + 1;
+	}
+
+	return false;
+}
+
+} // namespace capture
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace xconsole
+{
+
+namespace capture
+{
+
+// A capture file starts with MAGIC and a varint timestamp in nanoseconds
+// (the steady clock, as on records), then holds every command as a varint
+// nanoseconds since the one before (or since the start), a varint client
+// id, a varint length and the bytes of the command, as received.
+static const char MAGIC[] = "XCAP\x01";
+static const size_t MAGIC_SIZE = sizeof(MAGIC) - 1;
+
+struct Command
+{
+	uint64_t timestamp;
+	uint32_t client;
+	std::string text;
+};
+
+// Where captures started by a console request go, relative to the working
+// directory of the server. Consoles only name the file, anyone able to write
+// to the input pipe could otherwise have the server replace any file.
+static const char* const DIRECTORY = "xconsole_captures";
+
+// Starts writing received commands to the file at path, replacing it.
+// Called on the thread that reads commands, like Record and Stop.
+bool Start(const std::string& path, uint64_t now);
+
+// Same for a capture requested by a console, to the file named name in
+// DIRECTORY, which is created if needed. Fails when name is empty, starts
+// with a dot or has anything but letters, digits, '-', '_' and '.' in it.
+bool StartNamed(const std::string& name, uint64_t now);
+
+// Appends a command to the capture, does nothing when none is running.
+// client tells consoles apart where the transport can, it is 0 otherwise.
+// A write error stops the capture.
+void Record(uint64_t timestamp, uint32_t client, const char* command, size_t size);
+
+// Ends the capture, returns how many commands it holds.
+uint64_t Stop();
+
+bool IsActive();
+
+// Reads a capture file back, for the replay tool.
+class Reader
+{
+public:
+	~Reader();
+
+	bool Open(const char* path);
+
+	// Returns false at the end of the file, or when the rest is cut short.
+	bool Next(Command& command);
+
+private:
+	bool ReadVarint(uint64_t& value);
+
+	FILE* file = nullptr;
+	uint64_t timestamp = 0;
+};
+
+} // namespace capture
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include <Compression.hpp>
+
+#include <cstring>
+
+namespace xconsole
+{
+
+namespace compression
+{
+
+// constraints of the LZ4 block format: matches are at least 4 bytes long and
+// at most 64 KB back, the last 5 bytes are always literals and the last
+// match starts at least 12 bytes before the end
+static const size_t MIN_MATCH = 4;
+static const size_t LAST_LITERALS = 5;
+static const size_t MATCH_FIND_LIMIT = 12;
+static const size_t MAX_OFFSET = 65535;
+
+// 16 KB table of recent positions, small enough for the stack
+static const unsigned HASH_BITS = 12;
+
+static uint32_t Read32(const uint8_t* data)
+{
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static uint32_t Hash(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths of 15 and over continue in extra bytes of 255 and a final one below.
+static uint8_t* WriteLength(uint8_t* output, size_t length)
+{
+	for (; length >= 255; length -= 255)
+		*output++ = 255;
+
+	*output++ = static_cast<uint8_t>(length);
+	return output;
+}
+
+static uint8_t* WriteSequence(uint8_t* output, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+	uint8_t* token = output++;
+	*token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+	if (literalLength >= 15)
+		output = WriteLength(output, literalLength - 15);
+
+	if (literalLength != 0)
+		std::memcpy(output, literals, literalLength);
+
+	output += literalLength;
+
+	// the last sequence is only literals
+	if (matchLength == 0)
+		return output;
+
+	*output++ = static_cast<uint8_t>(offset);
+	*output++ = static_cast<uint8_t>(offset >> 8);
+
+	matchLength -= MIN_MATCH;
+	*token |= static_cast<uint8_t>(matchLength < 15 ? matchLength : 15);
+	if (matchLength >= 15)
+		output = WriteLength(output, matchLength - 15);
+
+	return output;
+}
+
+size_t Bound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t Compress(const uint8_t* input, size_t size, uint8_t* output)
+{
+	uint8_t* out = output;
+	const uint8_t* anchor = input;
+	if (size > MATCH_FIND_LIMIT)
+	{
+		uint32_t table[1 << HASH_BITS] = {};
+		const uint8_t* end = input + size;
+		const uint8_t* matchLimit = end - LAST_LITERALS;
+		const uint8_t* findLimit = end - MATCH_FIND_LIMIT;
+		const uint8_t* position = input + 1;
+		while (position < findLimit)
+		{
+			uint32_t sequence = Read32(position);
+			uint32_t& slot = table[Hash(sequence)];
+			const uint8_t* candidate = input + slot;
+			slot = static_cast<uint32_t>(position - input);
+			if (candidate >= position || static_cast<size_t>(position - candidate) > MAX_OFFSET || Read32(candidate) != sequence)
+			{
+				++position;
+				continue;
+			}
+
+			while (position > anchor && candidate > input && position[-1] == candidate[-1])
+			{
+				--position;
+				--candidate;
+			}
+
+			size_t length = MIN_MATCH;
+			while (position + length < matchLimit && position[length] == candidate[length])
+				++length;
+
+			out = WriteSequence(out, anchor, static_cast<size_t>(position - anchor), static_cast<size_t>(position - candidate), length);
+			position += length;
+			anchor = position;
+
+			if (position < findLimit)
+				table[Hash(Read32(position - 2))] = static_cast<uint32_t>(position - 2 - input);
+		}
+	}
+
+	out = WriteSequence(out, anchor, static_cast<size_t>(input + size - anchor), 0, 0);
+	return static_cast<size_t>(out - output);
+}
+
+// Reads the extra bytes of a length, false if the block ends in the middle.
+static bool ReadLength(const uint8_t*& input, const uint8_t* end, size_t& length)
+{
+	uint8_t byte;
+	do
+	{
+		if (input == end)
+			return false;
+
+		byte = *input++;
+		length += byte;
+	}
+	while (byte == 255);
+
+	return true;
+}
+
+bool Decompress(const uint8_t* input, size_t size, uint8_t* output, size_t outputSize)
+{
+	const uint8_t* end = input + size;
+	uint8_t* out = output;
+	uint8_t* outputEnd = output + outputSize;
+	while (input != end)
+	{
+		uint8_t token = *input++;
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(input, end, literalLength))
+			return false;
+
+		if (literalLength > static_cast<size_t>(end - input) || literalLength > static_cast<size_t>(outputEnd - out))
+			return false;
+
+		if (literalLength != 0)
+			std::memcpy(out, input, literalLength);
+
+		input += literalLength;
+		out += literalLength;
+		if (input == end)
+			break;
+
+		if (end - input < 2)
+			return false;
+
+		size_t offset = input[0] | static_cast<size_t>(input[1]) << 8;
+		input += 2;
+		if (offset == 0 || offset > static_cast<size_t>(out - output))
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(input, end, matchLength))
+			return false;
+
+		matchLength += MIN_MATCH;
+		if (matchLength > static_cast<size_t>(outputEnd - out))
+			return false;
+
+		// matches closer than their length overlap what they produce, those
+		// are copied byte by byte
+		const uint8_t* match = out - offset;
+		if (offset >= matchLength)
+			std::memcpy(out, match, matchLength);
+		else
+			for (size_t k = 0; k < matchLength; ++k)
+				out[k] = match[k];
+
+		out += matchLength;
+	}
+
+	return out == outputEnd;
+}
+
+} // namespace compression
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace xconsole
+{
+
+namespace compression
+{
+
+// Self-contained LZ77 block codec producing the LZ4 block format, so
+// consumers can use any LZ4 implementation (LZ4_decompress_safe) as well as
+// Decompress below. Blocks are independent of each other.
+
+// Largest compressed size of size bytes of input.
+size_t Bound(size_t size);
+
+// Compresses size bytes of input into output, which needs room for
+// Bound(size) bytes. Returns the compressed size.
+size_t Compress(const uint8_t* input, size_t size, uint8_t* output);
+
+// Decompresses a block into exactly outputSize bytes. Returns false when the
+// block is malformed or doesn't decompress to that size.
+bool Decompress(const uint8_t* input, size_t size, uint8_t* output, size_t outputSize);
+
+} // namespace compression
+
+} // namespace xconsole
\ No newline at end of file
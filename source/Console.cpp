@@ -0,0 +1,1605 @@
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <mutex>
+
+#include <Console.hpp>
+#include <Capture.hpp>
+#include <Compression.hpp>
+#include <Cvars.hpp>
+#include <EgressQueue.hpp>
+#include <Endpoints.hpp>
+#include <Events.hpp>
+#include <Lines.hpp>
+#include <LoggingApi.hpp>
+#include <Memory.hpp>
+#include <Patterns.hpp>
+#include <Outbound.hpp>
+#include <Scrollback.hpp>
+#include <SharedRing.hpp>
+#include <Sampling.hpp>
+#include <Stats.hpp>
+#include <Status.hpp>
+#include <Subscriptions.hpp>
+#include <Ticks.hpp>
+#include <Watches.hpp>
+#include <ByteBuffer.hpp>
+#include <SegmentedBuffer.hpp>
+#include <Varint.hpp>
+#include <Platform.hpp>
+#include <color.h>
+#include <eiface.h>
+#include <tier0/dbg.h>
+
+#if ARCHITECTURE_IS_X86_64
+#include <logging.h>
+#endif
+
+#ifdef _WIN32
+static HANDLE serverPipe = INVALID_HANDLE_VALUE;
+#else
+const char* EOL_SEQUENCE = "<EOL>\0";
+
+static int serverPipe = -1;
+static int serverPipeIn = -1;
+#endif
+
+// pipes and shared memory ring of this instance, named after -xconsole_endpoint
+static xconsole::endpoints::Endpoints serverEndpoints;
+
+static volatile bool serverShutdown = false;
+static volatile bool writerShutdown = false;
+static volatile bool serverConnected = false;
+static std::thread serverThread;
+static IVEngineServer* engineServer = nullptr;
+
+// the high and normal lanes each get a sixth of the egress queue size, the
+// low lane the rest
+static const size_t EGRESS_LANE_SHARE = 6;
+static const size_t EGRESS_LANE_MIN_SIZE = 64 * 1024;
+
+// smallest scrollback and shared memory ring worth having
+static const size_t RING_MIN_SIZE = 64 * 1024;
+
+// cap on short lived buffers, like replies and replays
+static const size_t TEMPORARY_MEMORY_QUOTA = 4 * 1024 * 1024;
+
+// caps on state that grows with what filters, threads and consoles ask for
+static const size_t PATTERNS_MEMORY_QUOTA = 16 * 1024 * 1024;
+static const size_t LINES_MEMORY_QUOTA = 2 * 1024 * 1024;
+static const size_t CVARS_MEMORY_QUOTA = 8 * 1024 * 1024;
+static const size_t STATUS_MEMORY_QUOTA = 1024 * 1024;
+
+// how long a lane waits for room in a full pipe before dropping records,
+// lower priority records never wait so they can't hold up the others
+static const int EGRESS_WRITE_TIMEOUTS[xconsole::LANE_COUNT] = {100, 10, 0};
+static const size_t EGRESS_BATCH_SIZE = 64;
+
+// how often the writer thread looks for partial lines that timed out, in
+// milliseconds
+static const int LINE_FLUSH_INTERVAL = 5;
+
+// how often the writer thread polls a full pipe to finish a record it only
+// took part of, in milliseconds
+static const int OUTBOUND_POLL_INTERVAL = 5;
+
+// how long the writer thread waits to finish such a record in place when the
+// memory budget has no room to hold the rest, before it gives up on it, in
+// milliseconds
+static const int OUTBOUND_STALL_TIMEOUT = 100;
+
+// how long a replay waits for a console to make room in the pipe
+static const int REPLAY_WRITE_TIMEOUT = 1000;
+
+// replies to control requests are sent as records on this pseudo channel
+static const int32_t CONTROL_CHANNEL_ID = -1;
+static const char* CONTROL_CHANNEL_NAME = "xconsole";
+
+// per tick telemetry and hitch records are sent on this one, hitches with
+// warning severity
+static const int32_t TICK_CHANNEL_ID = -2;
+static const char* TICK_CHANNEL_NAME = "xconsole_tick";
+static const int32_t HITCH_SEVERITY = 1;
+
+// "sampled X of Y" summaries for channels over their budget go on this one,
+// once per interval
+static const int32_t SAMPLING_CHANNEL_ID = -3;
+static const char* SAMPLING_CHANNEL_NAME = "xconsole_sampling";
+static const uint64_t SAMPLING_SUMMARY_INTERVAL = 1000000000;
+
+// structured events from xconsole.Emit go on this one, with the name they
+// were emitted under as channel name and a sized payload instead of a message
+static const int32_t EVENT_CHANNEL_ID = -4;
+
+// answers to status requests are events under this name
+static const char* STATUS_EVENT_NAME = "xconsole_status";
+
+// values of watched convars go on this one, with the convar name as channel
+// name and its value as message
+static const int32_t CVAR_CHANNEL_ID = -5;
+
+// commands starting with this byte are requests for the module itself and
+// never reach the engine
+static const char CONTROL_REQUEST_PREFIX = '\x01';
+static const char CAPTURE_REQUEST[] = "\x01" "capture ";
+
+// id recorded in captures for the console sending commands, on Windows it
+// counts connections to the pipe. Every console writes to the same FIFO on
+// POSIX and nothing tells them apart there, so it stays 0.
+static uint32_t clientID = 0;
+
+static xconsole::EgressQueue* egressQueue = nullptr;
+static std::thread writerThread;
+static bool pipeOutput = true;
+
+// framing of the output pipe: 1 is the original record layout, 2 prefixes
+// every record with its sequence number as a varint, 3 with its sequence
+// number, tick and timestamp, 4 adds the colour spans of the record after
+// those and 5 also sends event records, which older formats leave out
+static int outputFormat = 1;
+static const int OUTPUT_FORMAT_MAX = 5;
+static const int OUTPUT_FORMAT_EVENTS = 5;
+static const size_t RECORD_PREFIX_MAX_SIZE = 3 * MultiLibrary::Varint::MaxSize + 1;
+static uint64_t nextSequence = 1;
+
+// once a console asks for it, batches of records go out as compressed blocks
+static bool compressOutput = false;
+
+// owner of the patterns records on the output pipe have to match, -1 while
+// it isn't filtered
+static int pipeFilter = -1;
+static uint64_t lastSamplingSummary = 0;
+static xconsole::Scrollback* scrollback = nullptr;
+
+// what was reserved from the memory budget for each long lived buffer
+static size_t egressMemory = 0;
+static size_t sharedRingMemory = 0;
+static size_t scrollbackMemory = 0;
+
+// control requests that have to be answered in order with the records, they
+// are served by the writer thread
+static std::mutex writerRequestsMutex;
+static std::vector<std::string> writerRequests;
+
+#ifndef _WIN32
+static xconsole::SharedRing sharedRing;
+
+// rest of the last record the output pipe only took part of
+static xconsole::OutboundBuffer outbound;
+#endif
+
+// Encodes a record and queues it for the writer thread, returns its size or
+// 0 if it was dropped. The header goes into a per-thread buffer that keeps
+// its capacity between calls, the message (and the colour spans of a line
+// assembled from fragments) is copied once, straight into the queue.
+static size_t SubmitRecord(int32_t channelID, int32_t severity, const char* channelName, int32_t rawColor, const char* message, const uint8_t* spans, size_t spansSize, uint64_t timestamp, uint32_t tick, xconsole::Lane lane)
+{
+	if (egressQueue == nullptr)
+		return 0;
+
+	static thread_local MultiLibrary::SegmentedBuffer buffer;
+	{
+		xconsole::stats::ScopedTimer timer(xconsole::stats::STAGE_ENCODE);
+		buffer.Clear();
+		buffer <<
+			channelID <<
+			severity <<
+			channelName <<
+			rawColor;
+
+		buffer.Reference(message, std::strlen(message) + 1);
+
+#ifndef _WIN32
+		buffer << EOL_SEQUENCE;
+#endif
+
+		if (spansSize != 0)
+			buffer.Reference(spans, spansSize);
+	}
+
+	bool queued;
+	{
+		xconsole::stats::ScopedTimer timer(xconsole::stats::STAGE_ENQUEUE);
+		queued = egressQueue->Push(buffer, spansSize, timestamp, tick, lane);
+	}
+
+	xconsole::stats::Add(queued ? xconsole::stats::COUNTER_RECORDS : xconsole::stats::COUNTER_DROPS);
+	if (queued && xconsole::stats::IsEnabled())
+		xconsole::stats::UpdateMaxQueueDepth(egressQueue->Depth());
+
+	return queued ? static_cast<size_t>(buffer.Size()) : 0;
+}
+
+// Samples channels that are over budget (anything above the low lane is
+// always kept) and submits the records that make it, which Lua subscribers
+// get a copy of.
+static size_t AdmitRecord(int32_t channelID, int32_t severity, const char* channelName, int32_t rawColor, const char* message, const uint8_t* spans, size_t spansSize, uint64_t timestamp, uint32_t tick, xconsole::Lane lane)
+{
+	if (!xconsole::sampling::Admit(channelID, lane != xconsole::LANE_LOW, timestamp))
+	{
+		xconsole::stats::Add(xconsole::stats::COUNTER_SAMPLED);
+		return 0;
+	}
+
+	xconsole::subscriptions::Offer(channelID, severity, channelName, rawColor, message, timestamp, tick);
+
+	return SubmitRecord(channelID, severity, channelName, rawColor, message, spans, spansSize, timestamp, tick, lane);
+}
+
+// Queues an event record: the usual header with EVENT_CHANNEL_ID, then a
+// varint payload size and the payload, a field count and the fields. Events
+// are never sampled, they are what the gamemode explicitly asked to send.
+static size_t SubmitEvent(const char* name, const xconsole::events::Encoder& event, uint64_t timestamp, uint32_t tick, xconsole::Lane lane)
+{
+	if (egressQueue == nullptr)
+		return 0;
+
+	static thread_local MultiLibrary::SegmentedBuffer buffer;
+	uint8_t sizes[2 * MultiLibrary::Varint::MaxSize];
+	{
+		xconsole::stats::ScopedTimer timer(xconsole::stats::STAGE_ENCODE);
+		const std::vector<uint8_t>& fields = event.GetFields();
+		uint8_t count[MultiLibrary::Varint::MaxSize];
+		size_t countSize = MultiLibrary::Varint::Encode(event.GetFieldCount(), count);
+		size_t size = MultiLibrary::Varint::Encode(countSize + fields.size(), sizes);
+		std::memcpy(sizes + size, count, countSize);
+
+		buffer.Clear();
+		buffer <<
+			EVENT_CHANNEL_ID <<
+			static_cast<int32_t>(0) <<
+			name <<
+			static_cast<int32_t>(0);
+
+		buffer.Reference(sizes, size + countSize);
+		buffer.Reference(fields.data(), fields.size());
+
+#ifndef _WIN32
+		buffer << EOL_SEQUENCE;
+#endif
+	}
+
+	bool queued;
+	{
+		xconsole::stats::ScopedTimer timer(xconsole::stats::STAGE_ENQUEUE);
+		queued = egressQueue->Push(buffer, 0, timestamp, tick, lane);
+	}
+
+	xconsole::stats::Add(queued ? xconsole::stats::COUNTER_RECORDS : xconsole::stats::COUNTER_DROPS);
+	if (queued && xconsole::stats::IsEnabled())
+		xconsole::stats::UpdateMaxQueueDepth(egressQueue->Depth());
+
+	return queued ? static_cast<size_t>(buffer.Size()) : 0;
+}
+
+// bytes submitted for lines completed by the current LogRecord call
+static thread_local size_t completedSize = 0;
+
+// Sink of the line assembler. The record takes the colour of the first span,
+// the spans themselves are only sent when there is more than one.
+static void SubmitLine(const xconsole::lines::Line& line)
+{
+	static thread_local std::vector<uint8_t> spans;
+	spans.clear();
+	if (line.spans.size() > 1)
+		xconsole::lines::EncodeSpans(line.spans, spans);
+
+	xconsole::stats::Add(xconsole::stats::COUNTER_COALESCED, line.fragments - 1);
+	completedSize += AdmitRecord(line.channel, line.severity, line.name.c_str(), line.spans.front().color, line.text.c_str(), spans.data(), spans.size(), line.timestamp, line.tick, line.lane);
+}
+
+// Entry point for records coming from the engine, whichever logging API
+// they came through (see LoggingApi.hpp): stamps them with the time and tick
+// they were logged in, puts lines printed in several fragments back
+// together, and accounts the time spent to that tick.
+static void LogRecord(const xconsole::LoggedRecord& record, const char* message)
+{
+	uint64_t start = xconsole::stats::Now();
+	uint32_t tick = xconsole::ticks::GetCurrent();
+
+	completedSize = 0;
+	size_t size;
+	if (xconsole::lines::Append(record.channel, record.severity, record.channelName, record.color, message, record.lane, start, tick, SubmitLine))
+		size = completedSize;
+	else
+		size = completedSize + AdmitRecord(record.channel, record.severity, record.channelName, record.color, message, nullptr, 0, start, tick, record.lane);
+
+	uint64_t elapsed = xconsole::stats::Now() - start;
+
+	if (xconsole::stats::IsEnabled())
+		xconsole::stats::Record(xconsole::stats::STAGE_LOG, elapsed);
+
+	xconsole::ticks::AddRecord(size, elapsed);
+}
+
+// Encodes what goes in front of a record on the output pipe in the current
+// format and returns its size, at most RECORD_PREFIX_MAX_SIZE. In format 4
+// the colour spans kept after the record follow the prefix, a record
+// without any gets an empty span list instead.
+static size_t EncodeRecordPrefix(const xconsole::EgressQueue::Entry& entry, uint8_t* prefix)
+{
+	if (outputFormat < 2)
+		return 0;
+
+	size_t size = MultiLibrary::Varint::Encode(entry.sequence, prefix);
+	if (outputFormat >= 3)
+	{
+		size += MultiLibrary::Varint::Encode(entry.tick, prefix + size);
+		size += MultiLibrary::Varint::Encode(entry.timestamp, prefix + size);
+	}
+
+	if (outputFormat >= 4 && entry.spans == 0)
+		prefix[size++] = 0;
+
+	return size;
+}
+
+static bool HasSpans(const xconsole::EgressQueue::Entry& entry)
+{
+	return outputFormat >= 4 && entry.spans != 0;
+}
+
+static bool IsEvent(const xconsole::EgressQueue::Entry& entry)
+{
+	int32_t channel;
+	if (entry.size < sizeof(channel))
+		return false;
+
+	std::memcpy(&channel, entry.data, sizeof(channel));
+	return channel == EVENT_CHANNEL_ID;
+}
+
+// Event records only go to consoles that asked for a format that has them.
+// With a filter, records on engine channels have to match one of its
+// patterns, those of the module itself (replies, telemetry) always pass.
+static bool IsWritten(const xconsole::EgressQueue::Entry& entry, const xconsole::patterns::Automaton* filter)
+{
+	if (IsEvent(entry))
+		return outputFormat >= OUTPUT_FORMAT_EVENTS;
+
+	int32_t channel;
+	if (filter == nullptr || entry.size < 2 * sizeof(int32_t))
+		return true;
+
+	std::memcpy(&channel, entry.data, sizeof(channel));
+	if (channel < 0)
+		return true;
+
+	// channel, severity, name, colour, then the message
+	const char* name = reinterpret_cast<const char*>(entry.data) + 2 * sizeof(int32_t);
+	const char* end = reinterpret_cast<const char*>(entry.data) + entry.size;
+	const char* message = name + strnlen(name, static_cast<size_t>(end - name)) + 1 + sizeof(int32_t);
+	if (message >= end)
+		return true;
+
+	return (filter->Match(message, strnlen(message, static_cast<size_t>(end - message))) & (uint64_t(1) << pipeFilter)) != 0;
+}
+
+// Returns the records of a batch of count (at most EGRESS_BATCH_SIZE) to
+// write with the current format and filter, copied to kept when some are
+// left out.
+static const xconsole::EgressQueue::Entry* SelectWritten(const xconsole::EgressQueue::Entry* entries, size_t& count, xconsole::EgressQueue::Entry* kept)
+{
+	std::shared_ptr<const xconsole::patterns::Automaton> filter;
+	if (pipeFilter >= 0)
+		filter = xconsole::patterns::GetAutomaton();
+
+	if (outputFormat >= OUTPUT_FORMAT_EVENTS && filter == nullptr)
+		return entries;
+
+	size_t keptCount = 0;
+	for (size_t k = 0; k < count; ++k)
+		if (IsWritten(entries[k], filter.get()))
+			kept[keptCount++] = entries[k];
+
+	count = keptCount;
+	return kept;
+}
+
+#ifdef _WIN32
+// Writes one message. The pipe doesn't block (PIPE_NOWAIT), so timeout is
+// unused here.
+static bool WriteBuffer(const uint8_t* data, size_t size, int timeout)
+{
+	DWORD written = 0;
+	BOOL success;
+	{
+		xconsole::stats::ScopedTimer timer(xconsole::stats::STAGE_WRITE);
+		success = WriteFile(serverPipe, data, static_cast<DWORD>(size), &written, nullptr);
+	}
+
+	xconsole::stats::Add(xconsole::stats::COUNTER_SYSCALLS);
+	if (success == FALSE)
+	{
+		serverConnected = false;
+		return false;
+	}
+
+	xconsole::stats::Add(xconsole::stats::COUNTER_BYTES, written);
+	return true;
+}
+#else
+static bool WaitWritable(int fd, int timeout)
+{
+	pollfd descriptor = {fd, POLLOUT, 0};
+	while (!serverShutdown)
+	{
+		int result = poll(&descriptor, 1, timeout);
+		if (result > 0)
+			return (descriptor.revents & POLLOUT) != 0;
+
+		if (result == 0 || errno != EINTR)
+			return false;
+	}
+
+	return false;
+}
+
+// Finishes the record the pipe only took part of, waiting up to timeout
+// milliseconds each time it is full. Returns true once nothing is left.
+static bool FlushOutbound(int timeout)
+{
+	while (!outbound.IsEmpty())
+	{
+		if (!WaitWritable(serverPipe, timeout))
+			return false;
+
+		if (!outbound.Drain(serverPipe))
+		{
+			serverConnected = false;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Writes count records, spread over vectors and each ending at the vector
+// before recordEnds[k], with as few syscalls as possible. When the pipe is
+// full at a record boundary, waits up to timeout milliseconds for room and
+// then gives up on the remaining records, so a console that isn't reading
+// can't stall the writer (and the shared memory ring with it) for long. The
+// rest of a record that was only partly written goes to the outbound buffer
+// instead, giving up on it would desynchronize consumers; nothing else is
+// written until it is out, and it gets the same timeout as the lane. When
+// the memory budget has no room to hold it, the record is finished in place
+// for up to OUTBOUND_STALL_TIMEOUT, then dropped and its rest owed as
+// padding, so that framing holds without the writer waiting on a console
+// that stopped reading. Returns how many records were written, held or
+// padded.
+static size_t WriteVectors(iovec* vectors, size_t vectorCount, const size_t* recordEnds, size_t count, int timeout)
+{
+	size_t vector = 0;
+	size_t record = 0;
+	bool midRecord = false;
+	size_t stalledRecord = count;
+	uint64_t stalledSince = 0;
+	while (record != count)
+	{
+		if (!FlushOutbound(timeout))
+			return record;
+
+		ssize_t written;
+		{
+			xconsole::stats::ScopedTimer timer(xconsole::stats::STAGE_WRITE);
+			size_t end = midRecord ? recordEnds[record] : vectorCount;
+			written = writev(serverPipe, vectors + vector, static_cast<int>(end - vector));
+		}
+
+		xconsole::stats::Add(xconsole::stats::COUNTER_SYSCALLS);
+		if (written == -1)
+		{
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				xconsole::stats::Add(xconsole::stats::COUNTER_EAGAIN);
+				if (midRecord && outbound.Hold(vectors + vector, recordEnds[record] - vector))
+				{
+					xconsole::stats::Add(xconsole::stats::COUNTER_PARTIAL);
+					vector = recordEnds[record++];
+					midRecord = false;
+					if (record == count)
+						return count;
+
+					continue;
+				}
+
+				// without room for the rest of the record, it is finished in
+				// place for a while, then given up on but for its size
+				if (midRecord)
+				{
+					uint64_t now = xconsole::stats::Now();
+					if (stalledRecord != record)
+					{
+						stalledRecord = record;
+						stalledSince = now;
+					}
+
+					int waited = static_cast<int>((now - stalledSince) / 1000000);
+					if (waited < OUTBOUND_STALL_TIMEOUT && WaitWritable(serverPipe, OUTBOUND_STALL_TIMEOUT - waited))
+						continue;
+
+					outbound.Pad(vectors + vector, recordEnds[record] - vector);
+					xconsole::stats::Add(xconsole::stats::COUNTER_DROPS);
+					vector = recordEnds[record++];
+					midRecord = false;
+					if (record == count)
+						return count;
+
+					continue;
+				}
+				else if (WaitWritable(serverPipe, timeout))
+				{
+					continue;
+				}
+			}
+			else
+			{
+				serverConnected = false;
+			}
+
+			return record;
+		}
+
+		xconsole::stats::Add(xconsole::stats::COUNTER_BYTES, static_cast<uint64_t>(written));
+
+		size_t advance = static_cast<size_t>(written);
+		while (vector != vectorCount && advance >= vectors[vector].iov_len)
+		{
+			advance -= vectors[vector].iov_len;
+			++vector;
+		}
+
+		if (advance != 0)
+		{
+			vectors[vector].iov_base = static_cast<uint8_t*>(vectors[vector].iov_base) + advance;
+			vectors[vector].iov_len -= advance;
+		}
+
+		while (record != count && vector >= recordEnds[record])
+			++record;
+
+		size_t recordStart = record != 0 ? recordEnds[record - 1] : 0;
+		midRecord = record != count && (advance != 0 || vector != recordStart);
+	}
+
+	return count;
+}
+
+static bool WriteBuffer(const uint8_t* data, size_t size, int timeout)
+{
+	iovec vector = {const_cast<uint8_t*>(data), size};
+	const size_t end = 1;
+	return WriteVectors(&vector, 1, &end, 1, timeout) == 1;
+}
+#endif
+
+// Writes a batch of records, as they would be written in the current format,
+// as one compressed block: a varint with the size of the records, a varint
+// with the size of the payload, then the payload. A payload as large as the
+// records is stored as is. Compressing on the writer thread keeps it off the
+// logging threads. Returns false when the batch was dropped, also when its
+// buffers don't fit in the memory budget.
+static bool WriteBlock(const xconsole::EgressQueue::Entry* entries, size_t count, int timeout)
+{
+	uint8_t prefix[RECORD_PREFIX_MAX_SIZE];
+	size_t rawSize = 0;
+	for (size_t k = 0; k < count; ++k)
+		rawSize += EncodeRecordPrefix(entries[k], prefix) + (HasSpans(entries[k]) ? entries[k].spans : 0) + entries[k].size;
+
+	const size_t headerSize = 2 * MultiLibrary::Varint::MaxSize;
+	const size_t memory = rawSize + headerSize + xconsole::compression::Bound(rawSize);
+	if (!xconsole::memory::Acquire(xconsole::memory::SUBSYSTEM_TEMPORARY, memory))
+	{
+		xconsole::stats::Add(xconsole::stats::COUNTER_DROPS, count);
+		return false;
+	}
+
+	bool written;
+	{
+		std::vector<uint8_t> raw;
+		raw.reserve(rawSize);
+		for (size_t k = 0; k < count; ++k)
+		{
+			const uint8_t* data = entries[k].data;
+			const size_t size = entries[k].size;
+			raw.insert(raw.end(), prefix, prefix + EncodeRecordPrefix(entries[k], prefix));
+			if (HasSpans(entries[k]))
+				raw.insert(raw.end(), data + size, data + size + entries[k].spans);
+
+			raw.insert(raw.end(), data, data + size);
+		}
+
+		std::vector<uint8_t> block(headerSize + xconsole::compression::Bound(rawSize));
+		uint8_t* payload = block.data() + headerSize;
+		size_t payloadSize;
+		{
+			uint64_t start = xconsole::stats::Now();
+			payloadSize = xconsole::compression::Compress(raw.data(), rawSize, payload);
+			xconsole::stats::Add(xconsole::stats::COUNTER_COMPRESS_NS, xconsole::stats::Now() - start);
+		}
+
+		if (payloadSize >= rawSize)
+		{
+			std::memcpy(payload, raw.data(), rawSize);
+			payloadSize = rawSize;
+		}
+
+		// the header goes right in front of the payload
+		uint8_t header[headerSize];
+		size_t size = MultiLibrary::Varint::Encode(rawSize, header);
+		size += MultiLibrary::Varint::Encode(payloadSize, header + size);
+		std::memcpy(payload - size, header, size);
+
+		xconsole::stats::Add(xconsole::stats::COUNTER_COMPRESS_IN, rawSize);
+		xconsole::stats::Add(xconsole::stats::COUNTER_COMPRESS_OUT, size + payloadSize);
+		written = WriteBuffer(payload - size, size + payloadSize, timeout);
+	}
+
+	xconsole::memory::Release(xconsole::memory::SUBSYSTEM_TEMPORARY, memory);
+	if (!written)
+		xconsole::stats::Add(xconsole::stats::COUNTER_DROPS, count);
+
+	return written;
+}
+
+#ifdef _WIN32
+// Returns false when records were dropped.
+static bool WriteRecords(const xconsole::EgressQueue::Entry* entries, size_t count, int timeout)
+{
+	xconsole::EgressQueue::Entry kept[EGRESS_BATCH_SIZE];
+	entries = SelectWritten(entries, count, kept);
+	if (count == 0)
+		return true;
+
+	if (compressOutput)
+		return WriteBlock(entries, count, timeout);
+
+	static std::vector<uint8_t> frame;
+
+	// message mode pipes take one record per write
+	for (size_t k = 0; k < count; ++k)
+	{
+		const uint8_t* data = entries[k].data;
+		size_t size = entries[k].size;
+
+		uint8_t prefix[RECORD_PREFIX_MAX_SIZE];
+		size_t prefixSize = EncodeRecordPrefix(entries[k], prefix);
+		if (prefixSize != 0)
+		{
+			frame.assign(prefix, prefix + prefixSize);
+			if (HasSpans(entries[k]))
+				frame.insert(frame.end(), data + size, data + size + entries[k].spans);
+
+			frame.insert(frame.end(), data, data + size);
+			data = frame.data();
+			size = frame.size();
+		}
+
+		if (!WriteBuffer(data, size, timeout))
+			return false;
+	}
+
+	return true;
+}
+#else
+// Writes a batch of records, each behind its prefix for the current format,
+// see WriteVectors. Returns false when records were dropped.
+static bool WriteRecords(const xconsole::EgressQueue::Entry* entries, size_t count, int timeout)
+{
+	xconsole::EgressQueue::Entry kept[EGRESS_BATCH_SIZE];
+	entries = SelectWritten(entries, count, kept);
+	if (count == 0)
+		return true;
+
+	if (compressOutput)
+		return WriteBlock(entries, count, timeout);
+
+	iovec vectors[EGRESS_BATCH_SIZE * 3];
+	size_t recordEnds[EGRESS_BATCH_SIZE]; // one past the last vector of each record
+	uint8_t prefixes[EGRESS_BATCH_SIZE][RECORD_PREFIX_MAX_SIZE];
+	size_t vectorCount = 0;
+	for (size_t k = 0; k < count; ++k)
+	{
+		size_t prefixSize = EncodeRecordPrefix(entries[k], prefixes[k]);
+		if (prefixSize != 0)
+		{
+			vectors[vectorCount].iov_base = prefixes[k];
+			vectors[vectorCount].iov_len = prefixSize;
+			++vectorCount;
+		}
+
+		if (HasSpans(entries[k]))
+		{
+			vectors[vectorCount].iov_base = const_cast<uint8_t*>(entries[k].data + entries[k].size);
+			vectors[vectorCount].iov_len = entries[k].spans;
+			++vectorCount;
+		}
+
+		vectors[vectorCount].iov_base = const_cast<uint8_t*>(entries[k].data);
+		vectors[vectorCount].iov_len = entries[k].size;
+		recordEnds[k] = ++vectorCount;
+	}
+
+	size_t written = WriteVectors(vectors, vectorCount, recordEnds, count, timeout);
+	if (written == count)
+		return true;
+
+	xconsole::stats::Add(xconsole::stats::COUNTER_DROPS, static_cast<uint64_t>(count - written));
+	return false;
+}
+#endif
+
+// Replies to a request straight on the output pipe, bypassing the queue so
+// the reply lands exactly between the records written before and after it.
+// These replies have sequence number 0 and aren't kept in the scrollback.
+static void WriteReply(const std::string& reply)
+{
+	MultiLibrary::SegmentedBuffer buffer;
+	buffer <<
+		CONTROL_CHANNEL_ID <<
+		static_cast<int32_t>(0) <<
+		CONTROL_CHANNEL_NAME <<
+		static_cast<int32_t>(0) <<
+		reply.c_str();
+
+#ifndef _WIN32
+	buffer << EOL_SEQUENCE;
+#endif
+
+	const size_t size = static_cast<size_t>(buffer.Size());
+	if (!xconsole::memory::Acquire(xconsole::memory::SUBSYSTEM_TEMPORARY, size))
+		return;
+
+	{
+		std::vector<uint8_t> record(size);
+		buffer.CopyTo(record.data(), record.size());
+
+		xconsole::EgressQueue::Entry entry = {record.data(), record.size(), xconsole::stats::Now(), 0, xconsole::ticks::GetCurrent(), 0};
+		WriteRecords(&entry, 1, REPLAY_WRITE_TIMEOUT);
+	}
+
+	xconsole::memory::Release(xconsole::memory::SUBSYSTEM_TEMPORARY, size);
+}
+
+// Streams the records kept in the scrollback from sequence number from
+// onwards, as they were encoded.
+static void Replay(uint64_t from)
+{
+	// sequence numbers are contiguous, so this bounds how many records there are
+	uint64_t first = std::max(from, scrollback->First());
+	uint64_t last = scrollback->Last();
+	if (last == 0 || first > last)
+	{
+		WriteReply("replay none\n");
+		return;
+	}
+
+	const size_t memory = static_cast<size_t>(last - first + 1) * sizeof(xconsole::EgressQueue::Entry);
+	if (!xconsole::memory::Acquire(xconsole::memory::SUBSYSTEM_TEMPORARY, memory))
+	{
+		WriteReply("replay over memory budget\n");
+		return;
+	}
+
+	std::string reply;
+	{
+		std::vector<xconsole::EgressQueue::Entry> entries;
+		entries.reserve(static_cast<size_t>(last - first + 1));
+		scrollback->Collect(from, entries);
+		if (entries.empty())
+			reply = "replay none\n";
+		else
+			reply = "replay " + std::to_string(entries.front().sequence) + " " + std::to_string(entries.back().sequence) + "\n";
+
+		for (size_t k = 0; k < entries.size(); k += EGRESS_BATCH_SIZE)
+		{
+			if (!WriteRecords(&entries[k], std::min(EGRESS_BATCH_SIZE, entries.size() - k), REPLAY_WRITE_TIMEOUT))
+			{
+				reply = "replay aborted\n";
+				break;
+			}
+		}
+	}
+
+	xconsole::memory::Release(xconsole::memory::SUBSYSTEM_TEMPORARY, memory);
+	WriteReply(reply);
+}
+
+// Patterns one per line, none to stop filtering. The filter is compiled
+// right away, so it applies from the next record on.
+static void SetPipeFilter(const char* arguments)
+{
+	std::vector<xconsole::patterns::Pattern> patterns;
+	for (const char* line = arguments; *line != '\0'; )
+	{
+		const char* end = std::strchr(line, '\n');
+		if (end == nullptr)
+			end = line + std::strlen(line);
+
+		if (end != line)
+			patterns.push_back(xconsole::patterns::Parse(std::string(line, end)));
+
+		line = *end != '\0' ? end + 1 : end;
+	}
+
+	xconsole::patterns::Unregister(pipeFilter);
+	pipeFilter = -1;
+	if (!patterns.empty())
+	{
+		int owner = xconsole::patterns::Register(patterns);
+		if (owner < 0)
+		{
+			WriteReply(owner == xconsole::patterns::REGISTER_OVER_BUDGET ? "filter over memory budget\n" : "too many patterns\n");
+			return;
+		}
+
+		pipeFilter = owner;
+	}
+
+	if (!xconsole::patterns::Compile())
+	{
+		xconsole::patterns::Unregister(pipeFilter);
+		pipeFilter = -1;
+		WriteReply("filter over memory budget\n");
+		return;
+	}
+
+	WriteReply(pipeFilter < 0 ? "filter off\n" : "filter " + std::to_string(patterns.size()) + "\n");
+}
+
+static void ServeWriterRequest(const std::string& request)
+{
+	unsigned long long value = 0;
+	if (std::sscanf(request.c_str(), "format %llu", &value) == 1)
+	{
+		if (value < 1 || value > OUTPUT_FORMAT_MAX)
+		{
+			WriteReply("unsupported format\n");
+			return;
+		}
+
+		// the reply is the last record in the previous format
+		WriteReply("format " + std::to_string(value) + "\n");
+		outputFormat = static_cast<int>(value);
+	}
+	else if (request == "compress on" || request == "compress off")
+	{
+		// the reply is the last record sent the previous way
+		WriteReply(request + "\n");
+		compressOutput = request == "compress on";
+	}
+	else if (request == "filter" || request.rfind("filter\n", 0) == 0)
+	{
+		SetPipeFilter(request.c_str() + 6);
+	}
+	else if (scrollback == nullptr)
+	{
+		WriteReply("replay disabled\n");
+	}
+	else if (std::sscanf(request.c_str(), "replay last %llu", &value) == 1)
+	{
+		uint64_t last = scrollback->Last();
+		Replay(value < last ? last - value + 1 : 1);
+	}
+	else if (std::sscanf(request.c_str(), "replay after %llu", &value) == 1)
+	{
+		Replay(value + 1);
+	}
+	else
+	{
+		WriteReply("unknown request\n");
+	}
+}
+
+static const char* GetChannelName(int32_t channelID, char* buffer, size_t size)
+{
+#if ARCHITECTURE_IS_X86_64
+	const CLoggingSystem::LoggingChannel_t* chan = LoggingSystem_GetChannel(channelID);
+	if (chan != nullptr)
+		return chan->m_Name;
+#endif
+
+	std::snprintf(buffer, size, "%d", channelID);
+	return buffer;
+}
+
+static void SendSamplingSummaries(uint64_t now)
+{
+	if (now - lastSamplingSummary < SAMPLING_SUMMARY_INTERVAL)
+		return;
+
+	lastSamplingSummary = now;
+
+	static std::vector<xconsole::sampling::Summary> summaries;
+	summaries.clear();
+	xconsole::sampling::Collect(summaries);
+	for (const xconsole::sampling::Summary& summary : summaries)
+	{
+		char name[16];
+		char message[256];
+		std::snprintf(message, sizeof(message), "%s: sampled %llu of %llu records, keeping 1 in %u over budget\n",
+			GetChannelName(summary.channel, name, sizeof(name)),
+			static_cast<unsigned long long>(summary.kept),
+			static_cast<unsigned long long>(summary.seen),
+			summary.ratio);
+		SubmitRecord(SAMPLING_CHANNEL_ID, 0, SAMPLING_CHANNEL_NAME, 0, message, nullptr, 0, now, xconsole::ticks::GetCurrent(), xconsole::LANE_LOW);
+	}
+}
+
+static void ServeWriterRequests()
+{
+	std::vector<std::string> requests;
+	{
+		std::lock_guard<std::mutex> lock(writerRequestsMutex);
+		requests.swap(writerRequests);
+	}
+
+	for (const std::string& request : requests)
+		ServeWriterRequest(request);
+}
+
+// Sends a batch peeked from lane out to the scrollback, the shared memory
+// ring and the pipe, then pops it.
+static void SendBatch(xconsole::EgressQueue::Entry* entries, size_t count, xconsole::Lane lane, int timeout)
+{
+	for (size_t k = 0; k < count; ++k)
+	{
+		entries[k].sequence = nextSequence++;
+		if (scrollback != nullptr)
+			scrollback->Append(entries[k]);
+	}
+
+	if (xconsole::stats::IsEnabled())
+	{
+		uint64_t now = xconsole::stats::Now();
+		xconsole::stats::Stage stage = lane == xconsole::LANE_HIGH ? xconsole::stats::STAGE_QUEUE_WAIT_HIGH : xconsole::stats::STAGE_QUEUE_WAIT;
+		for (size_t k = 0; k < count; ++k)
+			xconsole::stats::Record(stage, now - entries[k].timestamp);
+	}
+
+#ifndef _WIN32
+	if (sharedRing.IsOpen())
+	{
+		const size_t skipped = sharedRing.Publish(entries, count);
+		if (skipped != 0)
+			xconsole::stats::Add(xconsole::stats::COUNTER_RING_SKIPPED, skipped);
+	}
+
+	if (!pipeOutput)
+	{
+		egressQueue->Pop(lane, count);
+		return;
+	}
+#endif
+
+	WriteRecords(entries, count, timeout);
+	egressQueue->Pop(lane, count);
+}
+
+static void WriterThread()
+{
+	xconsole::EgressQueue::Entry entries[EGRESS_BATCH_SIZE];
+	while (!writerShutdown)
+	{
+		ServeWriterRequests();
+
+		// filters added since are compiled here, off the threads that log
+		xconsole::patterns::Compile();
+
+		// partial lines are sent on their own once they time out, check on
+		// them more often while there are any
+		uint64_t now = xconsole::stats::Now();
+		bool linesPending = xconsole::lines::Flush(now, false, SubmitLine);
+		SendSamplingSummaries(now);
+
+		int wait = linesPending ? LINE_FLUSH_INTERVAL : 100;
+#ifndef _WIN32
+		// the rest of a partly written record goes out as soon as the pipe
+		// has room, not only when the next records come
+		if (!FlushOutbound(0))
+			wait = std::min(wait, OUTBOUND_POLL_INTERVAL);
+#endif
+
+		xconsole::Lane lane;
+		size_t count = egressQueue->Peek(entries, EGRESS_BATCH_SIZE, std::chrono::milliseconds(wait), lane);
+		if (count != 0)
+			SendBatch(entries, count, lane, EGRESS_WRITE_TIMEOUTS[lane]);
+	}
+
+	// what was queued while shutting down, like the rest of partial lines
+	// and the last replies, still goes out, as far as the pipe takes it
+	// without waiting
+	xconsole::Lane lane;
+	while (size_t count = egressQueue->Peek(entries, EGRESS_BATCH_SIZE, std::chrono::milliseconds(0), lane))
+		SendBatch(entries, count, lane, 0);
+
+#ifndef _WIN32
+	FlushOutbound(0);
+#endif
+}
+
+// "default <rate> [burst]", "<channel> <rate> [burst]" or "<channel> default"
+static bool SetBudget(const char* arguments)
+{
+	char channel[64];
+	char rate[32];
+	double burst = 0;
+	int fields = std::sscanf(arguments, "%63s %31s %lf", channel, rate, &burst);
+	if (fields < 2)
+		return false;
+
+	bool isDefault = std::strcmp(rate, "default") == 0;
+	char* end = nullptr;
+	double value = std::strtod(rate, &end);
+	if (!isDefault && (*end != '\0' || value < 0))
+		return false;
+
+	xconsole::sampling::Budget budget = {value, fields == 3 ? burst : value};
+	if (!isDefault && !xconsole::sampling::IsValid(budget))
+		return false;
+
+	if (std::strcmp(channel, "default") == 0)
+		return !isDefault && xconsole::sampling::SetDefaultBudget(budget);
+
+
+	int32_t channelID;
+	if (!xconsole::FindChannel(channel, channelID))
+		return false;
+
+	return isDefault ? xconsole::sampling::ClearBudget(channelID) : xconsole::sampling::SetBudget(channelID, budget);
+}
+
+// "prefix <text> [limit]" or "find <text> [limit]", answered from the cvar
+// index so the game thread isn't involved.
+static void QueryCvars(const char* query, std::string& reply)
+{
+	char mode[8];
+	char text[256];
+	unsigned long long limit = xconsole::cvars::DEFAULT_QUERY_LIMIT;
+	if (std::sscanf(query, "%7s %255s %llu", mode, text, &limit) < 2 || (std::strcmp(mode, "prefix") != 0 && std::strcmp(mode, "find") != 0))
+	{
+		reply = "invalid cvars query\n";
+		return;
+	}
+
+	if (!xconsole::cvars::Query(text, std::strcmp(mode, "prefix") == 0, static_cast<size_t>(limit), reply))
+		reply = "cvars unavailable\n";
+}
+
+static void HandleControlRequest(const std::string& request)
+{
+	std::string reply;
+	unsigned long long value = 0;
+	if (request == "stats")
+	{
+		xconsole::stats::Format(reply);
+		xconsole::memory::Format(reply);
+	}
+	else if (request == "stats reset")
+	{
+		xconsole::stats::Reset();
+		reply = "ok\n";
+	}
+	else if (request == "stats on" || request == "stats off")
+	{
+		xconsole::stats::SetEnabled(request == "stats on");
+		reply = "ok\n";
+	}
+	else if (request == "ticks on" || request == "ticks off")
+	{
+		xconsole::ticks::SetTelemetryEnabled(request == "ticks on");
+		reply = "ok\n";
+	}
+	else if (std::sscanf(request.c_str(), "hitch %llu", &value) == 1)
+	{
+		xconsole::ticks::SetHitchThreshold(value * 1000000);
+		reply = "ok\n";
+	}
+	else if (request.rfind("budget ", 0) == 0)
+	{
+		reply = SetBudget(request.c_str() + 7) ? "ok\n" : "invalid budget\n";
+	}
+	else if (request.rfind("cvars ", 0) == 0)
+	{
+		QueryCvars(request.c_str() + 6, reply);
+	}
+	else if (request.rfind("watch ", 0) == 0)
+	{
+		reply = xconsole::watches::Request(request.substr(6), true) ? "ok\n" : "too many watches\n";
+	}
+	else if (request == "unwatch" || request.rfind("unwatch ", 0) == 0)
+	{
+		reply = xconsole::watches::Request(request.substr(7), false) ? "ok\n" : "too many watches\n";
+	}
+	else if (request == "status" || request.rfind("status ", 0) == 0)
+	{
+		// answered from the game thread at the next tick
+		if (xconsole::status::Request(request.size() > 7 ? request.substr(7) : std::string()))
+			return;
+
+		reply = "status request refused\n";
+	}
+	else if (request.rfind("format ", 0) == 0 || request.rfind("replay ", 0) == 0 || request.rfind("compress ", 0) == 0 || request == "filter" || request.rfind("filter\n", 0) == 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(writerRequestsMutex);
+			writerRequests.push_back(request);
+		}
+
+		egressQueue->Wake();
+		return;
+	}
+	else if (request == "capture off")
+	{
+		reply = "capture off " + std::to_string(xconsole::capture::Stop()) + "\n";
+	}
+	else if (request.rfind("capture ", 0) == 0)
+	{
+		reply = xconsole::capture::StartNamed(request.substr(8), xconsole::stats::Now()) ? "capture on\n" : "capture failed\n";
+	}
+	else
+	{
+		reply = "unknown request\n";
+	}
+
+	SubmitRecord(CONTROL_CHANNEL_ID, 0, CONTROL_CHANNEL_NAME, 0, reply.c_str(), nullptr, 0, xconsole::stats::Now(), xconsole::ticks::GetCurrent(), xconsole::LANE_NORMAL);
+}
+
+static void RunCommand(std::string cmd)
+{
+	if (cmd.empty())
+		return;
+
+	// capture requests stay out of the capture they control
+	if (xconsole::capture::IsActive() && cmd.rfind(CAPTURE_REQUEST, 0) != 0)
+		xconsole::capture::Record(xconsole::stats::Now(), clientID, cmd.data(), cmd.size());
+
+	if (cmd[0] == CONTROL_REQUEST_PREFIX)
+	{
+		HandleControlRequest(cmd.substr(1));
+		return;
+	}
+
+	// in case the command hasnt been passed with a newline
+	if (cmd[cmd.length() - 1] != '\n')
+		cmd.append("\n");
+
+	engineServer->ServerCommand(cmd.c_str());
+}
+
+// Reserves the largest power of two size, plus overhead, between minimum
+// and wanted (rounded up) that the memory budget allows. Returns 0 if none.
+static size_t ReservePowerOfTwo(xconsole::memory::Subsystem subsystem, size_t wanted, size_t minimum, size_t overhead)
+{
+	size_t size = minimum;
+	while (size < wanted)
+		size <<= 1;
+
+	for (; size >= minimum; size >>= 1)
+		if (xconsole::memory::Acquire(subsystem, size + overhead))
+			return size;
+
+	return 0;
+}
+
+// Sizes the long lived buffers within the memory budget, from the highest
+// priority down: egress lanes, shared memory ring, then the scrollback,
+// which shrinks or goes away first.
+static bool ReserveMemory(const xconsole::Options& options, size_t* laneSizes, size_t& sharedRingSize, size_t& scrollbackSize, const char*& error)
+{
+	xconsole::memory::Configure(options.memoryLimit);
+	xconsole::memory::SetQuota(xconsole::memory::SUBSYSTEM_EGRESS, options.egressQueueSize);
+	xconsole::memory::SetQuota(xconsole::memory::SUBSYSTEM_PATTERNS, PATTERNS_MEMORY_QUOTA);
+	xconsole::memory::SetQuota(xconsole::memory::SUBSYSTEM_LINES, LINES_MEMORY_QUOTA);
+	xconsole::memory::SetQuota(xconsole::memory::SUBSYSTEM_CVARS, CVARS_MEMORY_QUOTA);
+	xconsole::memory::SetQuota(xconsole::memory::SUBSYSTEM_STATUS, STATUS_MEMORY_QUOTA);
+	xconsole::memory::SetQuota(xconsole::memory::SUBSYSTEM_TEMPORARY, TEMPORARY_MEMORY_QUOTA);
+
+	egressMemory = 0;
+	for (int k = 0; k < xconsole::LANE_COUNT; ++k)
+	{
+		size_t wanted = k != xconsole::LANE_LOW ? options.egressQueueSize / EGRESS_LANE_SHARE : options.egressQueueSize - egressMemory;
+		laneSizes[k] = xconsole::memory::Reserve(xconsole::memory::SUBSYSTEM_EGRESS, wanted, EGRESS_LANE_MIN_SIZE);
+		if (laneSizes[k] == 0)
+		{
+			error = "memory limit too low for the egress queue";
+			return false;
+		}
+
+		egressMemory += laneSizes[k];
+	}
+
+	sharedRingSize = 0;
+	sharedRingMemory = 0;
+#ifndef _WIN32
+	if (options.sharedMemorySize != 0)
+	{
+		sharedRingSize = ReservePowerOfTwo(xconsole::memory::SUBSYSTEM_SHARED_RING, options.sharedMemorySize, RING_MIN_SIZE, xconsole::SHARED_RING_DATA_OFFSET);
+		if (sharedRingSize == 0)
+		{
+			error = "memory limit too low for the shared memory ring";
+			return false;
+		}
+
+		sharedRingMemory = sharedRingSize + xconsole::SHARED_RING_DATA_OFFSET;
+	}
+#endif
+
+	scrollbackSize = 0;
+	if (options.scrollbackSize != 0)
+		scrollbackSize = ReservePowerOfTwo(xconsole::memory::SUBSYSTEM_SCROLLBACK, options.scrollbackSize, RING_MIN_SIZE, 0);
+
+	scrollbackMemory = scrollbackSize;
+	return true;
+}
+
+#ifdef _WIN32
+static void ReadIncomingCommands()
+{
+	MultiLibrary::ByteBuffer buffer;
+	buffer.Reserve(255);
+	buffer.Resize(255);
+
+	if (ReadFile(serverPipe, buffer.GetBuffer(), static_cast<DWORD>(buffer.Size()), nullptr, nullptr) == TRUE)
+	{
+		if (buffer.Size() == 0) return;
+
+		std::string cmd;
+		buffer >> cmd;
+		RunCommand(cmd);
+	}
+}
+
+static void ServerThread()
+{
+	while (!serverShutdown)
+	{
+		if (ConnectNamedPipe(serverPipe, nullptr) == FALSE)
+		{
+			DWORD error = GetLastError();
+			if (error == ERROR_NO_DATA)
+			{
+				DisconnectNamedPipe(serverPipe);
+				serverConnected = false;
+			}
+			else if (error == ERROR_PIPE_CONNECTED) {
+				if (!serverConnected)
+					++clientID;
+
+				serverConnected = true;
+				ReadIncomingCommands();
+			}
+		}
+		else
+		{
+			if (!serverConnected)
+				++clientID;
+
+			serverConnected = true;
+			ReadIncomingCommands();
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+}
+#else
+static void ServerThread()
+{
+	std::vector<uint8_t> dataBuffer;
+	std::vector<uint8_t> buffer(255);
+
+	size_t eolIndex = 0;
+	while (!serverShutdown && serverPipeIn != -1)
+	{
+		int bytesRead = read(serverPipeIn, buffer.data(), buffer.size() - 1);
+		if (bytesRead > 0)
+		{
+			for (int i = 0; i < bytesRead; i++)
+			{
+				uint8_t currentByte = buffer[i];
+				dataBuffer.push_back(currentByte);
+
+				// Check if the current byte matches the next byte in the EOL sequence
+				if (currentByte == EOL_SEQUENCE[eolIndex])
+				{
+					eolIndex++;
+					if (eolIndex == std::strlen(EOL_SEQUENCE)) // Full EOL found
+					{
+						dataBuffer.erase(dataBuffer.end() - eolIndex, dataBuffer.end());
+
+						std::string cmd(dataBuffer.begin(), dataBuffer.end());
+						RunCommand(cmd);
+
+						dataBuffer.clear();
+						eolIndex = 0;
+					}
+				}
+				else
+				{
+					eolIndex = 0;
+				}
+			}
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+}
+
+static int CreateNamedPipe(const char* pipeName, const char*& error)
+{
+	struct stat sb;
+	if (stat(pipeName, &sb) == 0 && !(sb.st_mode & S_IFDIR))
+	{
+		unlink(pipeName);
+	}
+
+   	if (mkfifo(pipeName, 0666) == -1)
+	{
+		error = "failed to create named pipe (mkfifo)";
+		return -1;
+	}
+	else
+	{
+		int pipe = open(pipeName, O_RDWR | O_NONBLOCK);
+		if (pipe == -1)
+		{
+			error = "failed to create named pipe (open)";
+		}
+
+		serverConnected = pipe != -1;
+		return pipe;
+	}
+}
+#endif
+
+namespace xconsole
+{
+
+bool Initialize(IVEngineServer* engine, const Options& options, const char*& error)
+{
+	engineServer = engine;
+	pipeOutput = options.pipeOutput;
+
+	// endpoints of a live server are never taken over, unlike those left
+	// behind by one that crashed, and they are claimed before the pipes are
+	// opened so two servers starting at once can't both get them
+	serverEndpoints = xconsole::endpoints::Resolve(options.endpointName);
+	uint32_t owner;
+	if (!xconsole::endpoints::Claim(serverEndpoints, owner))
+	{
+		error = "endpoints in use by another server, give each one its own with -xconsole_endpoint";
+		return false;
+	}
+
+#ifdef _WIN32
+	SECURITY_DESCRIPTOR sd;
+	InitializeSecurityDescriptor(&sd, SECURITY_DESCRIPTOR_REVISION);
+	SetSecurityDescriptorDacl(&sd, TRUE, nullptr, FALSE);
+
+	SECURITY_ATTRIBUTES sa;
+	sa.nLength = sizeof(sa);
+	sa.lpSecurityDescriptor = &sd;
+	sa.bInheritHandle = FALSE;
+
+	serverPipe = CreateNamedPipe(
+		serverEndpoints.pipe.c_str(),
+		PIPE_ACCESS_DUPLEX,
+		PIPE_TYPE_MESSAGE | PIPE_NOWAIT,
+		PIPE_UNLIMITED_INSTANCES,
+		16384,
+		16384,
+		NMPWAIT_USE_DEFAULT_WAIT,
+		&sa
+	);
+
+	if (serverPipe == INVALID_HANDLE_VALUE)
+	{
+		error = "failed to create named pipe";
+		return false;
+	}
+#else
+	serverPipe = CreateNamedPipe(serverEndpoints.output.c_str(), error);
+	if (serverPipe == -1)
+		return false;
+
+	serverPipeIn = CreateNamedPipe(serverEndpoints.input.c_str(), error);
+	if (serverPipeIn == -1)
+		return false;
+
+#endif
+
+	size_t laneSizes[xconsole::LANE_COUNT];
+	size_t sharedRingSize;
+	size_t scrollbackSize;
+	if (!ReserveMemory(options, laneSizes, sharedRingSize, scrollbackSize, error))
+		return false;
+
+#ifndef _WIN32
+	if (sharedRingSize != 0 && !sharedRing.Create(serverEndpoints.ring.c_str(), sharedRingSize, error))
+		return false;
+#endif
+
+	if (!options.capturePath.empty() && !xconsole::capture::Start(options.capturePath, xconsole::stats::Now()))
+	{
+		error = "failed to create the capture file";
+		return false;
+	}
+
+	serverShutdown = false;
+	writerShutdown = false;
+	outputFormat = 1;
+	compressOutput = false;
+	pipeFilter = -1;
+	nextSequence = 1;
+	lastSamplingSummary = 0;
+	xconsole::ticks::Reset();
+	xconsole::sampling::Reset();
+	xconsole::lines::Reset();
+	xconsole::lines::SetTimeout(options.lineTimeout);
+	xconsole::sampling::SetDefaultBudget({options.channelBudget, options.channelBurst});
+	xconsole::ticks::SetHitchThreshold(options.hitchThreshold);
+	xconsole::ticks::SetTelemetryEnabled(options.tickTelemetry);
+	writerRequests.clear();
+	if (scrollbackSize != 0)
+		scrollback = new xconsole::Scrollback(scrollbackSize);
+
+	egressQueue = new xconsole::EgressQueue(laneSizes);
+	writerThread = std::thread(WriterThread);
+	serverThread = std::thread(ServerThread);
+
+	// collectors find the instance from here on, failing that only costs them
+	// discovering it
+	xconsole::endpoints::Publish(serverEndpoints, options.port, sharedRingSize != 0);
+
+	xconsole::LoggingApi::Install<LogRecord>();
+	return true;
+}
+
+bool Emit(const char* name, const events::Encoder& event)
+{
+	uint64_t start = stats::Now();
+	size_t size = SubmitEvent(name, event, start, ticks::GetCurrent(), LANE_LOW);
+	ticks::AddRecord(size, stats::Now() - start);
+	return size != 0;
+}
+
+void SendCvar(const char* name, const char* value)
+{
+	std::string message(value);
+	message += '\n';
+	SubmitRecord(CVAR_CHANNEL_ID, 0, name, 0, message.c_str(), nullptr, 0, stats::Now(), ticks::GetCurrent(), LANE_NORMAL);
+}
+
+void SendStatus(const events::Encoder& answer)
+{
+	SubmitEvent(STATUS_EVENT_NAME, answer, stats::Now(), ticks::GetCurrent(), LANE_NORMAL);
+}
+
+bool FindChannel(const char* name, int32_t& channel)
+{
+	char* end = nullptr;
+	long id = std::strtol(name, &end, 10);
+	if (end != name && *end == '\0')
+	{
+		channel = static_cast<int32_t>(id);
+		return true;
+	}
+
+#if ARCHITECTURE_IS_X86_64
+	LoggingChannelID_t found = LoggingSystem_FindChannel(name);
+	if (found != INVALID_LOGGING_CHANNEL_ID)
+	{
+		channel = static_cast<int32_t>(found);
+		return true;
+	}
+#endif
+
+	return false;
+}
+
+void Tick(uint32_t tick)
+{
+	uint64_t now = stats::Now();
+	ticks::Frame frame;
+	if (!ticks::Advance(tick, now, frame) || (!frame.hitch && !ticks::IsTelemetryEnabled()))
+		return;
+
+	std::string message;
+	ticks::Format(frame, message);
+	SubmitRecord(TICK_CHANNEL_ID, frame.hitch ? HITCH_SEVERITY : 0, TICK_CHANNEL_NAME, 0, message.c_str(), nullptr, 0, now, tick, frame.hitch ? LANE_NORMAL : LANE_LOW);
+}
+
+void Shutdown()
+{
+	xconsole::LoggingApi::Uninstall();
+	xconsole::endpoints::Unpublish(serverEndpoints);
+
+	// whatever is left of partial lines goes out before the writer stops
+	if (egressQueue != nullptr)
+		xconsole::lines::Flush(xconsole::stats::Now(), true, SubmitLine);
+
+	xconsole::subscriptions::Reset();
+	xconsole::watches::Reset();
+	xconsole::status::Reset();
+
+	serverShutdown = true;
+	if (serverThread.joinable())
+		serverThread.join();
+
+	xconsole::capture::Stop();
+
+	// the writer only stops once nothing else queues records, and drains the
+	// queue before it does
+	writerShutdown = true;
+	if (writerThread.joinable())
+	{
+		egressQueue->Wake();
+		writerThread.join();
+	}
+
+	xconsole::patterns::Reset();
+	xconsole::cvars::Reset();
+
+	delete egressQueue;
+	egressQueue = nullptr;
+	xconsole::memory::Release(xconsole::memory::SUBSYSTEM_EGRESS, egressMemory);
+	egressMemory = 0;
+
+	delete scrollback;
+	scrollback = nullptr;
+	xconsole::memory::Release(xconsole::memory::SUBSYSTEM_SCROLLBACK, scrollbackMemory);
+	scrollbackMemory = 0;
+
+#ifdef _WIN32
+	if (serverPipe != INVALID_HANDLE_VALUE)
+	{
+		FlushFileBuffers(serverPipe);
+		DisconnectNamedPipe(serverPipe);
+		CloseHandle(serverPipe);
+		serverPipe = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (serverPipe != -1)
+	{
+		close(serverPipe);
+		unlink(serverEndpoints.output.c_str());
+		serverPipe = -1;
+	}
+
+	if (serverPipeIn != -1)
+	{
+		close(serverPipeIn);
+		unlink(serverEndpoints.input.c_str());
+		serverPipeIn = -1;
+	}
+
+	outbound.Clear();
+	sharedRing.Destroy();
+#endif
+
+	xconsole::memory::Release(xconsole::memory::SUBSYSTEM_SHARED_RING, sharedRingMemory);
+	sharedRingMemory = 0;
+
+	serverConnected = false;
+}
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+class IVEngineServer;
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace xconsole
+{
+
+namespace events
+{
+class Encoder;
+}
+
+struct Options
+{
+	// Name the pipes and the shared memory ring are derived from, unique to
+	// each server on a host: /tmp/<name> and /tmp/<name>_in, /<name> for the
+	// ring, \\.\pipe\<name> on Windows.
+	std::string endpointName = "garrysmod_console";
+
+	// Game port, listed in the discovery file along with the endpoints.
+	int32_t port = 0;
+
+	// How long in nanoseconds a line printed in several fragments waits for
+	// its newline before the part logged so far is sent anyway, 0 sends every
+	// fragment as its own record.
+	uint64_t lineTimeout = 20000000;
+
+	// Cap in bytes on the memory held by all of the module's buffers. They
+	// are sized within it in priority order: the egress queue, the shared
+	// memory ring, then the scrollback, which shrinks first.
+	size_t memoryLimit = 32 * 1024 * 1024;
+
+	// Size in bytes of the egress queue, over all its lanes.
+	size_t egressQueueSize = 6 * 1024 * 1024;
+
+	// Size in bytes of the shared memory ring published at
+	// /dev/shm/<endpoint name>, 0 disables it. Ignored on Windows.
+	size_t sharedMemorySize = 0;
+
+	// Write records to the output pipe. Turning it off only makes sense with
+	// the shared memory ring on, commands are still read from the input pipe.
+	// Ignored on Windows.
+	bool pipeOutput = true;
+
+	// Size in bytes of the in-memory scrollback of recent records that
+	// consoles can ask to replay, 0 disables it.
+	size_t scrollbackSize = 1024 * 1024;
+
+	// File every command received from consoles is recorded to, for the
+	// replay tool, empty disables it.
+	std::string capturePath;
+
+	// Ticks longer than this many nanoseconds are reported as hitches, 0
+	// disables hitch detection.
+	uint64_t hitchThreshold = 100000000;
+
+	// Send a telemetry record for every tick, not just for hitches.
+	bool tickTelemetry = false;
+
+	// Default per-channel budget, in records per second on average and in
+	// a row. Channels over it get sampled, 0 disables sampling.
+	double channelBudget = 1000;
+	double channelBurst = 2000;
+};
+
+// Creates the console endpoints, starts the server thread and hooks into the
+// engine logging system. Commands received from consoles are run through
+// engineServer. On failure, returns false and points error to a description.
+bool Initialize(IVEngineServer* engineServer, const Options& options, const char*& error);
+
+// Queues a structured event under name, bypassing the engine logging system.
+// Consoles get it as a record on the event pseudo channel once they switch
+// to format 5. Returns false when it was dropped.
+bool Emit(const char* name, const events::Encoder& event);
+
+// Sends the value of a watched convar to consoles, on the convar pseudo
+// channel under its name. Called from the game thread.
+void SendCvar(const char* name, const char* value);
+
+// Sends the answer to a status request as an event, in the same lane as
+// replies. Called from the game thread.
+void SendStatus(const events::Encoder& answer);
+
+// Looks up a logging channel id by name or number. On x86 builds channels
+// are spew types, which can only be given by number.
+bool FindChannel(const char* name, int32_t& channel);
+
+// Called from the game thread at the start of every server tick. Records
+// logged from now on are stamped with this tick number, and the totals of
+// the previous tick are checked for a hitch and sent as telemetry.
+void Tick(uint32_t tick);
+
+// Unhooks from the engine logging system, stops the server thread and removes
+// the console endpoints. Safe to call after a failed Initialize.
+void Shutdown();
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include <Cvars.hpp>
+
+#include <Memory.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+namespace xconsole
+{
+
+namespace cvars
+{
+
+// Entry as the game thread last saw it, along with the refresh that did.
+struct Known
+{
+	Entry entry;
+	uint32_t pass;
+};
+
+// only touched by the game thread
+static std::unordered_map<std::string, Known> known;
+static size_t knownMemory = 0;
+static uint32_t pass = 1;
+static bool changed = false;
+static uint64_t refreshed = 0;
+
+static std::shared_ptr<const Index> current;
+
+static std::string ToLower(const char* text)
+{
+	std::string lower(text);
+	for (char& character : lower)
+		character = static_cast<char>(std::tolower(static_cast<unsigned char>(character)));
+
+	return lower;
+}
+
+// Tabs and newlines separate the fields and entries of a reply.
+static void AppendField(std::string& reply, const std::string& text)
+{
+	for (char character : text)
+		reply += character == '\t' || character == '\n' || character == '\r' ? ' ' : character;
+}
+
+static void AppendEntry(std::string& reply, const Entry& entry)
+{
+	reply += entry.name;
+	reply += entry.command ? "\tcommand\t" : "\tcvar\t";
+	reply += std::to_string(entry.flags);
+	reply += '\t';
+	AppendField(reply, entry.value);
+	reply += '\t';
+	AppendField(reply, entry.help);
+	reply += '\n';
+}
+
+static size_t GetSize(const Entry& entry)
+{
+	return sizeof(Entry) + entry.key.size() + entry.name.size() + entry.value.size() + entry.help.size();
+}
+
+// An entry of known holds its key twice, and costs a node and a bucket.
+static size_t GetKnownSize(const Entry& entry)
+{
+	return GetSize(entry) + sizeof(Known) - sizeof(Entry) + sizeof(std::string) + entry.key.size() + 2 * sizeof(void*);
+}
+
+bool IsDue(uint64_t now)
+{
+	return refreshed == 0 || now - refreshed >= REFRESH_INTERVAL;
+}
+
+void Update(const char* name, bool command, int32_t flags, const char* value, const char* help)
+{
+	// entries that don't fit in the memory budget are left out of the index
+	std::string key = ToLower(name);
+	auto found = known.find(key);
+	if (found == known.end())
+	{
+		Entry entry{key, name, command, flags, value, help};
+		const size_t size = GetKnownSize(entry);
+		if (!memory::Acquire(memory::SUBSYSTEM_CVARS, size))
+			return;
+
+		knownMemory += size;
+		known.emplace(key, Known{std::move(entry), pass});
+		changed = true;
+		return;
+	}
+
+	// most refreshes find most entries unchanged, those cost a lookup and a
+	// few comparisons
+	Known& entry = found->second;
+	entry.pass = pass;
+	if (entry.entry.command != command || entry.entry.flags != flags || entry.entry.value != value || entry.entry.help != help || entry.entry.name != name)
+	{
+		Entry updated{key, name, command, flags, value, help};
+		const size_t before = GetKnownSize(entry.entry);
+		const size_t after = GetKnownSize(updated);
+		changed = true;
+		if (after > before && !memory::Acquire(memory::SUBSYSTEM_CVARS, after - before))
+		{
+			memory::Release(memory::SUBSYSTEM_CVARS, before);
+			knownMemory -= before;
+			known.erase(found);
+			return;
+		}
+
+		if (after < before)
+			memory::Release(memory::SUBSYSTEM_CVARS, before - after);
+
+		knownMemory += after;
+		knownMemory -= before;
+		entry.entry = std::move(updated);
+	}
+}
+
+void Commit(uint64_t now)
+{
+	for (auto entry = known.begin(); entry != known.end(); )
+	{
+		if (entry->second.pass != pass)
+		{
+			const size_t size = GetKnownSize(entry->second.entry);
+			memory::Release(memory::SUBSYSTEM_CVARS, size);
+			knownMemory -= size;
+			entry = known.erase(entry);
+			changed = true;
+		}
+		else
+		{
+			++entry;
+		}
+	}
+
+	// the first refresh publishes an index even when nothing is registered,
+	// one that doesn't fit in the memory budget is tried again next refresh
+	bool published = true;
+	if (changed || std::atomic_load(&current) == nullptr)
+	{
+		size_t size = 0;
+		for (const auto& entry : known)
+			size += GetSize(entry.second.entry);
+
+		published = memory::Acquire(memory::SUBSYSTEM_CVARS, size);
+		if (published)
+		{
+			std::unique_ptr<Index> index(new Index());
+			index->reserve(known.size());
+			for (const auto& entry : known)
+				index->push_back(entry.second.entry);
+
+			std::sort(index->begin(), index->end(), [](const Entry& left, const Entry& right) {
+				return left.key < right.key;
+			});
+
+			// given back when the last query using it is done
+			std::shared_ptr<const Index> shared(index.release(), [size](const Index* index) {
+				delete index;
+				memory::Release(memory::SUBSYSTEM_CVARS, size);
+			});
+
+			std::atomic_store(&current, shared);
+		}
+	}
+
+	++pass;
+	changed = !published;
+	refreshed = now != 0 ? now : 1;
+}
+
+std::shared_ptr<const Index> GetIndex()
+{
+	return std::atomic_load(&current);
+}
+
+bool Query(const std::string& text, bool prefix, size_t limit, std::string& reply)
+{
+	std::shared_ptr<const Index> index = GetIndex();
+	if (index == nullptr)
+		return false;
+
+	const std::string key = ToLower(text.c_str());
+	limit = std::min(limit, MAX_QUERY_LIMIT);
+
+	std::string entries;
+	size_t shown = 0;
+	size_t matched = 0;
+	if (prefix)
+	{
+		// names sharing a prefix are next to each other in the index
+		auto first = std::lower_bound(index->begin(), index->end(), key, [](const Entry& entry, const std::string& value) {
+			return entry.key < value;
+		});
+
+		for (auto entry = first; entry != index->end() && entry->key.compare(0, key.size(), key) == 0; ++entry, ++matched)
+			if (shown < limit)
+			{
+				AppendEntry(entries, *entry);
+				++shown;
+			}
+	}
+	else
+	{
+		for (const Entry& entry : *index)
+		{
+			if (entry.key.find(key) == std::string::npos)
+				continue;
+
+			++matched;
+			if (shown < limit)
+			{
+				AppendEntry(entries, entry);
+				++shown;
+			}
+		}
+	}
+
+	reply += "cvars " + std::to_string(shown) + " " + std::to_string(matched) + "\n";
+	reply += entries;
+	return true;
+}
+
+void Reset()
+{
+	memory::Release(memory::SUBSYSTEM_CVARS, knownMemory);
+	knownMemory = 0;
+	known.clear();
+	pass = 1;
+	changed = false;
+	refreshed = 0;
+	std::atomic_store(&current, std::shared_ptr<const Index>());
+}
+
+} // namespace cvars
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace xconsole
+{
+
+namespace cvars
+{
+
+// How often in nanoseconds the game thread goes over the registered
+// commands to bring the index up to date.
+static const uint64_t REFRESH_INTERVAL = 1000000000;
+
+// Entries a query replies with by default and at most.
+static const size_t DEFAULT_QUERY_LIMIT = 100;
+static const size_t MAX_QUERY_LIMIT = 1000;
+
+// ConVar or ConCommand as it was when the index was last refreshed.
+struct Entry
+{
+	std::string key; // name in lower case, commands are case insensitive
+	std::string name;
+	bool command;
+	int32_t flags;
+	std::string value; // empty for commands and protected convars
+	std::string help;
+};
+
+// Every entry, sorted by key.
+typedef std::vector<Entry> Index;
+
+// Whether a refresh is due at time now. Called on the game thread.
+bool IsDue(uint64_t now);
+
+// A refresh reports every registered command with Update, then ends with
+// Commit. Entries that weren't updated are dropped, and the new index is
+// only built when something changed. Called on the game thread.
+void Update(const char* name, bool command, int32_t flags, const char* value, const char* help);
+void Commit(uint64_t now);
+
+// Latest index, null until the first refresh.
+std::shared_ptr<const Index> GetIndex();
+
+// Appends to reply a "cvars <shown> <matched>" line, then a line for each of
+// up to limit entries whose name starts with text (or contains it), in
+// order: name, "cvar" or "command", flags, value and help, separated by
+// tabs. Returns false when there is no index yet.
+bool Query(const std::string& text, bool prefix, size_t limit, std::string& reply);
+
+// Forgets the index.
+void Reset();
+
+} // namespace cvars
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include <EgressQueue.hpp>
+
+#include <cstring>
+
+namespace xconsole
+{
+
+static size_t Align(size_t size)
+{
+	return (size + 7) & ~static_cast<size_t>(7);
+}
+
+EgressQueue::EgressQueue(const size_t* capacities) :
+	count(0),
+	woken(false)
+{
+	for (int k = 0; k < LANE_COUNT; ++k)
+	{
+		Ring& ring = rings[k];
+		ring.storage.resize(Align(capacities[k]));
+		ring.head = 0;
+		ring.tail = 0;
+		ring.used = 0;
+		ring.count = 0;
+		ring.passedOver = 0;
+	}
+}
+
+bool EgressQueue::Push(const MultiLibrary::SegmentedBuffer& record, size_t spans, uint64_t timestamp, uint32_t tick, Lane lane)
+{
+	const size_t size = static_cast<size_t>(record.Size());
+	const size_t needed = sizeof(Header) + Align(size);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	Ring& ring = rings[lane];
+	std::vector<uint8_t>& storage = ring.storage;
+
+	// records never straddle the end of the ring, if one doesn't fit in the
+	// remaining space the rest is skipped and it goes at the start instead
+	size_t offset = ring.head;
+	size_t skipped = 0;
+	size_t available;
+	if (ring.used == 0)
+	{
+		ring.head = ring.tail = offset = 0;
+		available = storage.size();
+	}
+	else if (ring.head >= ring.tail)
+	{
+		available = storage.size() - ring.head;
+		if (available < needed)
+		{
+			skipped = available;
+			offset = 0;
+			available = ring.tail;
+		}
+	}
+	else
+	{
+		available = ring.tail - ring.head;
+	}
+
+	if (needed > available || ring.used + skipped + needed > storage.size())
+		return false;
+
+	if (skipped != 0 && skipped >= sizeof(Header))
+	{
+		Header wrap = {0, 1, 0, 0, 0};
+		std::memcpy(&storage[ring.head], &wrap, sizeof(wrap));
+	}
+
+	Header header = {static_cast<uint32_t>(size - spans), 0, timestamp, tick, static_cast<uint32_t>(spans)};
+	std::memcpy(&storage[offset], &header, sizeof(header));
+	record.CopyTo(&storage[offset + sizeof(Header)], size);
+
+	ring.head = offset + needed;
+	if (ring.head == storage.size())
+		ring.head = 0;
+
+	ring.used += skipped + needed;
+	++ring.count;
+	bool wasEmpty = count++ == 0;
+	lock.unlock();
+
+	if (wasEmpty)
+		signal.notify_one();
+
+	return true;
+}
+
+size_t EgressQueue::Advance(const Ring& ring, size_t offset)
+{
+	// a wrap marker or a gap too small for one sends us back to the start
+	if (ring.storage.size() - offset < sizeof(Header))
+		return 0;
+
+	Header header;
+	std::memcpy(&header, &ring.storage[offset], sizeof(header));
+	return header.wrap != 0 ? 0 : offset;
+}
+
+size_t EgressQueue::Peek(Entry* entries, size_t maxEntries, std::chrono::milliseconds timeout, Lane& lane)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (count == 0 && !woken)
+		signal.wait_for(lock, timeout, [this] { return count != 0 || woken; });
+
+	woken = false;
+	if (count == 0)
+		return 0;
+
+	// highest priority lane with records, unless a lower one has waited long enough
+	int selected = -1;
+	for (int k = 0; k < LANE_COUNT; ++k)
+	{
+		if (rings[k].count == 0)
+			continue;
+
+		if (selected == -1)
+			selected = k;
+		else if (rings[k].passedOver >= STARVATION_LIMIT)
+		{
+			selected = k;
+			break;
+		}
+	}
+
+	for (int k = 0; k < LANE_COUNT; ++k)
+		if (rings[k].count != 0)
+			rings[k].passedOver = k == selected ? 0 : rings[k].passedOver + 1;
+
+	lane = static_cast<Lane>(selected);
+	const Ring& ring = rings[selected];
+
+	// producers only ever write to free space, so the records between tail
+	// and head can be read without holding the lock once we know where they are
+	size_t filled = 0;
+	size_t offset = ring.tail;
+	for (; filled < ring.count && filled < maxEntries; ++filled)
+	{
+		offset = Advance(ring, offset);
+
+		Header header;
+		std::memcpy(&header, &ring.storage[offset], sizeof(header));
+		entries[filled].data = &ring.storage[offset + sizeof(Header)];
+		entries[filled].size = header.size;
+		entries[filled].timestamp = header.timestamp;
+		entries[filled].sequence = 0;
+		entries[filled].tick = header.tick;
+		entries[filled].spans = header.spans;
+		offset += sizeof(Header) + Align(header.size + header.spans);
+		if (offset == ring.storage.size())
+			offset = 0;
+	}
+
+	return filled;
+}
+
+void EgressQueue::Pop(Lane lane, size_t popped)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Ring& ring = rings[lane];
+	for (size_t k = 0; k < popped && ring.count != 0; ++k, --ring.count, --count)
+	{
+		size_t offset = Advance(ring, ring.tail);
+		ring.used -= offset != ring.tail ? ring.storage.size() - ring.tail : 0;
+
+		Header header;
+		std::memcpy(&header, &ring.storage[offset], sizeof(header));
+		size_t size = sizeof(Header) + Align(header.size + header.spans);
+		ring.used -= size;
+		ring.tail = offset + size;
+		if (ring.tail == ring.storage.size())
+			ring.tail = 0;
+	}
+}
+
+void EgressQueue::Wake()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		woken = true;
+	}
+
+	signal.notify_one();
+}
+
+size_t EgressQueue::Depth()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return count;
+}
+
+} // namespace xconsole
\ No newline at end of file
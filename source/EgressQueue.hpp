@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <SegmentedBuffer.hpp>
+
+namespace xconsole
+{
+
+// Priority classes of records, each with its own ring in the egress queue so
+// a backlog of messages never holds up errors.
+enum Lane
+{
+	LANE_HIGH,   // errors and asserts
+	LANE_NORMAL, // warnings, replies to control requests and hitches
+	LANE_LOW,    // messages and the module's own telemetry
+	LANE_COUNT
+};
+
+// Bounded multi-producer, single-consumer queue of encoded records, stored
+// back to back in one byte ring per lane. Producers copy each record in
+// once; the consumer reads them in place and releases them after writing.
+class EgressQueue
+{
+public:
+	struct Entry
+	{
+		const uint8_t* data;
+		size_t size;
+		uint64_t timestamp;
+		uint64_t sequence; // assigned by the writer thread, 0 until then
+		uint32_t tick;
+		uint32_t spans;    // size of the colour span metadata right after the record
+	};
+
+	// capacities has LANE_COUNT ring sizes in bytes, highest priority first.
+	explicit EgressQueue(const size_t* capacities);
+
+	// Copies the record into its lane along with when it was logged. The last
+	// spans bytes of record are its colour span metadata, if any. Returns
+	// false, dropping the record, when there isn't enough free space there.
+	bool Push(const MultiLibrary::SegmentedBuffer& record, size_t spans, uint64_t timestamp, uint32_t tick, Lane lane);
+
+	// Waits up to timeout for records, then fills entries with up to
+	// maxEntries of the oldest ones of a single lane and sets lane to it.
+	// Lanes are drained in strict priority order, except that a lane passed
+	// over STARVATION_LIMIT times in a row goes next. Entries stay valid
+	// until Pop.
+	size_t Peek(Entry* entries, size_t maxEntries, std::chrono::milliseconds timeout, Lane& lane);
+
+	// Releases the oldest count records of a lane.
+	void Pop(Lane lane, size_t count);
+
+	// Wakes up a consumer blocked in Peek.
+	void Wake();
+
+	// Amount of records in the queue, over all lanes.
+	size_t Depth();
+
+	static const unsigned STARVATION_LIMIT = 8;
+
+private:
+	struct Header
+	{
+		uint32_t size;
+		uint32_t wrap;
+		uint64_t timestamp;
+		uint32_t tick;
+		uint32_t spans;
+	};
+
+	struct Ring
+	{
+		std::vector<uint8_t> storage;
+		size_t head;
+		size_t tail;
+		size_t used;
+		size_t count;
+		unsigned passedOver;
+	};
+
+	static size_t Advance(const Ring& ring, size_t offset);
+
+	std::mutex mutex;
+	std::condition_variable signal;
+	Ring rings[LANE_COUNT];
+	size_t count;
+	bool woken;
+};
+
+} // namespace xconsole
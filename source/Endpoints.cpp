@@ -0,0 +1,352 @@
+#include <Endpoints.hpp>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace xconsole
+{
+
+namespace endpoints
+{
+
+#ifdef _WIN32
+std::string GetDiscoveryDirectory()
+{
+	char path[MAX_PATH + 1];
+	DWORD length = GetTempPathA(sizeof(path), path);
+	if (length == 0 || length > MAX_PATH)
+		return "xconsole";
+
+	return std::string(path, length) + "xconsole";
+}
+
+static uint32_t GetPid()
+{
+	return static_cast<uint32_t>(GetCurrentProcessId());
+}
+
+static bool IsAlive(uint32_t pid)
+{
+	HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+	if (process == nullptr)
+		return false;
+
+	DWORD code = 0;
+	bool alive = GetExitCodeProcess(process, &code) != FALSE && code == STILL_ACTIVE;
+	CloseHandle(process);
+	return alive;
+}
+
+static std::string GetDiscoveryPath(const std::string& name)
+{
+	return GetDiscoveryDirectory() + "\\" + name;
+}
+
+static void CreateDiscoveryDirectory()
+{
+	CreateDirectoryA(GetDiscoveryDirectory().c_str(), nullptr);
+}
+
+// Renames from to to, failing when to exists.
+static bool RenameNew(const std::string& from, const std::string& to)
+{
+	return MoveFileExA(from.c_str(), to.c_str(), 0) != FALSE;
+}
+#else
+static uint32_t GetPid()
+{
+	return static_cast<uint32_t>(getpid());
+}
+
+static bool IsAlive(uint32_t pid)
+{
+	return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+}
+
+static std::string GetDiscoveryPath(const std::string& name)
+{
+	return std::string(DISCOVERY_DIRECTORY) + "/" + name;
+}
+
+static void CreateDiscoveryDirectory()
+{
+	// shared by the instances of every user on the box
+	if (mkdir(DISCOVERY_DIRECTORY, 01777) == 0)
+		chmod(DISCOVERY_DIRECTORY, 01777);
+}
+
+// Renames from to to, failing when to exists. rename replaces, link doesn't.
+static bool RenameNew(const std::string& from, const std::string& to)
+{
+	if (link(from.c_str(), to.c_str()) != 0)
+		return false;
+
+	unlink(from.c_str());
+	return true;
+}
+#endif
+
+// Reads the pid out of a discovery file, 0 if there is none.
+static uint32_t ReadPid(const std::string& path)
+{
+	FILE* file = std::fopen(path.c_str(), "r");
+	if (file == nullptr)
+		return 0;
+
+	unsigned long pid = 0;
+	if (std::fscanf(file, "pid %lu", &pid) != 1)
+		pid = 0;
+
+	std::fclose(file);
+	return static_cast<uint32_t>(pid);
+}
+
+// Removes the discovery files of instances that are gone.
+static void Prune()
+{
+#ifdef _WIN32
+	WIN32_FIND_DATAA entry;
+	HANDLE find = FindFirstFileA((GetDiscoveryDirectory() + "\\*").c_str(), &entry);
+	if (find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if ((entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+			continue;
+
+		std::string path = GetDiscoveryPath(entry.cFileName);
+		uint32_t pid = ReadPid(path);
+		if (pid != 0 && !IsAlive(pid))
+			DeleteFileA(path.c_str());
+	}
+	while (FindNextFileA(find, &entry) != FALSE);
+
+	FindClose(find);
+#else
+	DIR* directory = opendir(DISCOVERY_DIRECTORY);
+	if (directory == nullptr)
+		return;
+
+	while (dirent* entry = readdir(directory))
+	{
+		if (entry->d_name[0] == '.')
+			continue;
+
+		std::string path = GetDiscoveryPath(entry->d_name);
+		uint32_t pid = ReadPid(path);
+		if (pid != 0 && !IsAlive(pid))
+			unlink(path.c_str());
+	}
+
+	closedir(directory);
+#endif
+}
+
+std::string Expand(const std::string& format, int32_t port, const std::string& hostname)
+{
+	std::string name;
+	for (size_t k = 0; k < format.size(); ++k)
+	{
+		if (format.compare(k, 6, "{port}") == 0)
+		{
+			name += std::to_string(port);
+			k += 5;
+		}
+		else if (format.compare(k, 5, "{pid}") == 0)
+		{
+			name += std::to_string(GetPid());
+			k += 4;
+		}
+		else if (format.compare(k, 10, "{hostname}") == 0)
+		{
+			name += hostname;
+			k += 9;
+		}
+		else
+		{
+			name += format[k];
+		}
+	}
+
+	for (char& character : name)
+		if (!std::isalnum(static_cast<unsigned char>(character)) && character != '-' && character != '_' && character != '.')
+			character = '_';
+
+	return name.empty() ? DEFAULT_NAME : name;
+}
+
+Endpoints Resolve(const std::string& name)
+{
+	Endpoints endpoints;
+	endpoints.name = name;
+#ifdef _WIN32
+	endpoints.pipe = "\\\\.\\pipe\\" + name;
+#else
+	endpoints.output = "/tmp/" + name;
+	endpoints.input = "/tmp/" + name + "_in";
+	endpoints.ring = "/" + name;
+#endif
+	return endpoints;
+}
+
+bool Claim(const Endpoints& endpoints, uint32_t& owner)
+{
+	CreateDiscoveryDirectory();
+	owner = 0;
+
+	// the files aside are named after this instance so that instances
+	// claiming at once don't share them, and end in .tmp like the one
+	// Publish writes, which collectors skip
+	const std::string path = GetDiscoveryPath(endpoints.name);
+	const std::string suffix = "." + std::to_string(GetPid());
+	const std::string temporary = path + suffix + ".tmp";
+	const std::string stale = path + suffix + ".stale.tmp";
+
+	// a try for the file as it is, then more in case the one left behind by
+	// an instance that is gone is being replaced by others too
+	for (int attempt = 0; attempt < 3; ++attempt)
+	{
+		FILE* file = std::fopen(temporary.c_str(), "w");
+		if (file == nullptr)
+			return true;
+
+		std::fprintf(file, "pid %lu\n", static_cast<unsigned long>(GetPid()));
+		if (std::fclose(file) != 0)
+		{
+			std::remove(temporary.c_str());
+			return true;
+		}
+
+		if (RenameNew(temporary, path))
+			return true;
+
+		std::remove(temporary.c_str());
+		uint32_t pid = ReadPid(path);
+		if (pid == GetPid())
+			return true;
+
+		if (pid != 0 && IsAlive(pid))
+		{
+			owner = pid;
+			return false;
+		}
+
+		// the file is moved aside before it is removed, and put back when
+		// it turns out to be a claim another instance made in the meantime
+		std::remove(stale.c_str());
+		if (std::rename(path.c_str(), stale.c_str()) != 0)
+			continue;
+
+		pid = ReadPid(stale);
+		if (pid != 0 && pid != GetPid() && IsAlive(pid))
+		{
+			RenameNew(stale, path);
+			std::remove(stale.c_str());
+			owner = pid;
+			return false;
+		}
+
+		std::remove(stale.c_str());
+	}
+
+	return false;
+}
+
+bool Publish(const Endpoints& endpoints, int32_t port, bool ring)
+{
+	CreateDiscoveryDirectory();
+	Prune();
+
+	// written aside and renamed over, so collectors never read half of it
+	const std::string path = GetDiscoveryPath(endpoints.name);
+	const std::string temporary = path + ".tmp";
+	FILE* file = std::fopen(temporary.c_str(), "w");
+	if (file == nullptr)
+		return false;
+
+	std::fprintf(file, "pid %lu\nport %d\n", static_cast<unsigned long>(GetPid()), static_cast<int>(port));
+#ifdef _WIN32
+	std::fprintf(file, "pipe %s\n", endpoints.pipe.c_str());
+	(void)ring;
+#else
+	std::fprintf(file, "output %s\ninput %s\n", endpoints.output.c_str(), endpoints.input.c_str());
+	if (ring)
+		std::fprintf(file, "ring %s\n", endpoints.ring.c_str());
+#endif
+
+	bool written = std::fclose(file) == 0;
+#ifdef _WIN32
+	written = written && MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+#else
+	written = written && std::rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+	if (!written)
+		std::remove(temporary.c_str());
+
+	return written;
+}
+
+void Unpublish(const Endpoints& endpoints)
+{
+	const std::string path = GetDiscoveryPath(endpoints.name);
+	if (ReadPid(path) == GetPid())
+		std::remove(path.c_str());
+}
+
+bool Read(const std::string& name, Instance& instance)
+{
+	FILE* file = std::fopen(GetDiscoveryPath(name).c_str(), "r");
+	if (file == nullptr)
+		return false;
+
+	instance = Instance();
+	instance.endpoints.name = name;
+	char line[1024];
+	while (std::fgets(line, sizeof(line), file) != nullptr)
+	{
+		char* value = std::strchr(line, ' ');
+		if (value == nullptr)
+			continue;
+
+		*value++ = '\0';
+		value[std::strcspn(value, "\r\n")] = '\0';
+		if (std::strcmp(line, "pid") == 0)
+			instance.pid = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		else if (std::strcmp(line, "port") == 0)
+			instance.port = static_cast<int32_t>(std::strtol(value, nullptr, 10));
+#ifdef _WIN32
+		else if (std::strcmp(line, "pipe") == 0)
+			instance.endpoints.pipe = value;
+#else
+		else if (std::strcmp(line, "output") == 0)
+			instance.endpoints.output = value;
+		else if (std::strcmp(line, "input") == 0)
+			instance.endpoints.input = value;
+		else if (std::strcmp(line, "ring") == 0)
+		{
+			instance.endpoints.ring = value;
+			instance.ring = true;
+		}
+#endif
+	}
+
+	std::fclose(file);
+	return instance.pid != 0 && IsAlive(instance.pid);
+}
+
+} // namespace endpoints
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace xconsole
+{
+
+namespace endpoints
+{
+
+// Name used when none is configured, which gives the original endpoints.
+static const char* const DEFAULT_NAME = "garrysmod_console";
+
+// Where the discovery files live: one per running instance, named after
+// its endpoints, as "key value" lines (pid, port, then output and input or
+// pipe, and ring when the shared memory ring is on).
+#ifdef _WIN32
+std::string GetDiscoveryDirectory(); // %TEMP%\xconsole
+#else
+static const char* const DISCOVERY_DIRECTORY = "/tmp/xconsole";
+#endif
+
+// Endpoints of an instance, all derived from its name.
+struct Endpoints
+{
+	std::string name;
+#ifdef _WIN32
+	std::string pipe;   // \\.\pipe\<name>
+#else
+	std::string output; // /tmp/<name>
+	std::string input;  // /tmp/<name>_in
+	std::string ring;   // /<name>, /dev/shm/<name> on Linux
+#endif
+};
+
+// What the discovery file of a running instance says about it.
+struct Instance
+{
+	uint32_t pid;
+	int32_t port;
+	Endpoints endpoints; // as published, not as resolved here
+	bool ring;
+};
+
+// Expands {port}, {pid} and {hostname} in a name template. Characters that
+// can't be in a file name become underscores.
+std::string Expand(const std::string& format, int32_t port, const std::string& hostname);
+
+Endpoints Resolve(const std::string& name);
+
+// Claims the endpoints for this instance before they are opened, by
+// creating its discovery file with only the pid in it, which Publish fills
+// in later. Creating it fails when it exists, so of two instances starting
+// at once only one gets the endpoints. Returns false, pointing owner to its
+// pid, when another live instance has them; files left behind by instances
+// that are gone are taken over. When the file can't be written at all the
+// endpoints are used unclaimed, as before discovery files.
+bool Claim(const Endpoints& endpoints, uint32_t& owner);
+
+// Writes the discovery file of this instance, or removes it. Discovery
+// files of instances that are gone are cleaned up along the way.
+bool Publish(const Endpoints& endpoints, int32_t port, bool ring);
+void Unpublish(const Endpoints& endpoints);
+
+// Reads the discovery file of the instance named name. Returns false when
+// there is none or the instance that wrote it is gone.
+bool Read(const std::string& name, Instance& instance);
+
+} // namespace endpoints
+
+} // namespace xconsole
\ No newline at end of file
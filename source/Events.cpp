@@ -0,0 +1,84 @@
+#include <Events.hpp>
+
+#include <Varint.hpp>
+
+#include <cmath>
+#include <cstring>
+
+namespace xconsole
+{
+
+namespace events
+{
+
+// doubles hold every integer up to this exactly
+static const double INTEGER_LIMIT = 9007199254740992.0;
+
+void Encoder::Clear()
+{
+	fields.clear();
+	count = 0;
+}
+
+void Encoder::AddBool(bool value)
+{
+	fields.push_back(value ? TYPE_TRUE : TYPE_FALSE);
+}
+
+// Integral numbers, the usual case for counters and ids, go out as varints.
+void Encoder::AddNumber(double value)
+{
+	uint8_t buffer[1 + MultiLibrary::Varint::MaxSize];
+	size_t size;
+	if (std::trunc(value) == value && std::fabs(value) <= INTEGER_LIMIT)
+	{
+		buffer[0] = TYPE_INTEGER;
+		size = 1 + MultiLibrary::Varint::Encode(MultiLibrary::Varint::ZigZagEncode(static_cast<int64_t>(value)), buffer + 1);
+	}
+	else
+	{
+		uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		buffer[0] = TYPE_NUMBER;
+		for (int k = 0; k < 8; ++k)
+			buffer[1 + k] = static_cast<uint8_t>(bits >> (k * 8));
+
+		size = 9;
+	}
+
+	fields.insert(fields.end(), buffer, buffer + size);
+}
+
+void Encoder::AddString(const char* value, size_t length)
+{
+	uint8_t buffer[1 + MultiLibrary::Varint::MaxSize];
+	buffer[0] = TYPE_STRING;
+	size_t size = 1 + MultiLibrary::Varint::Encode(length, buffer + 1);
+	fields.insert(fields.end(), buffer, buffer + size);
+	fields.insert(fields.end(), value, value + length);
+}
+
+void Encoder::EndField()
+{
+	++count;
+}
+
+void Encoder::Append(const Encoder& other)
+{
+	fields.insert(fields.end(), other.fields.begin(), other.fields.end());
+	count += other.count;
+}
+
+size_t Encoder::GetFieldCount() const
+{
+	return count;
+}
+
+const std::vector<uint8_t>& Encoder::GetFields() const
+{
+	return fields;
+}
+
+} // namespace events
+
+} // namespace xconsole
\ No newline at end of file
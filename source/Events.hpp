@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace xconsole
+{
+
+namespace events
+{
+
+// Type byte in front of every key and value of an event, followed by:
+enum Type : uint8_t
+{
+	TYPE_FALSE,   // nothing
+	TYPE_TRUE,    // nothing
+	TYPE_INTEGER, // a zigzag varint
+	TYPE_NUMBER,  // a 64 bit little endian IEEE 754 double
+	TYPE_STRING   // a varint length and that many bytes
+};
+
+// Structured event, as sent on the event pseudo channel: a varint field
+// count, then the key and the value of every field, each with its type.
+class Encoder
+{
+public:
+	void Clear();
+
+	// Keys and values are added in turn, EndField counts the pair.
+	void AddBool(bool value);
+	void AddNumber(double value);
+	void AddString(const char* value, size_t length);
+	void EndField();
+
+	// Adds every field of other after those added so far.
+	void Append(const Encoder& other);
+
+	size_t GetFieldCount() const;
+
+	// Encoded fields, without the count in front.
+	const std::vector<uint8_t>& GetFields() const;
+
+private:
+	std::vector<uint8_t> fields;
+	size_t count = 0;
+};
+
+} // namespace events
+
+} // namespace xconsole
\ No newline at end of file
@@ -35,6 +35,7 @@
  *************************************************************************/
 
 #include <InputStream.hpp>
+#include <Varint.hpp>
 #include <cassert>
 
 namespace MultiLibrary
@@ -213,4 +214,34 @@ InputStream &InputStream::operator>>( std::wstring &data )
 	return *this;
 }
 
+size_t InputStream::ReadVarint( uint64_t &data )
+{
+	int64_t start = Tell( );
+	uint8_t encoded[Varint::MaxSize];
+	size_t offset = 0;
+	size_t read = 0;
+	while( offset < Varint::MaxSize && Read( &encoded[offset], sizeof( uint8_t ) ) == sizeof( uint8_t ) )
+		if( encoded[offset++] < 0x80 )
+		{
+			read = Varint::Decode( encoded, offset, data );
+			break;
+		}
+
+	// nothing is consumed by a value that can't be decoded
+	if( read == 0 && offset != 0 && start >= 0 )
+		Seek( start );
+
+	return read;
+}
+
+size_t InputStream::ReadZigZag( int64_t &data )
+{
+	uint64_t value = 0;
+	size_t read = ReadVarint( value );
+	if( read != 0 )
+		data = Varint::ZigZagDecode( value );
+
+	return read;
+}
+
 } // namespace MultiLibrary
\ No newline at end of file
@@ -246,6 +246,29 @@ public:
 	 \overload
 	 */
 	virtual InputStream &operator>>( std::wstring &data );
+
+	/*!
+	 \brief Read a LEB128 variable-length integer.
+
+	 \param data Where to store the data.
+
+	 \return Amount of read bytes, 0 if the stream ended before the value
+	 did or the value is malformed. Nothing is consumed then, provided the
+	 stream can seek back.
+	 */
+	virtual size_t ReadVarint( uint64_t &data );
+
+	/*!
+	 \brief Read a zigzag encoded LEB128 variable-length integer.
+
+	 \param data Where to store the data.
+
+	 \return Amount of read bytes, 0 if the stream ended before the value
+	 did or the value is malformed.
+
+	 \sa ReadVarint
+	 */
+	virtual size_t ReadZigZag( int64_t &data );
 };
 
 } // namespace MultiLibrary
\ No newline at end of file
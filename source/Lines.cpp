@@ -0,0 +1,286 @@
+#include <Lines.hpp>
+
+#include <Memory.hpp>
+#include <Varint.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace xconsole
+{
+
+namespace lines
+{
+
+// Line a thread is putting together. Only its thread starts lines, the
+// writer thread may complete them when they time out.
+struct Pending
+{
+	std::mutex mutex;
+	std::atomic<bool> active{false};
+	Line line = {0, 0, std::string(), LANE_LOW, std::string(), std::vector<Span>(), 0, 0, 0};
+	size_t memory = 0; // charged for the buffers of line, which are kept
+	bool orphaned = false; // its thread exited, freed once the line is out
+};
+
+static std::atomic<uint64_t> timeout(0);
+static std::atomic<size_t> pendingCount(0);
+
+// threads register their line the first time they log a fragment, and again
+// after a Reset bumps the generation
+static std::mutex registryMutex;
+static std::vector<std::unique_ptr<Pending>> registry;
+static std::atomic<uint32_t> generation(1);
+
+// Called with the registry mutex held.
+static void Unregister(size_t index)
+{
+	memory::Release(memory::SUBSYSTEM_LINES, registry[index]->memory);
+	registry[index] = std::move(registry.back());
+	registry.pop_back();
+}
+
+// Line of the calling thread, let go of when the thread exits so threads
+// that come and go don't pile up in the registry. One that is still being
+// put together is left for Flush to send first.
+struct Current
+{
+	Pending* pending = nullptr;
+	uint32_t pendingGeneration = 0;
+
+	~Current()
+	{
+		if (pending == nullptr)
+			return;
+
+		// a Reset since has freed it already
+		std::lock_guard<std::mutex> registryLock(registryMutex);
+		if (generation.load(std::memory_order_relaxed) != pendingGeneration)
+			return;
+
+		for (size_t k = 0; k < registry.size(); ++k)
+		{
+			if (registry[k].get() != pending)
+				continue;
+
+			std::unique_lock<std::mutex> lock(pending->mutex);
+			if (pending->line.fragments != 0)
+			{
+				pending->orphaned = true;
+				return;
+			}
+
+			lock.unlock();
+			Unregister(k);
+			return;
+		}
+	}
+};
+
+static thread_local Current current;
+
+static Pending* GetPending()
+{
+	uint32_t latest = generation.load(std::memory_order_acquire);
+	if (current.pendingGeneration != latest)
+	{
+		if (!memory::Acquire(memory::SUBSYSTEM_LINES, sizeof(Pending)))
+			return nullptr;
+
+		std::lock_guard<std::mutex> lock(registryMutex);
+		registry.emplace_back(new Pending());
+		current.pending = registry.back().get();
+		current.pending->memory = sizeof(Pending);
+		current.pendingGeneration = latest;
+	}
+
+	return current.pending;
+}
+
+// Makes room in the line of pending for length more bytes of text in one
+// more span, charging the buffers for what they grow by before they do.
+// Called with the mutex of pending held.
+static bool Reserve(Pending& pending, size_t length)
+{
+	Line& line = pending.line;
+	size_t text = line.text.size() + length;
+	size_t spans = line.spans.size() + 1;
+	if (text <= line.text.capacity() && spans <= line.spans.capacity())
+		return true;
+
+	// grown by doubling, as the buffers would on their own
+	text = text > line.text.capacity() ? std::max(text, 2 * line.text.capacity()) : line.text.capacity();
+	spans = spans > line.spans.capacity() ? std::max(spans, 2 * line.spans.capacity()) : line.spans.capacity();
+	const size_t size = sizeof(Pending) + text + spans * sizeof(Span);
+	if (size > pending.memory && !memory::Acquire(memory::SUBSYSTEM_LINES, size - pending.memory))
+		return false;
+
+	line.text.reserve(text);
+	line.spans.reserve(spans);
+	pending.memory = std::max(size, pending.memory);
+	return true;
+}
+
+// Called with the mutex of pending held.
+static void Complete(Pending& pending, Sink sink)
+{
+	sink(pending.line);
+	pending.line.fragments = 0;
+	pending.active.store(false, std::memory_order_relaxed);
+	pendingCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// Called with the mutex of pending held.
+static void Add(Pending& pending, int32_t channel, int32_t severity, const char* name, int32_t color, const char* text, size_t length, Lane lane, uint64_t now, uint32_t tick, Sink sink)
+{
+	Line& line = pending.line;
+	if (line.fragments == 0)
+	{
+		line.channel = channel;
+		line.severity = severity;
+		line.name.assign(name);
+		line.lane = lane;
+		line.text.clear();
+		line.spans.clear();
+		line.timestamp = now;
+		line.tick = tick;
+		pending.active.store(true, std::memory_order_relaxed);
+		pendingCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	line.text.append(text, length);
+	if (!line.spans.empty() && line.spans.back().color == color)
+		line.spans.back().length += static_cast<uint32_t>(length);
+	else
+		line.spans.push_back({static_cast<uint32_t>(length), color});
+
+	++line.fragments;
+	if (line.text.size() >= MAX_LINE_SIZE)
+		Complete(pending, sink);
+}
+
+uint64_t GetTimeout()
+{
+	return timeout.load(std::memory_order_relaxed);
+}
+
+void SetTimeout(uint64_t nanoseconds)
+{
+	timeout.store(nanoseconds, std::memory_order_relaxed);
+}
+
+bool Append(int32_t channel, int32_t severity, const char* name, int32_t color, const char* message, Lane lane, uint64_t now, uint32_t tick, Sink sink)
+{
+	const bool breaks = timeout.load(std::memory_order_relaxed) == 0;
+	const size_t length = std::strlen(message);
+	const bool whole = length == 0 || message[length - 1] == '\n';
+
+	// only this thread starts lines, so a line that isn't active stays that way
+	Pending* pending = GetPending();
+	if (pending == nullptr || (!pending->active.load(std::memory_order_relaxed) && (breaks || whole)))
+		return false;
+
+	std::lock_guard<std::mutex> lock(pending->mutex);
+	Line& line = pending->line;
+	if (line.fragments != 0 && (breaks || line.channel != channel || line.severity != severity))
+		Complete(*pending, sink);
+
+	if (line.fragments == 0 && (breaks || whole))
+		return false;
+
+	// out of memory budget, the line goes out as far as it got and the
+	// fragment on its own
+	if (!Reserve(*pending, length))
+	{
+		if (line.fragments != 0)
+			Complete(*pending, sink);
+
+		return false;
+	}
+
+	// everything up to the last newline completes the line, the rest starts
+	// the next one
+	const char* end = message + length;
+	const char* newline = end;
+	while (newline != message && newline[-1] != '\n')
+		--newline;
+
+	if (newline != message)
+	{
+		Add(*pending, channel, severity, name, color, message, static_cast<size_t>(newline - message), lane, now, tick, sink);
+		if (line.fragments != 0)
+			Complete(*pending, sink);
+	}
+
+	if (newline != end)
+		Add(*pending, channel, severity, name, color, newline, static_cast<size_t>(end - newline), lane, now, tick, sink);
+
+	return true;
+}
+
+bool Flush(uint64_t now, bool force, Sink sink)
+{
+	if (pendingCount.load(std::memory_order_relaxed) == 0)
+		return false;
+
+	const uint64_t wait = timeout.load(std::memory_order_relaxed);
+	std::lock_guard<std::mutex> registryLock(registryMutex);
+	for (size_t k = 0; k < registry.size(); )
+	{
+		Pending& pending = *registry[k];
+		if (!pending.active.load(std::memory_order_relaxed))
+		{
+			++k;
+			continue;
+		}
+
+		bool orphaned;
+		{
+			std::lock_guard<std::mutex> lock(pending.mutex);
+			if (pending.line.fragments != 0 && (force || now >= pending.line.timestamp + wait))
+				Complete(pending, sink);
+
+			orphaned = pending.orphaned && pending.line.fragments == 0;
+		}
+
+		if (orphaned)
+			Unregister(k);
+		else
+			++k;
+	}
+
+	return pendingCount.load(std::memory_order_relaxed) != 0;
+}
+
+void EncodeSpans(const std::vector<Span>& spans, std::vector<uint8_t>& output)
+{
+	uint8_t buffer[MultiLibrary::Varint::MaxSize + 4];
+	output.insert(output.end(), buffer, buffer + MultiLibrary::Varint::Encode(spans.size(), buffer));
+	for (const Span& span : spans)
+	{
+		size_t size = MultiLibrary::Varint::Encode(span.length, buffer);
+		uint32_t color = static_cast<uint32_t>(span.color);
+		for (int k = 0; k < 4; ++k)
+			buffer[size++] = static_cast<uint8_t>(color >> (k * 8));
+
+		output.insert(output.end(), buffer, buffer + size);
+	}
+}
+
+void Reset()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (const auto& pending : registry)
+		memory::Release(memory::SUBSYSTEM_LINES, pending->memory);
+
+	registry.clear();
+	pendingCount.store(0, std::memory_order_relaxed);
+	generation.fetch_add(1, std::memory_order_release);
+}
+
+} // namespace lines
+
+} // namespace xconsole
\ No newline at end of file
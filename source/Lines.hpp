@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <EgressQueue.hpp>
+
+namespace xconsole
+{
+
+namespace lines
+{
+
+// Longest line assembled from fragments, anything beyond goes out as is.
+static const size_t MAX_LINE_SIZE = 16384;
+
+// Run of bytes of a line printed in one colour.
+struct Span
+{
+	uint32_t length;
+	int32_t color;
+};
+
+// Line put together from fragments logged by one thread, stamped with when
+// its first fragment was logged.
+struct Line
+{
+	int32_t channel;
+	int32_t severity;
+	std::string name;
+	Lane lane;
+	std::string text;
+	std::vector<Span> spans;
+	uint64_t timestamp;
+	uint32_t tick;
+	uint32_t fragments;
+};
+
+// Receives every completed line, on the thread that completed it.
+typedef void (*Sink)(const Line& line);
+
+// How long in nanoseconds a partial line waits for the rest of it before
+// going out as is, 0 disables coalescing.
+uint64_t GetTimeout();
+void SetTimeout(uint64_t nanoseconds);
+
+// Adds a fragment to the line the calling thread is putting together. The
+// line goes to sink once it ends with a newline, or before a fragment from
+// another channel or severity is added. Returns false, leaving the fragment
+// to the caller, when it doesn't need assembling: it is a whole line on its
+// own or coalescing is disabled.
+bool Append(int32_t channel, int32_t severity, const char* name, int32_t color, const char* message, Lane lane, uint64_t now, uint32_t tick, Sink sink);
+
+// Sends lines that have waited for longer than the timeout at time now to
+// sink, or every line if force is set. Returns true while lines are left.
+bool Flush(uint64_t now, bool force, Sink sink);
+
+// Encodes spans as a varint count followed by a varint length and a 32 bit
+// little endian colour for each span.
+void EncodeSpans(const std::vector<Span>& spans, std::vector<uint8_t>& output);
+
+// Forgets every pending line, threads start over with a new one.
+void Reset();
+
+} // namespace lines
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include <LoggingApi.hpp>
+
+namespace xconsole
+{
+
+#if ARCHITECTURE_IS_X86_64
+ILoggingListener* LoggingSystemApi::listener = nullptr;
+
+void LoggingSystemApi::Uninstall()
+{
+	if (listener == nullptr)
+		return;
+
+	LoggingSystem_UnregisterLoggingListener(listener);
+	LoggingSystem_PopLoggingState(false);
+	listener = nullptr;
+}
+
+LoggedRecord LoggingSystemApi::Translate(const LoggingContext_t& context)
+{
+	const CLoggingSystem::LoggingChannel_t* channel = LoggingSystem_GetChannel(context.m_ChannelID);
+	return {
+		static_cast<int32_t>(channel->m_ID),
+		context.m_Severity,
+		channel->m_Name,
+		context.m_Color.GetRawColor(),
+		context.m_Severity >= LS_ASSERT ? LANE_HIGH : context.m_Severity == LS_WARNING ? LANE_NORMAL : LANE_LOW
+	};
+}
+#else
+SpewOutputFunc_t SpewApi::previous = nullptr;
+
+void SpewApi::Uninstall()
+{
+	if (previous == nullptr)
+		return;
+
+	SpewOutputFunc(previous);
+	previous = nullptr;
+}
+
+LoggedRecord SpewApi::Translate(SpewType_t type)
+{
+	return {
+		static_cast<int32_t>(type),
+		GetSpewOutputLevel(),
+		GetSpewOutputGroup(),
+		GetSpewOutputColor()->GetRawColor(),
+		type == SPEW_ASSERT || type == SPEW_ERROR ? LANE_HIGH : type == SPEW_WARNING ? LANE_NORMAL : LANE_LOW
+	};
+}
+#endif
+
+} // namespace xconsole
\ No newline at end of file
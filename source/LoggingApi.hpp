@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+#include <EgressQueue.hpp>
+#include <Platform.hpp>
+#include <color.h>
+#include <tier0/dbg.h>
+
+#if ARCHITECTURE_IS_X86_64
+#include <logging.h>
+#endif
+
+namespace xconsole
+{
+
+// What the egress core needs to know about a record logged by the engine,
+// whichever logging API it came through.
+struct LoggedRecord
+{
+	int32_t channel;
+	int32_t severity;
+	const char* channelName;
+	int32_t color;
+	Lane lane;
+};
+
+// Receives every record logged by the engine, on the thread that logged it.
+typedef void (*LogSink)(const LoggedRecord& record, const char* message);
+
+// Adapters over the engine logging APIs. Each one hooks Sink into its API
+// with Install<Sink> and turns what the API hands over into a LoggedRecord.
+// The module is built against a single API, LoggingApi, so the egress core
+// is the same on every architecture and is called without any dispatch.
+#if ARCHITECTURE_IS_X86_64
+// 64-bit engines: a listener registered with the LoggingSystem.
+class LoggingSystemApi
+{
+public:
+	template<LogSink Sink>
+	static void Install()
+	{
+		static Listener<Sink> instance;
+		listener = &instance;
+		LoggingSystem_PushLoggingState(false, false);
+		LoggingSystem_RegisterLoggingListener(listener);
+	}
+
+	static void Uninstall();
+
+private:
+	template<LogSink Sink>
+	class Listener : public ILoggingListener
+	{
+	public:
+		void Log(const LoggingContext_t* context, const char* message) override
+		{
+			Sink(Translate(*context), message);
+		}
+	};
+
+	static LoggedRecord Translate(const LoggingContext_t& context);
+
+	static ILoggingListener* listener;
+};
+
+typedef LoggingSystemApi LoggingApi;
+#else
+// 32-bit engines: a spew output function, chained to the previous one.
+class SpewApi
+{
+public:
+	template<LogSink Sink>
+	static void Install()
+	{
+		previous = GetSpewOutputFunc();
+		SpewOutputFunc(Receive<Sink>);
+	}
+
+	static void Uninstall();
+
+private:
+	template<LogSink Sink>
+	static SpewRetval_t Receive(SpewType_t type, const char* message)
+	{
+		Sink(Translate(type), message);
+		return previous(type, message);
+	}
+
+	static LoggedRecord Translate(SpewType_t type);
+
+	static SpewOutputFunc_t previous;
+};
+
+typedef SpewApi LoggingApi;
+#endif
+
+} // namespace xconsole
\ No newline at end of file
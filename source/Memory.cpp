@@ -0,0 +1,125 @@
+#include <Memory.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+
+namespace xconsole
+{
+
+namespace memory
+{
+
+// reservations are rare (startup, replies, replays), a lock is plenty
+static std::mutex mutex;
+static Usage usages[SUBSYSTEM_COUNT];
+static Usage total = {0, 0, 0};
+
+static const char* subsystemNames[SUBSYSTEM_COUNT] = {
+	"egress",
+	"shared_ring",
+	"scrollback",
+	"patterns",
+	"lines",
+	"cvars",
+	"status",
+	"temporary"
+};
+
+void Configure(size_t limit)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (Usage& usage : usages)
+		usage = {0, 0, limit};
+
+	total = {0, 0, limit};
+}
+
+size_t GetLimit()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return total.quota;
+}
+
+void SetQuota(Subsystem subsystem, size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	usages[subsystem].quota = bytes;
+}
+
+size_t Reserve(Subsystem subsystem, size_t wanted, size_t minimum)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Usage& usage = usages[subsystem];
+	size_t available = std::min(
+		usage.quota > usage.current ? usage.quota - usage.current : 0,
+		total.quota > total.current ? total.quota - total.current : 0
+	);
+
+	size_t reserved = std::min(wanted, available);
+	if (reserved < minimum || reserved == 0)
+		return 0;
+
+	usage.current += reserved;
+	usage.peak = std::max(usage.peak, usage.current);
+	total.current += reserved;
+	total.peak = std::max(total.peak, total.current);
+	return reserved;
+}
+
+bool Acquire(Subsystem subsystem, size_t bytes)
+{
+	return bytes == 0 || Reserve(subsystem, bytes, bytes) == bytes;
+}
+
+void Release(Subsystem subsystem, size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Usage& usage = usages[subsystem];
+	bytes = std::min(bytes, usage.current);
+	usage.current -= bytes;
+	total.current -= bytes;
+}
+
+Usage GetUsage(Subsystem subsystem)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return usages[subsystem];
+}
+
+Usage GetTotal()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return total;
+}
+
+const char* GetSubsystemName(Subsystem subsystem)
+{
+	return subsystemNames[subsystem];
+}
+
+void Format(std::string& output)
+{
+	char line[256];
+	for (int k = 0; k < SUBSYSTEM_COUNT; ++k)
+	{
+		Usage usage = GetUsage(static_cast<Subsystem>(k));
+		std::snprintf(line, sizeof(line), "memory_%s current=%llu peak=%llu quota=%llu\n",
+			subsystemNames[k],
+			static_cast<unsigned long long>(usage.current),
+			static_cast<unsigned long long>(usage.peak),
+			static_cast<unsigned long long>(usage.quota));
+		output += line;
+	}
+
+	Usage usage = GetTotal();
+	std::snprintf(line, sizeof(line), "memory_total current=%llu peak=%llu limit=%llu\n",
+		static_cast<unsigned long long>(usage.current),
+		static_cast<unsigned long long>(usage.peak),
+		static_cast<unsigned long long>(usage.quota));
+	output += line;
+}
+
+} // namespace memory
+
+} // namespace xconsole
\ No newline at end of file
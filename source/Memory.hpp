@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace xconsole
+{
+
+namespace memory
+{
+
+// Everything in the module that holds on to memory, by owner.
+enum Subsystem
+{
+	SUBSYSTEM_EGRESS,      // egress queue lanes
+	SUBSYSTEM_SHARED_RING, // shared memory ring, counted once mapped
+	SUBSYSTEM_SCROLLBACK,  // scrollback of recent records
+	SUBSYSTEM_PATTERNS,    // compiled pattern filters
+	SUBSYSTEM_LINES,       // lines being put together from fragments
+	SUBSYSTEM_CVARS,       // convar index and watched convars
+	SUBSYSTEM_STATUS,      // status requests and the snapshot answering them
+	SUBSYSTEM_TEMPORARY,   // short lived buffers, like replies and replays
+	SUBSYSTEM_COUNT
+};
+
+struct Usage
+{
+	size_t current;
+	size_t peak;
+	size_t quota;
+};
+
+// Resets all accounting and sets the global limit in bytes.
+void Configure(size_t limit);
+size_t GetLimit();
+
+// Caps how much a single subsystem can hold.
+void SetQuota(Subsystem subsystem, size_t bytes);
+
+// Reserves as much as possible between minimum and wanted bytes for
+// subsystem, within its quota and what's left of the global limit. Returns
+// the amount reserved, 0 (reserving nothing) if not even minimum fits.
+// Subsystems reserve in priority order when the module starts, so the
+// lowest priority buffers are the ones that shrink or go away.
+size_t Reserve(Subsystem subsystem, size_t wanted, size_t minimum);
+
+// Reserves exactly bytes, for buffers that are useless any smaller. When
+// this fails the data the buffer was for has to be dropped.
+bool Acquire(Subsystem subsystem, size_t bytes);
+
+// Gives back memory obtained through Reserve or Acquire.
+void Release(Subsystem subsystem, size_t bytes);
+
+Usage GetUsage(Subsystem subsystem);
+Usage GetTotal();
+
+const char* GetSubsystemName(Subsystem subsystem);
+
+// Appends a "memory_<subsystem> current= peak= quota=" line per subsystem
+// and a "memory_total current= peak= limit=" one.
+void Format(std::string& output);
+
+} // namespace memory
+
+} // namespace xconsole
\ No newline at end of file
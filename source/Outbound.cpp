@@ -0,0 +1,144 @@
+#ifndef _WIN32
+
+#include <Outbound.hpp>
+
+#include <Memory.hpp>
+#include <Stats.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+namespace xconsole
+{
+
+OutboundBuffer::~OutboundBuffer()
+{
+	Clear();
+}
+
+bool OutboundBuffer::IsEmpty() const
+{
+	return Size() == 0;
+}
+
+size_t OutboundBuffer::Size() const
+{
+	return data.size() - offset + padding + tailSize - tailOffset;
+}
+
+bool OutboundBuffer::Hold(const iovec* vectors, size_t count)
+{
+	size_t size = data.size() - offset;
+	for (size_t k = 0; k < count; ++k)
+		size += vectors[k].iov_len;
+
+	if (size > memory)
+	{
+		if (!memory::Acquire(memory::SUBSYSTEM_TEMPORARY, size - memory))
+			return false;
+
+		memory = size;
+	}
+
+	data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(offset));
+	offset = 0;
+	for (size_t k = 0; k < count; ++k)
+	{
+		const uint8_t* base = static_cast<const uint8_t*>(vectors[k].iov_base);
+		data.insert(data.end(), base, base + vectors[k].iov_len);
+	}
+
+	return true;
+}
+
+void OutboundBuffer::Pad(const iovec* vectors, size_t count)
+{
+	size_t size = 0;
+	for (size_t k = 0; k < count; ++k)
+		size += vectors[k].iov_len;
+
+	tailSize = size < PAD_TAIL_SIZE ? size : PAD_TAIL_SIZE;
+	tailOffset = 0;
+	padding = size - tailSize;
+
+	// the tail can be spread over the last few vectors
+	size_t skip = padding;
+	size_t copied = 0;
+	for (size_t k = 0; k < count; ++k)
+	{
+		const uint8_t* base = static_cast<const uint8_t*>(vectors[k].iov_base);
+		size_t length = vectors[k].iov_len;
+		if (skip >= length)
+		{
+			skip -= length;
+			continue;
+		}
+
+		std::memcpy(tail + copied, base + skip, length - skip);
+		copied += length - skip;
+		skip = 0;
+	}
+}
+
+bool OutboundBuffer::Drain(int fd)
+{
+	static const uint8_t zeros[4096] = {};
+	while (!IsEmpty())
+	{
+		ssize_t written;
+		{
+			stats::ScopedTimer timer(stats::STAGE_WRITE);
+			if (offset != data.size())
+				written = write(fd, data.data() + offset, data.size() - offset);
+			else if (padding != 0)
+				written = write(fd, zeros, std::min(padding, sizeof(zeros)));
+			else
+				written = write(fd, tail + tailOffset, tailSize - tailOffset);
+		}
+
+		stats::Add(stats::COUNTER_SYSCALLS);
+		if (written == -1)
+		{
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				stats::Add(stats::COUNTER_EAGAIN);
+				return true;
+			}
+
+			Clear();
+			return false;
+		}
+
+		stats::Add(stats::COUNTER_BYTES, static_cast<uint64_t>(written));
+		if (offset != data.size())
+			offset += static_cast<size_t>(written);
+		else if (padding != 0)
+			padding -= static_cast<size_t>(written);
+		else
+			tailOffset += static_cast<size_t>(written);
+	}
+
+	Clear();
+	return true;
+}
+
+void OutboundBuffer::Clear()
+{
+	data.clear();
+	data.shrink_to_fit();
+	offset = 0;
+	padding = 0;
+	tailSize = 0;
+	tailOffset = 0;
+	memory::Release(memory::SUBSYSTEM_TEMPORARY, memory);
+	memory = 0;
+}
+
+} // namespace xconsole
+
+#endif
\ No newline at end of file
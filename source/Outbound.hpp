@@ -0,0 +1,60 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace xconsole
+{
+
+// Rest of a record a non-blocking descriptor only took part of. Everything
+// written after it has to wait until it is out, so each connection keeps one
+// of these, resumes from the exact byte the transport stopped at once poll
+// says it is writable again, and framing survives a full pipe. The memory is
+// accounted as temporary.
+class OutboundBuffer
+{
+public:
+	// Bytes at the end of a record Pad keeps as they are, enough for the end
+	// of record marker.
+	static const size_t PAD_TAIL_SIZE = 16;
+
+	~OutboundBuffer();
+
+	bool IsEmpty() const;
+	size_t Size() const;
+
+	// Keeps what is left in vectors, as writev left them. Returns false when
+	// that doesn't fit in the memory budget, keeping nothing.
+	bool Hold(const iovec* vectors, size_t count);
+
+	// Owes what is left in vectors as padding instead, when it couldn't be
+	// held: as many bytes, zeros but for the last PAD_TAIL_SIZE which are
+	// kept. The record is lost, but consumers find the next one where they
+	// expect it. Takes no memory beyond the buffer itself, only call it
+	// while empty.
+	void Pad(const iovec* vectors, size_t count);
+
+	// Writes as much of what is held as fd takes without blocking. Returns
+	// false on a transport error, in which case what is held is forgotten.
+	bool Drain(int fd);
+
+	void Clear();
+
+private:
+	std::vector<uint8_t> data;
+	size_t offset = 0;
+	size_t memory = 0;
+	size_t padding = 0;
+	uint8_t tail[PAD_TAIL_SIZE];
+	size_t tailSize = 0;
+	size_t tailOffset = 0;
+};
+
+} // namespace xconsole
+
+#endif
\ No newline at end of file
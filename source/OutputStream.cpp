@@ -35,6 +35,7 @@
  *************************************************************************/
 
 #include <OutputStream.hpp>
+#include <Varint.hpp>
 #include <cassert>
 #include <cstring>
 
@@ -147,4 +148,15 @@ OutputStream &OutputStream::operator<<( const std::wstring &data )
 	return *this;
 }
 
+size_t OutputStream::WriteVarint( uint64_t data )
+{
+	uint8_t encoded[Varint::MaxSize];
+	return Write( encoded, Varint::Encode( data, encoded ) );
+}
+
+size_t OutputStream::WriteZigZag( int64_t data )
+{
+	return WriteVarint( Varint::ZigZagEncode( data ) );
+}
+
 } // namespace MultiLibrary
\ No newline at end of file
@@ -244,6 +244,32 @@ public:
 	 \overload
 	 */
 	virtual OutputStream &operator<<( const std::wstring &data );
+
+	/*!
+	 \brief Write an unsigned integer as a LEB128 variable-length integer.
+
+	 Values below 128 take a single byte and every further 7 bits take
+	 one more byte, up to 10 bytes for the full 64-bit range.
+
+	 \param data Data to write.
+
+	 \return Amount of written bytes.
+	 */
+	virtual size_t WriteVarint( uint64_t data );
+
+	/*!
+	 \brief Write a signed integer as a zigzag encoded LEB128 variable-length
+	 integer.
+
+	 Small negative values take as few bytes as small positive ones.
+
+	 \param data Data to write.
+
+	 \return Amount of written bytes.
+
+	 \sa WriteVarint
+	 */
+	virtual size_t WriteZigZag( int64_t data );
 };
 
 } // namespace MultiLibrary
\ No newline at end of file
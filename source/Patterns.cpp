@@ -0,0 +1,356 @@
+#include <Patterns.hpp>
+
+#include <Memory.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+namespace xconsole
+{
+
+namespace patterns
+{
+
+static std::mutex mutex;
+static std::vector<Pattern> registered[MAX_OWNERS];
+static uint64_t used = 0;
+
+// bits unregistered since the automaton in use was compiled, it can still
+// match them so they aren't handed out again before the next one is
+static uint64_t retired = 0;
+static size_t registeredSize = 0;
+static std::atomic<bool> dirty(false);
+static std::shared_ptr<const Automaton> current;
+
+Pattern Parse(const std::string& pattern)
+{
+	Pattern result = {pattern, ANCHOR_NONE};
+	if (!result.text.empty() && result.text.front() == '^')
+	{
+		result.text.erase(0, 1);
+		result.anchors |= ANCHOR_START;
+	}
+
+	if (!result.text.empty() && result.text.back() == '$')
+	{
+		result.text.pop_back();
+		result.anchors |= ANCHOR_END;
+	}
+
+	return result;
+}
+
+void Automaton::Add(const Pattern& pattern, size_t owner)
+{
+	patterns.emplace_back(pattern, owner);
+}
+
+void Automaton::Build()
+{
+	// bytes that appear in no pattern share class 0, which always leads back
+	// to the root
+	for (const auto& entry : patterns)
+		for (unsigned char byte : entry.first.text)
+			if (classes[byte] == 0)
+				classes[byte] = static_cast<uint8_t>(classCount++);
+
+	// trie first, with 0 standing for no child since the root is no one's
+	transitions.assign(classCount, 0);
+	unanchored.assign(1, 0);
+	std::vector<std::vector<Output>> outputs(1);
+	for (const auto& entry : patterns)
+	{
+		const Pattern& pattern = entry.first;
+		const uint64_t owner = uint64_t(1) << entry.second;
+		owners |= owner;
+
+		size_t state = 0;
+		for (unsigned char byte : pattern.text)
+		{
+			uint32_t& next = transitions[state * classCount + classes[byte]];
+			if (next == 0)
+			{
+				next = static_cast<uint32_t>(unanchored.size());
+				transitions.resize(transitions.size() + classCount, 0);
+				unanchored.push_back(0);
+				outputs.emplace_back();
+			}
+
+			state = transitions[state * classCount + classes[byte]];
+		}
+
+		if (pattern.anchors == ANCHOR_NONE)
+			unanchored[state] |= owner;
+		else
+			outputs[state].push_back({pattern.text.size(), pattern.anchors, owner});
+
+		if ((pattern.anchors & ANCHOR_START) != 0 && pattern.text.size() > maxStartLength)
+			maxStartLength = pattern.text.size();
+	}
+
+	// then failure links, breadth first, folding the outputs of each state's
+	// longest proper suffix into it and completing the transitions
+	const size_t stateCount = unanchored.size();
+	std::vector<uint32_t> failures(stateCount, 0);
+	std::vector<uint32_t> queue;
+	queue.reserve(stateCount);
+	for (size_t c = 0; c < classCount; ++c)
+		if (transitions[c] != 0)
+			queue.push_back(transitions[c]);
+
+	for (size_t k = 0; k < queue.size(); ++k)
+	{
+		const uint32_t state = queue[k];
+		const uint32_t failure = failures[state];
+		unanchored[state] |= unanchored[failure];
+		outputs[state].insert(outputs[state].end(), outputs[failure].begin(), outputs[failure].end());
+
+		for (size_t c = 0; c < classCount; ++c)
+		{
+			uint32_t& next = transitions[state * classCount + c];
+			if (next != 0)
+			{
+				failures[next] = transitions[failure * classCount + c];
+				queue.push_back(next);
+			}
+			else
+			{
+				next = transitions[failure * classCount + c];
+			}
+		}
+	}
+
+	anchoredBegin.assign(stateCount + 1, 0);
+	for (size_t state = 0; state < stateCount; ++state)
+	{
+		anchoredBegin[state] = static_cast<uint32_t>(anchored.size());
+		anchored.insert(anchored.end(), outputs[state].begin(), outputs[state].end());
+	}
+
+	anchoredBegin[stateCount] = static_cast<uint32_t>(anchored.size());
+	patterns.clear();
+	patterns.shrink_to_fit();
+}
+
+// Anchored patterns ending at position in a message whose anchored end is end.
+bool Automaton::MatchesAnchored(size_t state, size_t position, size_t end, uint64_t& found) const
+{
+	for (uint32_t k = anchoredBegin[state]; k != anchoredBegin[state + 1]; ++k)
+	{
+		const Output& output = anchored[k];
+		if ((output.anchors & ANCHOR_START) != 0 && position != output.length)
+			continue;
+
+		if ((output.anchors & ANCHOR_END) != 0 && position != end)
+			continue;
+
+		found |= output.owner;
+	}
+
+	return found == owners;
+}
+
+uint64_t Automaton::Match(const char* text, size_t length) const
+{
+	if (owners == 0)
+		return 0;
+
+	const size_t end = length != 0 && text[length - 1] == '\n' ? length - 1 : length;
+	uint64_t found = unanchored[0];
+	if (MatchesAnchored(0, 0, end, found))
+		return found;
+
+	size_t state = 0;
+	for (size_t position = 1; position <= length; ++position)
+	{
+		state = transitions[state * classCount + classes[static_cast<unsigned char>(text[position - 1])]];
+		found |= unanchored[state];
+		if ((position <= maxStartLength || position == end) && MatchesAnchored(state, position, end, found))
+			return found;
+
+		if (found == owners)
+			return found;
+	}
+
+	return found;
+}
+
+size_t Automaton::GetSize() const
+{
+	return transitions.capacity() * sizeof(uint32_t) +
+		unanchored.capacity() * sizeof(uint64_t) +
+		anchoredBegin.capacity() * sizeof(uint32_t) +
+		anchored.capacity() * sizeof(Output);
+}
+
+// Size of the tables of an automaton over texts, but for the outputs of
+// anchored patterns. A state per distinct prefix, and a transition per
+// state and byte class, so it is known before building anything.
+static size_t GetTableSize(std::vector<const std::string*>& texts)
+{
+	bool seen[256] = {};
+	size_t classCount = 1;
+	for (const std::string* text : texts)
+		for (unsigned char byte : *text)
+			if (!seen[byte])
+			{
+				seen[byte] = true;
+				++classCount;
+			}
+
+	std::sort(texts.begin(), texts.end(), [](const std::string* left, const std::string* right) {
+		return *left < *right;
+	});
+
+	size_t stateCount = 1;
+	const std::string* previous = nullptr;
+	for (const std::string* text : texts)
+	{
+		size_t common = 0;
+		if (previous != nullptr)
+			while (common < previous->size() && common < text->size() && (*previous)[common] == (*text)[common])
+				++common;
+
+		stateCount += text->size() - common;
+		previous = text;
+	}
+
+	return stateCount * (classCount * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t));
+}
+
+int Register(const std::vector<Pattern>& patterns)
+{
+	size_t size = 0;
+	for (const Pattern& pattern : patterns)
+		size += pattern.text.size();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (registeredSize + size > MAX_PATTERN_BYTES)
+		return REGISTER_FULL;
+
+	std::vector<const std::string*> texts;
+	for (size_t owner = 0; owner < MAX_OWNERS; ++owner)
+		for (const Pattern& pattern : registered[owner])
+			texts.push_back(&pattern.text);
+
+	for (const Pattern& pattern : patterns)
+		texts.push_back(&pattern.text);
+
+	// the automaton in use stays charged until the new one replaces it
+	const memory::Usage usage = memory::GetUsage(memory::SUBSYSTEM_PATTERNS);
+	if (GetTableSize(texts) > usage.quota - std::min(usage.current, usage.quota))
+		return REGISTER_OVER_BUDGET;
+
+	for (size_t owner = 0; owner < MAX_OWNERS; ++owner)
+	{
+		if (((used | retired) & (uint64_t(1) << owner)) != 0)
+			continue;
+
+		used |= uint64_t(1) << owner;
+		registered[owner] = patterns;
+		registeredSize += size;
+		dirty.store(true, std::memory_order_release);
+		return static_cast<int>(owner);
+	}
+
+	return REGISTER_FULL;
+}
+
+void Unregister(int owner)
+{
+	if (owner < 0 || static_cast<size_t>(owner) >= MAX_OWNERS)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if ((used & (uint64_t(1) << owner)) == 0)
+		return;
+
+	for (const Pattern& pattern : registered[owner])
+		registeredSize -= pattern.text.size();
+
+	registered[owner].clear();
+	used &= ~(uint64_t(1) << owner);
+	retired |= uint64_t(1) << owner;
+	dirty.store(true, std::memory_order_release);
+}
+
+bool Compile()
+{
+	if (!dirty.exchange(false, std::memory_order_acquire))
+		return true;
+
+	std::unique_ptr<Automaton> automaton(new Automaton());
+	size_t planned;
+	uint64_t dropped;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		dropped = retired;
+		std::vector<const std::string*> texts;
+		for (size_t owner = 0; owner < MAX_OWNERS; ++owner)
+			for (const Pattern& pattern : registered[owner])
+			{
+				automaton->Add(pattern, owner);
+				texts.push_back(&pattern.text);
+			}
+
+		planned = GetTableSize(texts);
+	}
+
+	// the tables are reserved before they're built, so a filter that would
+	// blow up the automaton is refused without allocating it, and the rest
+	// is settled once the exact size is known. Filters changed all the same,
+	// so the next call tries again
+	if (!memory::Acquire(memory::SUBSYSTEM_PATTERNS, planned))
+	{
+		dirty.store(true, std::memory_order_release);
+		return false;
+	}
+
+	automaton->Build();
+	const size_t size = automaton->GetSize();
+	if (size > planned && !memory::Acquire(memory::SUBSYSTEM_PATTERNS, size - planned))
+	{
+		memory::Release(memory::SUBSYSTEM_PATTERNS, planned);
+		dirty.store(true, std::memory_order_release);
+		return false;
+	}
+
+	if (size < planned)
+		memory::Release(memory::SUBSYSTEM_PATTERNS, planned - size);
+
+	// given back when the last thread matching with it lets go
+	std::shared_ptr<const Automaton> compiled(automaton.release(), [size](const Automaton* automaton) {
+		delete automaton;
+		memory::Release(memory::SUBSYSTEM_PATTERNS, size);
+	});
+
+	std::atomic_store(&current, compiled);
+
+	// the bits left out of it can go to new filters now
+	std::lock_guard<std::mutex> lock(mutex);
+	retired &= ~dropped;
+	return true;
+}
+
+std::shared_ptr<const Automaton> GetAutomaton()
+{
+	return std::atomic_load(&current);
+}
+
+void Reset()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t owner = 0; owner < MAX_OWNERS; ++owner)
+		registered[owner].clear();
+
+	used = 0;
+	retired = 0;
+	registeredSize = 0;
+	dirty.store(false, std::memory_order_relaxed);
+	std::atomic_store(&current, std::shared_ptr<const Automaton>());
+}
+
+} // namespace patterns
+
+} // namespace xconsole
\ No newline at end of file
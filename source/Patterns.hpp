@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace xconsole
+{
+
+namespace patterns
+{
+
+// Filters that can have patterns at the same time, each is a bit of the
+// result of Automaton::Match.
+static const size_t MAX_OWNERS = 64;
+
+// Cap on the size of all patterns together, which bounds the automaton.
+static const size_t MAX_PATTERN_BYTES = 64 * 1024;
+
+// Where a pattern has to be found, ANCHOR_START | ANCHOR_END being the whole
+// message.
+enum Anchor
+{
+	ANCHOR_NONE = 0,
+	ANCHOR_START = 1,
+	ANCHOR_END = 2
+};
+
+struct Pattern
+{
+	std::string text;
+	int anchors;
+};
+
+// Literal text, anchored to the start of the message by a leading ^ and to
+// its end (before a trailing newline) by a trailing $.
+Pattern Parse(const std::string& pattern);
+
+// Aho-Corasick automaton over the patterns of every owner, turned into a
+// DFA over the bytes that appear in them so that a message is scanned once,
+// a table lookup per byte, for all owners and whatever the pattern count.
+class Automaton
+{
+public:
+	// Adds a pattern found on behalf of owner, before Build.
+	void Add(const Pattern& pattern, size_t owner);
+	void Build();
+
+	// Returns the owners, as bits, with at least one pattern in text.
+	uint64_t Match(const char* text, size_t length) const;
+
+	// Bytes held by the tables, once built.
+	size_t GetSize() const;
+
+private:
+	struct Output
+	{
+		size_t length;
+		int anchors;
+		uint64_t owner;
+	};
+
+	bool MatchesAnchored(size_t state, size_t position, size_t end, uint64_t& found) const;
+
+	std::vector<std::pair<Pattern, size_t>> patterns;
+	uint8_t classes[256] = {};
+	size_t classCount = 1;
+	std::vector<uint32_t> transitions;
+	std::vector<uint64_t> unanchored;
+	std::vector<uint32_t> anchoredBegin;
+	std::vector<Output> anchored;
+	size_t maxStartLength = 0;
+	uint64_t owners = 0;
+};
+
+// What Register returns instead of an owner bit when it refuses a filter.
+static const int REGISTER_FULL = -1;        // every bit taken, or MAX_PATTERN_BYTES reached
+static const int REGISTER_OVER_BUDGET = -2; // the automaton wouldn't fit in the patterns quota
+
+// Gives a filter its patterns and returns the owner bit for it. The new
+// automaton has to fit in what the one in use leaves of the patterns quota,
+// both are held while it replaces the other. They only match once the
+// writer thread has compiled them. A bit given back by Unregister is only
+// handed out again once an automaton without it is in use.
+int Register(const std::vector<Pattern>& patterns);
+void Unregister(int owner);
+
+// Rebuilds the automaton if filters changed since the last call, on the
+// writer thread. The automaton is charged to the patterns memory subsystem
+// for as long as it is in use. Returns false, keeping the one compiled
+// before, when the new one doesn't fit in the memory budget; the changes
+// are kept for the next call.
+bool Compile();
+
+// The automaton as last compiled, from any thread.
+std::shared_ptr<const Automaton> GetAutomaton();
+
+// Unregisters every filter.
+void Reset();
+
+} // namespace patterns
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include <Sampling.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+
+namespace xconsole
+{
+
+namespace sampling
+{
+
+// how often the 1 in N ratio is adapted to the rate a channel is logging at
+static const uint64_t WINDOW = 250000000;
+static const uint32_t MIN_RATIO = 2;
+static const uint32_t MAX_RATIO = 65536;
+
+struct Channel
+{
+	std::mutex mutex;
+	std::atomic<bool> custom{false};
+	Budget budget = {0, 0};
+	double tokens = 0;
+	uint64_t lastRefill = 0;
+	uint64_t windowStart = 0;
+	uint64_t windowSeen = 0;
+	uint32_t ratio = MIN_RATIO;
+	uint64_t counter = 0;
+	uint64_t seen = 0;
+	uint64_t kept = 0;
+};
+
+static Channel channels[CHANNEL_COUNT];
+static std::atomic<double> defaultRate(0);
+static std::atomic<double> defaultBurst(0);
+
+// Smallest power of two ratio that brings rate down to budget, clamped.
+static uint32_t GetRatio(double rate, double budget)
+{
+	uint32_t ratio = MIN_RATIO;
+	while (ratio < MAX_RATIO && rate > budget * ratio)
+		ratio <<= 1;
+
+	return ratio;
+}
+
+Budget GetDefaultBudget()
+{
+	return {defaultRate.load(std::memory_order_relaxed), defaultBurst.load(std::memory_order_relaxed)};
+}
+
+bool IsValid(const Budget& budget)
+{
+	return std::isfinite(budget.rate) && std::isfinite(budget.burst) && budget.rate >= 0 && budget.burst >= 0;
+}
+
+// a bucket that can't hold a whole token would never let a record through
+static double GetBurst(const Budget& budget)
+{
+	return budget.rate > 0 ? std::max(budget.burst, 1.0) : budget.burst;
+}
+
+bool SetDefaultBudget(const Budget& budget)
+{
+	if (!IsValid(budget))
+		return false;
+
+	defaultRate.store(budget.rate, std::memory_order_relaxed);
+	defaultBurst.store(GetBurst(budget), std::memory_order_relaxed);
+	return true;
+}
+
+bool SetBudget(int32_t id, const Budget& budget)
+{
+	if (id < 0 || id >= CHANNEL_COUNT || !IsValid(budget))
+		return false;
+
+	Channel& channel = channels[id];
+	std::lock_guard<std::mutex> lock(channel.mutex);
+	channel.custom.store(true, std::memory_order_relaxed);
+	channel.budget = {budget.rate, GetBurst(budget)};
+	return true;
+}
+
+bool ClearBudget(int32_t id)
+{
+	if (id < 0 || id >= CHANNEL_COUNT)
+		return false;
+
+	Channel& channel = channels[id];
+	std::lock_guard<std::mutex> lock(channel.mutex);
+	channel.custom.store(false, std::memory_order_relaxed);
+	return true;
+}
+
+bool Admit(int32_t id, bool important, uint64_t now)
+{
+	if (id < 0 || id >= CHANNEL_COUNT)
+		return true;
+
+	// no need to lock channels nobody limits
+	Channel& channel = channels[id];
+	bool custom = channel.custom.load(std::memory_order_relaxed);
+	if (!custom && defaultRate.load(std::memory_order_relaxed) <= 0)
+		return true;
+
+	std::lock_guard<std::mutex> lock(channel.mutex);
+	Budget budget = custom ? channel.budget : GetDefaultBudget();
+	if (budget.rate <= 0)
+		return true;
+
+	// threads read the clock before taking the lock, so now can be behind
+	// the last refill, and the window starts no later than that
+	if (now < channel.lastRefill)
+		now = channel.lastRefill;
+
+	if (channel.lastRefill == 0)
+	{
+		channel.tokens = budget.burst;
+		channel.windowStart = now;
+	}
+	else
+	{
+		channel.tokens = std::min(budget.burst, channel.tokens + (now - channel.lastRefill) * budget.rate / 1e9);
+	}
+
+	channel.lastRefill = now;
+
+	if (now - channel.windowStart >= WINDOW)
+	{
+		double rate = channel.windowSeen * 1e9 / (now - channel.windowStart);
+		channel.ratio = GetRatio(rate, budget.rate);
+		channel.windowStart = now;
+		channel.windowSeen = 0;
+	}
+
+	++channel.windowSeen;
+	++channel.seen;
+
+	bool keep;
+	if (channel.tokens >= 1)
+	{
+		channel.tokens -= 1;
+		keep = true;
+	}
+	else
+	{
+		keep = important || channel.counter++ % channel.ratio == 0;
+	}
+
+	if (keep)
+		++channel.kept;
+
+	return keep;
+}
+
+void Collect(std::vector<Summary>& summaries)
+{
+	for (int32_t id = 0; id < CHANNEL_COUNT; ++id)
+	{
+		Channel& channel = channels[id];
+		std::lock_guard<std::mutex> lock(channel.mutex);
+		if (channel.kept != channel.seen)
+			summaries.push_back({id, channel.kept, channel.seen, channel.ratio});
+
+		channel.seen = 0;
+		channel.kept = 0;
+	}
+}
+
+void Reset()
+{
+	for (Channel& channel : channels)
+	{
+		std::lock_guard<std::mutex> lock(channel.mutex);
+		channel.custom.store(false, std::memory_order_relaxed);
+		channel.budget = {0, 0};
+		channel.tokens = 0;
+		channel.lastRefill = 0;
+		channel.windowStart = 0;
+		channel.windowSeen = 0;
+		channel.ratio = MIN_RATIO;
+		channel.counter = 0;
+		channel.seen = 0;
+		channel.kept = 0;
+	}
+}
+
+} // namespace sampling
+
+} // namespace xconsole
\ No newline at end of file
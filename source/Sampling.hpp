@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace xconsole
+{
+
+namespace sampling
+{
+
+// Channels with an id in [0, CHANNEL_COUNT) can be sampled, others never are.
+static const int32_t CHANNEL_COUNT = 256;
+
+// Token bucket budget: a channel can log rate records per second on average
+// and up to burst records in a row. A rate of 0 means no limit. A burst
+// under 1 is taken as 1, so a channel with a rate still gets its records
+// through.
+struct Budget
+{
+	double rate;
+	double burst;
+};
+
+// Records a channel has seen since the last Collect, while over budget.
+struct Summary
+{
+	int32_t channel;
+	uint64_t kept;
+	uint64_t seen;
+	uint32_t ratio; // keeping 1 in ratio of the records over budget
+};
+
+// Whether a budget can be set: rate and burst finite and not negative.
+bool IsValid(const Budget& budget);
+
+// Budget of every channel without one of its own. Returns false, keeping
+// the one set before, for budgets that aren't valid.
+Budget GetDefaultBudget();
+bool SetDefaultBudget(const Budget& budget);
+
+// Gives a channel its own budget. Returns false for ids that can't be sampled
+// and budgets that aren't valid.
+bool SetBudget(int32_t channel, const Budget& budget);
+
+// Makes a channel use the default budget again.
+bool ClearBudget(int32_t channel);
+
+// Decides whether a record logged on channel at time now is kept, from any
+// thread. Once a channel runs out of tokens it only keeps 1 in N records,
+// with N adapted to how far over budget it is, except for important ones
+// (warnings and errors) which are always kept.
+bool Admit(int32_t channel, bool important, uint64_t now);
+
+// Adds a summary for every channel that dropped records since the last call.
+void Collect(std::vector<Summary>& summaries);
+
+// Forgets all channel state and budgets, keeps the default budget.
+void Reset();
+
+} // namespace sampling
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include <Scrollback.hpp>
+
+#include <cstring>
+
+namespace xconsole
+{
+
+static size_t Align(size_t size)
+{
+	return (size + 7) & ~static_cast<size_t>(7);
+}
+
+static uint64_t RoundUpToPowerOfTwo(uint64_t value)
+{
+	uint64_t result = 4096;
+	while (result < value)
+		result <<= 1;
+
+	return result;
+}
+
+Scrollback::Scrollback(size_t capacity) :
+	storage(static_cast<size_t>(RoundUpToPowerOfTwo(capacity))),
+	capacity(storage.size()),
+	head(0),
+	tail(0),
+	first(0),
+	last(0)
+{ }
+
+void Scrollback::Append(const EgressQueue::Entry& entry)
+{
+	const size_t needed = sizeof(Header) + Align(entry.size + entry.spans);
+	if (needed > capacity)
+		return;
+
+	// positions only ever grow, like in the shared memory ring: a record at
+	// position p lives at p % capacity and never straddles the end, if it
+	// doesn't fit the rest is skipped (marked with a wrap header if possible)
+	uint64_t start = head;
+	size_t offset = static_cast<size_t>(start & (capacity - 1));
+	size_t remaining = static_cast<size_t>(capacity) - offset;
+	if (remaining < needed)
+		start += remaining;
+
+	while (tail != head && start + needed - tail > capacity)
+	{
+		tail = SkipPadding(tail);
+		Header evicted = ReadHeader(tail);
+		tail += sizeof(Header) + Align(evicted.size + evicted.spans);
+		tail = tail != head ? SkipPadding(tail) : tail;
+		first = tail != head ? ReadHeader(tail).sequence : 0;
+	}
+
+	if (remaining < needed && remaining >= sizeof(Header))
+	{
+		Header wrap = {0, 1, 0, 0, 0, 0};
+		std::memcpy(storage.data() + offset, &wrap, sizeof(wrap));
+	}
+
+	uint8_t* target = storage.data() + (start & (capacity - 1));
+	Header header = {static_cast<uint32_t>(entry.size), 0, entry.sequence, entry.timestamp, entry.tick, entry.spans};
+	std::memcpy(target, &header, sizeof(header));
+	std::memcpy(target + sizeof(header), entry.data, entry.size + entry.spans);
+
+	if (tail == head)
+	{
+		tail = start;
+		first = entry.sequence;
+	}
+
+	head = start + needed;
+	last = entry.sequence;
+}
+
+uint64_t Scrollback::First() const
+{
+	return first;
+}
+
+uint64_t Scrollback::Last() const
+{
+	return tail != head ? last : 0;
+}
+
+void Scrollback::Collect(uint64_t from, std::vector<EgressQueue::Entry>& entries) const
+{
+	if (tail == head || from > last)
+		return;
+
+	uint64_t position = tail;
+	while (position != head)
+	{
+		position = SkipPadding(position);
+		Header header = ReadHeader(position);
+		if (header.sequence >= from)
+		{
+			const uint8_t* data = storage.data() + (position & (capacity - 1)) + sizeof(Header);
+			entries.push_back({data, header.size, header.timestamp, header.sequence, header.tick, header.spans});
+		}
+
+		position += sizeof(Header) + Align(header.size + header.spans);
+	}
+}
+
+// Moves a position sitting at the skipped end of the ring to the next record.
+uint64_t Scrollback::SkipPadding(uint64_t position) const
+{
+	size_t offset = static_cast<size_t>(position & (capacity - 1));
+	size_t remaining = static_cast<size_t>(capacity) - offset;
+	if (remaining < sizeof(Header) || ReadHeader(position).wrap != 0)
+		return position + remaining;
+
+	return position;
+}
+
+Scrollback::Header Scrollback::ReadHeader(uint64_t position) const
+{
+	Header header;
+	std::memcpy(&header, storage.data() + (position & (capacity - 1)), sizeof(header));
+	return header;
+}
+
+} // namespace xconsole
\ No newline at end of file
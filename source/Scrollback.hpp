@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <EgressQueue.hpp>
+
+namespace xconsole
+{
+
+// Keeps the most recent encoded records so consoles that (re)connect can ask
+// for what they missed. Records are stored back to back in a byte ring, the
+// oldest ones are evicted to make room. Only used by the writer thread.
+class Scrollback
+{
+public:
+	// capacity is rounded up to a power of two.
+	explicit Scrollback(size_t capacity);
+
+	// Copies the record in, evicting as many old ones as needed. Records that
+	// would take more than the whole ring are not kept.
+	void Append(const EgressQueue::Entry& entry);
+
+	// Sequence numbers of the oldest and newest records kept, both 0 when empty.
+	uint64_t First() const;
+	uint64_t Last() const;
+
+	// Adds every record with a sequence number of at least from to entries,
+	// oldest first. They point into the ring and stay valid until Append.
+	void Collect(uint64_t from, std::vector<EgressQueue::Entry>& entries) const;
+
+private:
+	struct Header
+	{
+		uint32_t size;
+		uint32_t wrap;
+		uint64_t sequence;
+		uint64_t timestamp;
+		uint32_t tick;
+		uint32_t spans;
+	};
+
+	uint64_t SkipPadding(uint64_t position) const;
+	Header ReadHeader(uint64_t position) const;
+
+	std::vector<uint8_t> storage;
+	uint64_t capacity;
+	uint64_t head;
+	uint64_t tail;
+	uint64_t first;
+	uint64_t last;
+};
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,167 @@
+/*************************************************************************
+ * MultiLibrary - danielga.bitbucket.org/multilibrary
+ * A C++ library that covers multiple low level systems.
+ *------------------------------------------------------------------------
+ * Copyright (c) 2015, Daniel Almeida
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *************************************************************************/
+
+#include <SegmentedBuffer.hpp>
+#include <cassert>
+#include <cstring>
+
+namespace MultiLibrary
+{
+
+SegmentedBuffer::SegmentedBuffer( ) :
+	total_size( 0 )
+{ }
+
+SegmentedBuffer::~SegmentedBuffer( )
+{ }
+
+bool SegmentedBuffer::IsValid( ) const
+{
+	return true;
+}
+
+int64_t SegmentedBuffer::Tell( ) const
+{
+	return static_cast<int64_t>( total_size );
+}
+
+int64_t SegmentedBuffer::Size( ) const
+{
+	return static_cast<int64_t>( total_size );
+}
+
+bool SegmentedBuffer::Seek( int64_t, SeekMode )
+{
+	return false;
+}
+
+bool SegmentedBuffer::EndOfFile( ) const
+{
+	return false;
+}
+
+void SegmentedBuffer::Clear( )
+{
+	segments.clear( );
+	owned.clear( );
+	total_size = 0;
+}
+
+void SegmentedBuffer::Reserve( size_t capacity )
+{
+	owned.reserve( capacity );
+}
+
+size_t SegmentedBuffer::Write( const void *data, size_t size )
+{
+	assert( data != nullptr && size != 0 );
+
+	// owned segments are always contiguous in storage, so the last one can grow
+	if( segments.empty( ) || segments.back( ).borrowed != nullptr )
+	{
+		Segment segment = { nullptr, owned.size( ), 0 };
+		segments.push_back( segment );
+	}
+
+	const uint8_t *bytes = static_cast<const uint8_t *>( data );
+	owned.insert( owned.end( ), bytes, bytes + size );
+	segments.back( ).size += size;
+	total_size += size;
+	return size;
+}
+
+size_t SegmentedBuffer::Reference( const void *data, size_t size )
+{
+	assert( data != nullptr );
+
+	if( size == 0 )
+		return 0;
+
+	Segment segment = { static_cast<const uint8_t *>( data ), 0, size };
+	segments.push_back( segment );
+	total_size += size;
+	return size;
+}
+
+size_t SegmentedBuffer::SegmentCount( ) const
+{
+	return segments.size( );
+}
+
+size_t SegmentedBuffer::CopyTo( void *output, size_t size ) const
+{
+	assert( output != nullptr );
+
+	uint8_t *bytes = static_cast<uint8_t *>( output );
+	size_t copied = 0;
+	for( size_t k = 0; k < segments.size( ) && copied < size; ++k )
+	{
+		size_t clamped = segments[k].size;
+		if( clamped > size - copied )
+			clamped = size - copied;
+
+		std::memcpy( bytes + copied, GetSegmentData( segments[k] ), clamped );
+		copied += clamped;
+	}
+
+	return copied;
+}
+
+#ifndef _WIN32
+
+size_t SegmentedBuffer::GetIOVectors( iovec *vectors, size_t count ) const
+{
+	assert( vectors != nullptr );
+
+	size_t filled = segments.size( ) < count ? segments.size( ) : count;
+	for( size_t k = 0; k < filled; ++k )
+	{
+		vectors[k].iov_base = const_cast<uint8_t *>( GetSegmentData( segments[k] ) );
+		vectors[k].iov_len = segments[k].size;
+	}
+
+	return filled;
+}
+
+#endif
+
+const uint8_t *SegmentedBuffer::GetSegmentData( const Segment &segment ) const
+{
+	// owned segments are resolved late since the storage may have moved
+	return segment.borrowed != nullptr ? segment.borrowed : owned.data( ) + segment.offset;
+}
+
+} // namespace MultiLibrary
\ No newline at end of file
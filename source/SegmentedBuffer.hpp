@@ -0,0 +1,199 @@
+/*************************************************************************
+ * MultiLibrary - danielga.bitbucket.org/multilibrary
+ * A C++ library that covers multiple low level systems.
+ *------------------------------------------------------------------------
+ * Copyright (c) 2015, Daniel Almeida
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *************************************************************************/
+
+#pragma once
+
+#include <OutputStream.hpp>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+namespace MultiLibrary
+{
+
+/*!
+ \brief An output buffer made of a list of segments, where each segment
+ either owns a copy of its data or only references memory owned by
+ someone else.
+
+ Data written through Write and the stream operators is copied into
+ internal storage, while Reference only records a pointer to the data.
+ Referenced data must outlive the buffer contents (until Clear is called
+ or the buffer is destroyed). The whole buffer can then be handed to the
+ kernel in a single vectored write without first flattening it.
+ */
+class SegmentedBuffer : public OutputStream
+{
+public:
+	/*!
+	 \brief Default constructor.
+	 */
+	SegmentedBuffer( );
+
+	/*!
+	 \brief Destructor.
+	 */
+	~SegmentedBuffer( );
+
+	/*!
+	 \brief Tell if the buffer is valid.
+
+	 A segmented buffer is always valid.
+
+	 \return Always true.
+	 */
+	bool IsValid( ) const;
+
+	/*!
+	 \brief Return the current position on the buffer.
+
+	 Writes always append, so this is the same as the size.
+
+	 \return Total amount of bytes in the buffer.
+	 */
+	int64_t Tell( ) const;
+
+	/*!
+	 \brief Return the total amount of bytes in the buffer, owned and
+	 referenced.
+
+	 \return Size of the buffer.
+	 */
+	int64_t Size( ) const;
+
+	/*!
+	 \brief Seeking is not supported, writes always append.
+
+	 \param position Ignored.
+	 \param mode Ignored.
+
+	 \return Always false.
+	 */
+	bool Seek( int64_t position, SeekMode mode = SEEKMODE_SET );
+
+	/*!
+	 \brief Tell if the end of file was reached.
+
+	 \return Always false.
+	 */
+	bool EndOfFile( ) const;
+
+	/*!
+	 \brief Reset the buffer.
+
+	 All segments are dropped but the owned storage keeps its capacity, so
+	 a reused buffer stops allocating once it has seen its largest header.
+	 */
+	void Clear( );
+
+	/*!
+	 \brief Increase the capacity of the owned storage.
+
+	 \param capacity New capacity of the owned storage.
+	 */
+	void Reserve( size_t capacity );
+
+	/*!
+	 \brief Copy data into the buffer.
+
+	 Consecutive writes are merged into the same owned segment.
+
+	 \param data Pointer to the data to write.
+	 \param size Size of the provided data.
+
+	 \return Size in bytes of the written data.
+	 */
+	size_t Write( const void *data, size_t size );
+
+	/*!
+	 \brief Append data to the buffer without copying it.
+
+	 \param data Pointer to the data to reference. Must stay valid until the
+	 buffer is cleared or destroyed.
+	 \param size Size of the provided data.
+
+	 \return Size in bytes of the referenced data.
+	 */
+	size_t Reference( const void *data, size_t size );
+
+	/*!
+	 \brief Return the amount of segments in the buffer.
+
+	 \return Amount of segments.
+	 */
+	size_t SegmentCount( ) const;
+
+	/*!
+	 \brief Copy the contents of all segments into a contiguous buffer.
+
+	 \param output Buffer to copy into.
+	 \param size Size of the provided buffer.
+
+	 \return Amount of bytes copied.
+	 */
+	size_t CopyTo( void *output, size_t size ) const;
+
+#ifndef _WIN32
+	/*!
+	 \brief Describe the segments as an iovec array, ready for writev or
+	 sendmsg.
+
+	 \param vectors Array to fill.
+	 \param count Amount of entries available in the array.
+
+	 \return Amount of entries filled, at most SegmentCount.
+	 */
+	size_t GetIOVectors( iovec *vectors, size_t count ) const;
+#endif
+
+private:
+	struct Segment
+	{
+		const uint8_t *borrowed;
+		size_t offset;
+		size_t size;
+	};
+
+	const uint8_t *GetSegmentData( const Segment &segment ) const;
+
+	std::vector<Segment> segments;
+	std::vector<uint8_t> owned;
+	size_t total_size;
+};
+
+} // namespace MultiLibrary
\ No newline at end of file
@@ -0,0 +1,167 @@
+#ifndef _WIN32
+
+#include <SharedRing.hpp>
+
+#include <cstring>
+#include <climits>
+#include <new>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace xconsole
+{
+
+static size_t Align(size_t size)
+{
+	return (size + 7) & ~static_cast<size_t>(7);
+}
+
+SharedRing::SharedRing() :
+	descriptor(-1),
+	region(nullptr),
+	regionSize(0),
+	header(nullptr),
+	data(nullptr),
+	capacity(0),
+	position(0)
+{ }
+
+SharedRing::~SharedRing()
+{
+	Destroy();
+}
+
+bool SharedRing::Create(const char* ringName, size_t size, const char*& error)
+{
+	Destroy();
+
+	capacity = 4096;
+	while (capacity < size)
+		capacity <<= 1;
+
+	shm_unlink(ringName);
+	descriptor = shm_open(ringName, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (descriptor == -1)
+	{
+		error = "failed to create shared memory ring (shm_open)";
+		return false;
+	}
+
+	name = ringName;
+	regionSize = SHARED_RING_DATA_OFFSET + static_cast<size_t>(capacity);
+	if (ftruncate(descriptor, static_cast<off_t>(regionSize)) == -1)
+	{
+		error = "failed to create shared memory ring (ftruncate)";
+		Destroy();
+		return false;
+	}
+
+	region = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	if (region == MAP_FAILED)
+	{
+		region = nullptr;
+		error = "failed to create shared memory ring (mmap)";
+		Destroy();
+		return false;
+	}
+
+	header = new(region) SharedRingHeader();
+	header->magic = SHARED_RING_MAGIC;
+	header->version = SHARED_RING_VERSION;
+	header->capacity = capacity;
+	header->producerPid = static_cast<uint64_t>(getpid());
+	data = static_cast<uint8_t*>(region) + SHARED_RING_DATA_OFFSET;
+	position = 0;
+	return true;
+}
+
+void SharedRing::Destroy()
+{
+	if (region != nullptr)
+	{
+		munmap(region, regionSize);
+		region = nullptr;
+	}
+
+	if (descriptor != -1)
+	{
+		close(descriptor);
+		shm_unlink(name.c_str());
+		descriptor = -1;
+	}
+
+	header = nullptr;
+	data = nullptr;
+}
+
+bool SharedRing::IsOpen() const
+{
+	return header != nullptr;
+}
+
+size_t SharedRing::Publish(const EgressQueue::Entry* entries, size_t count)
+{
+	size_t published = 0;
+	size_t skipped = 0;
+	uint64_t sequence = 0;
+	for (size_t k = 0; k < count; ++k)
+	{
+		const size_t needed = sizeof(SharedRingRecord) + Align(entries[k].size + entries[k].spans);
+		// readers need at least room for one record next to the one they are reading
+		if (needed > capacity / 2)
+		{
+			++skipped;
+			continue;
+		}
+
+		uint64_t start = position;
+		size_t offset = static_cast<size_t>(start & (capacity - 1));
+		size_t remaining = static_cast<size_t>(capacity) - offset;
+		if (remaining < needed)
+			start += remaining;
+
+		// tell readers what is about to be overwritten before touching it
+		header->reserved.store(start + needed, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		if (remaining < needed && remaining >= sizeof(SharedRingRecord))
+		{
+			SharedRingRecord pad = {static_cast<uint32_t>(remaining - sizeof(SharedRingRecord)), SHARED_RING_FLAG_PAD, 0, 0, 0, 0};
+			std::memcpy(data + offset, &pad, sizeof(pad));
+		}
+
+		uint8_t* target = data + (start & (capacity - 1));
+		SharedRingRecord record = {static_cast<uint32_t>(entries[k].size), 0, entries[k].sequence, entries[k].timestamp, entries[k].tick, entries[k].spans};
+		std::memcpy(target, &record, sizeof(record));
+		std::memcpy(target + sizeof(record), entries[k].data, entries[k].size + entries[k].spans);
+		position = start + needed;
+		sequence = entries[k].sequence;
+		++published;
+	}
+
+	if (published == 0)
+		return skipped;
+
+	header->committed.store(position, std::memory_order_release);
+	header->sequence.store(sequence, std::memory_order_release);
+	header->futex.fetch_add(1, std::memory_order_release);
+
+#ifdef __linux__
+	// shared (not private) futex, the waiters live in other processes
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header->futex), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+
+	return skipped;
+}
+
+} // namespace xconsole
+
+#endif
\ No newline at end of file
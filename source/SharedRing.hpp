@@ -0,0 +1,87 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <EgressQueue.hpp>
+
+namespace xconsole
+{
+
+static const uint32_t SHARED_RING_MAGIC = 0x52534358; // "XCSR"
+static const uint32_t SHARED_RING_VERSION = 4;
+
+// Layout of the first page of the shared memory region. The data area starts
+// at SHARED_RING_DATA_OFFSET and holds records back to back, each made of a
+// SharedRingRecord header followed by the encoded record, its colour span
+// metadata (spans bytes, see the readme) and padding to 8 bytes. Event
+// records (channel -4, version 4 onwards) carry a sized payload instead of a
+// message. Positions are byte offsets that only ever grow, a record at
+// position p lives at data + p % capacity and never wraps; when it doesn't
+// fit before the end of the data area, the rest of it is skipped (with a
+// header flagged SHARED_RING_FLAG_PAD if there is room for one).
+//
+// Readers keep their own position and follow committed. After copying a
+// record they must check that reserved - capacity <= their position, or
+// the producer overwrote it in the meantime and they have to skip ahead.
+struct SharedRingHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t capacity;
+	uint64_t producerPid;
+	std::atomic<uint64_t> reserved;  // the producer may be writing below this
+	std::atomic<uint64_t> committed; // records below this are complete
+	std::atomic<uint64_t> sequence;  // sequence number of the last record
+	std::atomic<uint32_t> futex;     // bumped after every publish, wait on it
+};
+
+struct SharedRingRecord
+{
+	uint32_t size;
+	uint32_t flags;
+	uint64_t sequence;
+	uint64_t timestamp; // monotonic nanoseconds when the record was logged
+	uint32_t tick;      // server tick it was logged in
+	uint32_t spans;     // size of the colour span metadata after the record
+};
+
+static const uint32_t SHARED_RING_FLAG_PAD = 1;
+static const size_t SHARED_RING_DATA_OFFSET = 4096;
+
+// Single producer, multi consumer ring of encoded records in a POSIX shared
+// memory region. Only the writer thread publishes; readers map the region
+// read-only and can never slow it down, if they fall behind they are lapped.
+class SharedRing
+{
+public:
+	SharedRing();
+	~SharedRing();
+
+	// Creates (or replaces) the region. capacity is rounded up to a power of two.
+	bool Create(const char* name, size_t capacity, const char*& error);
+	void Destroy();
+
+	bool IsOpen() const;
+
+	// Copies the records into the ring and wakes up waiting readers once.
+	// Returns how many were left out for being larger than half the ring.
+	size_t Publish(const EgressQueue::Entry* entries, size_t count);
+
+private:
+	std::string name;
+	int descriptor;
+	void* region;
+	size_t regionSize;
+	SharedRingHeader* header;
+	uint8_t* data;
+	uint64_t capacity;
+	uint64_t position;
+};
+
+} // namespace xconsole
+
+#endif
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include <Stats.hpp>
+
+#include <chrono>
+#include <cstdio>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace xconsole
+{
+
+namespace stats
+{
+
+static std::atomic<bool> enabled(true);
+static Histogram histograms[STAGE_COUNT];
+static std::atomic<uint64_t> counters[COUNTER_COUNT];
+static std::atomic<uint64_t> maxQueueDepth(0);
+
+static const char* stageNames[STAGE_COUNT] = {
+	"log",
+	"encode",
+	"enqueue",
+	"queue_wait",
+	"queue_wait_high",
+	"write"
+};
+
+static const char* counterNames[COUNTER_COUNT] = {
+	"records",
+	"bytes",
+	"syscalls",
+	"eagain",
+	"drops",
+	"sampled",
+	"coalesced",
+	"compress_in",
+	"compress_out",
+	"compress_ns",
+	"partial",
+	"undelivered",
+	"ring_skipped"
+};
+
+static int FindLastSet(uint64_t value)
+{
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+		return static_cast<int>(index) + 32;
+
+	_BitScanReverse(&index, static_cast<unsigned long>(value));
+	return static_cast<int>(index);
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+static void StoreMax(std::atomic<uint64_t>& target, uint64_t value)
+{
+	uint64_t current = target.load(std::memory_order_relaxed);
+	while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+		;
+}
+
+Histogram::Histogram()
+{
+	Reset();
+}
+
+int Histogram::GetBucket(uint64_t value)
+{
+	if (value < (1u << SubBucketBits))
+		return static_cast<int>(value);
+
+	int magnitude = FindLastSet(value);
+	if (magnitude > MaxMagnitude)
+		return BucketCount - 1;
+
+	int subBucket = static_cast<int>(value >> (magnitude - SubBucketBits)) & ((1 << SubBucketBits) - 1);
+	return ((magnitude - SubBucketBits + 1) << SubBucketBits) + subBucket;
+}
+
+uint64_t Histogram::GetBucketValue(int bucket)
+{
+	if (bucket < (1 << SubBucketBits))
+		return static_cast<uint64_t>(bucket);
+
+	int magnitude = (bucket >> SubBucketBits) + SubBucketBits - 1;
+	uint64_t subBucket = static_cast<uint64_t>(bucket & ((1 << SubBucketBits) - 1));
+	return ((1ULL << SubBucketBits) | subBucket) << (magnitude - SubBucketBits);
+}
+
+void Histogram::Record(uint64_t value)
+{
+	buckets[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+	StoreMax(maximum, value);
+}
+
+Summary Histogram::Summarize() const
+{
+	uint64_t counts[BucketCount];
+	Summary summary = {};
+	for (int k = 0; k < BucketCount; ++k)
+	{
+		counts[k] = buckets[k].load(std::memory_order_relaxed);
+		summary.count += counts[k];
+	}
+
+	summary.max = maximum.load(std::memory_order_relaxed);
+	if (summary.count == 0)
+		return summary;
+
+	const double fractions[] = {0.5, 0.9, 0.99, 0.999};
+	uint64_t* targets[] = {&summary.p50, &summary.p90, &summary.p99, &summary.p999};
+	uint64_t seen = 0;
+	int current = 0;
+	for (int k = 0; k < BucketCount && current < 4; ++k)
+	{
+		seen += counts[k];
+		while (current < 4 && seen >= static_cast<uint64_t>(fractions[current] * summary.count + 0.5))
+		{
+			// report the bucket's lower bound, but never above the real maximum
+			uint64_t value = GetBucketValue(k);
+			*targets[current++] = value < summary.max ? value : summary.max;
+		}
+	}
+
+	return summary;
+}
+
+void Histogram::Reset()
+{
+	for (int k = 0; k < BucketCount; ++k)
+		buckets[k].store(0, std::memory_order_relaxed);
+
+	maximum.store(0, std::memory_order_relaxed);
+}
+
+bool IsEnabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void SetEnabled(bool value)
+{
+	enabled.store(value, std::memory_order_relaxed);
+}
+
+uint64_t Now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Record(Stage stage, uint64_t nanoseconds)
+{
+	histograms[stage].Record(nanoseconds);
+}
+
+void Add(Counter counter, uint64_t amount)
+{
+	if (IsEnabled())
+		counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void UpdateMaxQueueDepth(uint64_t depth)
+{
+	if (IsEnabled())
+		StoreMax(maxQueueDepth, depth);
+}
+
+Summary Summarize(Stage stage)
+{
+	return histograms[stage].Summarize();
+}
+
+uint64_t Get(Counter counter)
+{
+	return counters[counter].load(std::memory_order_relaxed);
+}
+
+uint64_t GetMaxQueueDepth()
+{
+	return maxQueueDepth.load(std::memory_order_relaxed);
+}
+
+void Reset()
+{
+	for (Histogram& histogram : histograms)
+		histogram.Reset();
+
+	for (std::atomic<uint64_t>& counter : counters)
+		counter.store(0, std::memory_order_relaxed);
+
+	maxQueueDepth.store(0, std::memory_order_relaxed);
+}
+
+const char* GetStageName(Stage stage)
+{
+	return stageNames[stage];
+}
+
+const char* GetCounterName(Counter counter)
+{
+	return counterNames[counter];
+}
+
+void Format(std::string& output)
+{
+	char line[256];
+	std::snprintf(line, sizeof(line), "enabled %d\n", IsEnabled() ? 1 : 0);
+	output += line;
+
+	for (int k = 0; k < COUNTER_COUNT; ++k)
+	{
+		std::snprintf(line, sizeof(line), "%s %llu\n", counterNames[k], static_cast<unsigned long long>(Get(static_cast<Counter>(k))));
+		output += line;
+	}
+
+	std::snprintf(line, sizeof(line), "max_queue_depth %llu\n", static_cast<unsigned long long>(GetMaxQueueDepth()));
+	output += line;
+
+	for (int k = 0; k < STAGE_COUNT; ++k)
+	{
+		Summary summary = Summarize(static_cast<Stage>(k));
+		std::snprintf(line, sizeof(line), "%s_ns count=%llu p50=%llu p90=%llu p99=%llu p999=%llu max=%llu\n",
+			stageNames[k],
+			static_cast<unsigned long long>(summary.count),
+			static_cast<unsigned long long>(summary.p50),
+			static_cast<unsigned long long>(summary.p90),
+			static_cast<unsigned long long>(summary.p99),
+			static_cast<unsigned long long>(summary.p999),
+			static_cast<unsigned long long>(summary.max));
+		output += line;
+	}
+}
+
+} // namespace stats
+
+} // namespace xconsole
\ No newline at end of file
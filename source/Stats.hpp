@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace xconsole
+{
+
+namespace stats
+{
+
+// Stages of the egress path, each with its own latency histogram.
+enum Stage
+{
+	STAGE_LOG,             // whole time spent inside the engine logging callback
+	STAGE_ENCODE,          // encoding the record header
+	STAGE_ENQUEUE,         // copying the record into the egress queue
+	STAGE_QUEUE_WAIT,      // time a normal or low lane record sits in the queue until the writer picks it up
+	STAGE_QUEUE_WAIT_HIGH, // same for the high lane (errors and asserts)
+	STAGE_WRITE,           // a single write syscall on the console transport
+	STAGE_COUNT
+};
+
+enum Counter
+{
+	COUNTER_RECORDS,      // records accepted into the egress queue
+	COUNTER_BYTES,        // bytes written to the console transport
+	COUNTER_SYSCALLS,     // write syscalls issued
+	COUNTER_EAGAIN,       // writes that found the transport full
+	COUNTER_DROPS,        // records dropped because the egress queue was full
+	COUNTER_SAMPLED,      // records dropped by per-channel sampling
+	COUNTER_COALESCED,    // fragments merged into the record of their line
+	COUNTER_COMPRESS_IN,  // bytes of records fed to the compressor
+	COUNTER_COMPRESS_OUT, // bytes of compressed blocks, headers included
+	COUNTER_COMPRESS_NS,  // nanoseconds spent compressing
+	COUNTER_PARTIAL,      // records the transport took only part of, finished from the outbound buffer
+	COUNTER_UNDELIVERED,  // records Lua subscribers missed because a tick collected too many
+	COUNTER_RING_SKIPPED, // records left out of the shared memory ring for not fitting in it
+	COUNTER_COUNT
+};
+
+struct Summary
+{
+	uint64_t count;
+	uint64_t p50;
+	uint64_t p90;
+	uint64_t p99;
+	uint64_t p999;
+	uint64_t max;
+};
+
+// Log-linear histogram of nanosecond durations: 16 linear sub-buckets per
+// power of two (~6% worst case error) up to 2^40 ns. Recording is a single
+// relaxed atomic increment so it can be used from any thread.
+class Histogram
+{
+public:
+	Histogram();
+
+	void Record(uint64_t value);
+	Summary Summarize() const;
+	void Reset();
+
+private:
+	static const int SubBucketBits = 4;
+	static const int MaxMagnitude = 40;
+	static const int BucketCount = (MaxMagnitude - SubBucketBits + 2) << SubBucketBits;
+
+	static int GetBucket(uint64_t value);
+	static uint64_t GetBucketValue(int bucket);
+
+	std::atomic<uint64_t> buckets[BucketCount];
+	std::atomic<uint64_t> maximum;
+};
+
+bool IsEnabled();
+void SetEnabled(bool enabled);
+
+// Monotonic clock in nanoseconds.
+uint64_t Now();
+
+void Record(Stage stage, uint64_t nanoseconds);
+void Add(Counter counter, uint64_t amount = 1);
+void UpdateMaxQueueDepth(uint64_t depth);
+
+Summary Summarize(Stage stage);
+uint64_t Get(Counter counter);
+uint64_t GetMaxQueueDepth();
+void Reset();
+
+const char* GetStageName(Stage stage);
+const char* GetCounterName(Counter counter);
+
+// Appends every counter and stage summary as "name value" lines.
+void Format(std::string& output);
+
+// Records the time between construction and destruction into a stage,
+// does nothing when stats are disabled.
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer(Stage stage) :
+		stage(stage),
+		start(IsEnabled() ? Now() : 0)
+	{ }
+
+	~ScopedTimer()
+	{
+		if (start != 0)
+			Record(stage, Now() - start);
+	}
+
+private:
+	Stage stage;
+	uint64_t start;
+};
+
+} // namespace stats
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include <Status.hpp>
+
+#include <Memory.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+namespace xconsole
+{
+
+namespace status
+{
+
+static std::mutex pendingMutex;
+static std::vector<std::string> pending;
+static std::atomic<bool> requested(false);
+
+// only touched by the game thread
+static Snapshot snapshot;
+static events::Encoder encoded;
+static uint32_t encodedTick = 0;
+static bool encodedValid = false;
+static size_t snapshotMemory = 0;
+
+static size_t GetSize(const std::string& id)
+{
+	return sizeof(std::string) + id.size();
+}
+
+// What the snapshot and its encoding hold on to until the next one.
+static size_t GetSnapshotSize()
+{
+	size_t size = snapshot.map.size() + snapshot.players.capacity() * sizeof(Player) + encoded.GetFields().capacity();
+	for (const Player& player : snapshot.players)
+		size += player.name.size() + player.steamID.size();
+
+	return size;
+}
+
+static void Forget()
+{
+	memory::Release(memory::SUBSYSTEM_STATUS, snapshotMemory);
+	snapshotMemory = 0;
+	snapshot = Snapshot();
+	encoded = events::Encoder();
+	encodedValid = false;
+}
+
+static void AddKey(events::Encoder& encoder, const char* key)
+{
+	encoder.AddString(key, std::strlen(key));
+}
+
+static void AddString(events::Encoder& encoder, const char* key, const std::string& value)
+{
+	AddKey(encoder, key);
+	encoder.AddString(value.data(), value.size());
+	encoder.EndField();
+}
+
+static void AddNumber(events::Encoder& encoder, const char* key, double value)
+{
+	AddKey(encoder, key);
+	encoder.AddNumber(value);
+	encoder.EndField();
+}
+
+// The server fields, then a run of fields for every player, starting with
+// its name.
+static void Encode(uint32_t tick)
+{
+	encoded.Clear();
+	AddNumber(encoded, "tick", tick);
+	AddString(encoded, "map", snapshot.map);
+	AddNumber(encoded, "max_players", snapshot.maxPlayers);
+	AddNumber(encoded, "players", static_cast<double>(snapshot.players.size()));
+	for (const Player& player : snapshot.players)
+	{
+		AddString(encoded, "name", player.name);
+		AddString(encoded, "steamid", player.steamID);
+		AddNumber(encoded, "userid", player.userID);
+		AddNumber(encoded, "ping", player.ping);
+		AddNumber(encoded, "loss", player.loss);
+		AddNumber(encoded, "time", player.connected);
+		AddKey(encoded, "bot");
+		encoded.AddBool(player.bot);
+		encoded.EndField();
+	}
+}
+
+bool Request(const std::string& id)
+{
+	if (id.size() > MAX_ID_LENGTH)
+		return false;
+
+	std::lock_guard<std::mutex> lock(pendingMutex);
+	if (pending.size() >= MAX_PENDING || !memory::Acquire(memory::SUBSYSTEM_STATUS, GetSize(id)))
+		return false;
+
+	pending.push_back(id);
+	requested.store(true, std::memory_order_release);
+	return true;
+}
+
+void Serve(uint32_t tick, Source source, Sink sink)
+{
+	if (!requested.load(std::memory_order_acquire))
+		return;
+
+	static std::vector<std::string> ids;
+	ids.clear();
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		ids.swap(pending);
+		requested.store(false, std::memory_order_relaxed);
+	}
+
+	for (const std::string& id : ids)
+		memory::Release(memory::SUBSYSTEM_STATUS, GetSize(id));
+
+	if (!encodedValid || encodedTick != tick)
+	{
+		snapshot.map.clear();
+		snapshot.maxPlayers = 0;
+		snapshot.players.clear();
+		source(snapshot);
+		Encode(tick);
+		encodedTick = tick;
+		encodedValid = true;
+
+		// a snapshot over the memory budget isn't kept, and nobody is answered
+		const size_t size = GetSnapshotSize();
+		if (size > snapshotMemory && !memory::Acquire(memory::SUBSYSTEM_STATUS, size - snapshotMemory))
+		{
+			Forget();
+			return;
+		}
+
+		if (size < snapshotMemory)
+			memory::Release(memory::SUBSYSTEM_STATUS, snapshotMemory - size);
+
+		snapshotMemory = size;
+	}
+
+	// the id goes first so consoles can skip answers to someone else
+	events::Encoder answer;
+	for (const std::string& id : ids)
+	{
+		answer.Clear();
+		AddString(answer, "id", id);
+		answer.Append(encoded);
+		sink(answer);
+	}
+}
+
+void Reset()
+{
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		for (const std::string& id : pending)
+			memory::Release(memory::SUBSYSTEM_STATUS, GetSize(id));
+
+		pending.clear();
+		requested.store(false, std::memory_order_relaxed);
+	}
+
+	Forget();
+}
+
+} // namespace status
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Events.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace xconsole
+{
+
+namespace status
+{
+
+// Cap on the requests waiting for the next tick, and on the length of the
+// id a console gives to recognize its answer.
+static const size_t MAX_PENDING = 64;
+static const size_t MAX_ID_LENGTH = 64;
+
+struct Player
+{
+	int32_t userID;
+	std::string name;
+	std::string steamID;
+	int32_t ping; // milliseconds
+	int32_t loss; // percent
+	int32_t connected; // seconds
+	bool bot;
+};
+
+struct Snapshot
+{
+	std::string map;
+	int32_t maxPlayers;
+	std::vector<Player> players;
+};
+
+// Fills a snapshot from the engine, on the game thread.
+typedef void (*Source)(Snapshot& snapshot);
+
+// Receives the answer to each request, the id it came with first.
+typedef void (*Sink)(const events::Encoder& answer);
+
+// Queues a request, from any thread. Returns false when too many are
+// waiting already, the id is too long or over the memory budget.
+bool Request(const std::string& id);
+
+// Answers every queued request, on the game thread once per tick. The
+// snapshot is taken from source at most once per tick, however many
+// requests there are, and encoded once. The requests are dropped when the
+// snapshot doesn't fit in the memory budget.
+void Serve(uint32_t tick, Source source, Sink sink);
+
+// Drops the queued requests and the cached snapshot.
+void Reset();
+
+} // namespace status
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include <Subscriptions.hpp>
+
+#include <Memory.hpp>
+#include <Patterns.hpp>
+#include <Stats.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+namespace xconsole
+{
+
+namespace subscriptions
+{
+
+struct Subscription
+{
+	uint32_t id;
+	Filter filter;
+};
+
+static std::atomic<size_t> activeCount(0);
+static std::mutex mutex;
+static std::vector<Subscription> subscriptions;
+static uint32_t nextId = 1;
+
+// collected since the last Take, and what of it is taken from the temporary
+// memory quota
+static Batch pending;
+static size_t pendingSize = 0;
+
+// Called with the mutex held.
+static Match& GetMatch(uint32_t subscription)
+{
+	for (Match& match : pending.matches)
+		if (match.subscription == subscription)
+			return match;
+
+	pending.matches.push_back({subscription, std::vector<uint32_t>()});
+	return pending.matches.back();
+}
+
+static bool Matches(const Filter& filter, int32_t channel, int32_t severity)
+{
+	return (filter.anyChannel || filter.channel == channel) && severity >= filter.severity;
+}
+
+uint32_t Add(const Filter& filter)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	uint32_t id = nextId++;
+	subscriptions.push_back({id, filter});
+	activeCount.store(subscriptions.size(), std::memory_order_relaxed);
+	return id;
+}
+
+bool Remove(uint32_t subscription)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto it = subscriptions.begin(); it != subscriptions.end(); ++it)
+	{
+		if (it->id != subscription)
+			continue;
+
+		patterns::Unregister(it->filter.patterns);
+		subscriptions.erase(it);
+		activeCount.store(subscriptions.size(), std::memory_order_relaxed);
+		return true;
+	}
+
+	return false;
+}
+
+void Offer(int32_t channel, int32_t severity, const char* name, int32_t color, const char* message, uint64_t timestamp, uint32_t tick)
+{
+	if (activeCount.load(std::memory_order_relaxed) == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	bool collected = false;
+
+	// the message is scanned once for the patterns of every subscription
+	std::shared_ptr<const patterns::Automaton> automaton;
+	uint64_t found = 0;
+	for (const Subscription& subscription : subscriptions)
+	{
+		if (!Matches(subscription.filter, channel, severity))
+			continue;
+
+		if (subscription.filter.patterns >= 0)
+		{
+			if (automaton == nullptr)
+			{
+				automaton = patterns::GetAutomaton();
+				if (automaton == nullptr)
+					continue;
+
+				found = automaton->Match(message, std::strlen(message));
+			}
+
+			if ((found & (uint64_t(1) << subscription.filter.patterns)) == 0)
+				continue;
+		}
+
+		// on top of the patterns, not one of them
+		if (!subscription.filter.contains.empty() && std::strstr(message, subscription.filter.contains.c_str()) == nullptr)
+			continue;
+
+		if (!collected)
+		{
+			size_t size = std::strlen(message);
+			if (pending.records.size() >= MAX_BATCH_RECORDS || pendingSize + size > MAX_BATCH_SIZE || !memory::Acquire(memory::SUBSYSTEM_TEMPORARY, size))
+			{
+				stats::Add(stats::COUNTER_UNDELIVERED);
+				return;
+			}
+
+			pendingSize += size;
+			pending.records.push_back({channel, severity, name, color, std::string(message, size), timestamp, tick});
+			collected = true;
+		}
+
+		GetMatch(subscription.id).records.push_back(static_cast<uint32_t>(pending.records.size() - 1));
+	}
+}
+
+void Take(Batch& batch)
+{
+	batch.records.clear();
+	batch.matches.clear();
+
+	size_t size;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::swap(batch, pending);
+		size = pendingSize;
+		pendingSize = 0;
+	}
+
+	memory::Release(memory::SUBSYSTEM_TEMPORARY, size);
+}
+
+void Reset()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const Subscription& subscription : subscriptions)
+		patterns::Unregister(subscription.filter.patterns);
+
+	subscriptions.clear();
+	activeCount.store(0, std::memory_order_relaxed);
+	pending.records.clear();
+	pending.matches.clear();
+	memory::Release(memory::SUBSYSTEM_TEMPORARY, pendingSize);
+	pendingSize = 0;
+}
+
+} // namespace subscriptions
+
+} // namespace xconsole
\ No newline at end of file
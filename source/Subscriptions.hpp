@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace xconsole
+{
+
+namespace subscriptions
+{
+
+// Cap on what a tick can collect for subscribers, in records and in bytes
+// of their messages. Records past it are only counted, as undelivered.
+static const size_t MAX_BATCH_RECORDS = 4096;
+static const size_t MAX_BATCH_SIZE = 1024 * 1024;
+
+// What a subscription wants: records on one channel (or any), of at least
+// some severity, whose message contains some text (or anything) and has one
+// of the patterns registered as owner patterns (see Patterns.hpp), or
+// anything when that is -1. The subscription owns the registration from Add
+// onwards.
+struct Filter
+{
+	bool anyChannel;
+	int32_t channel;
+	int32_t severity;
+	std::string contains;
+	int patterns;
+};
+
+struct Record
+{
+	int32_t channel;
+	int32_t severity;
+	std::string name;
+	int32_t color;
+	std::string message;
+	uint64_t timestamp;
+	uint32_t tick;
+};
+
+// Records collected for one subscription, as indices into Batch::records.
+struct Match
+{
+	uint32_t subscription;
+	std::vector<uint32_t> records;
+};
+
+// Everything collected since the last Take. A record matching several
+// subscriptions is kept once.
+struct Batch
+{
+	std::vector<Record> records;
+	std::vector<Match> matches;
+};
+
+// Returns the id of the new subscription, never 0.
+uint32_t Add(const Filter& filter);
+bool Remove(uint32_t subscription);
+
+// Offers a record to every subscription, from any thread. Does nothing but
+// an atomic load while there are none.
+void Offer(int32_t channel, int32_t severity, const char* name, int32_t color, const char* message, uint64_t timestamp, uint32_t tick);
+
+// Hands over what was collected since the last call, on the game thread
+// once per tick. The batch given is emptied first.
+void Take(Batch& batch);
+
+// Removes every subscription and drops what was collected.
+void Reset();
+
+} // namespace subscriptions
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include <Ticks.hpp>
+
+#include <atomic>
+#include <cstdio>
+
+namespace xconsole
+{
+
+namespace ticks
+{
+
+static std::atomic<uint32_t> current(0);
+static std::atomic<uint64_t> records(0);
+static std::atomic<uint64_t> bytes(0);
+static std::atomic<uint64_t> moduleTime(0);
+static std::atomic<uint64_t> hitchThreshold(0);
+static std::atomic<uint64_t> hitchCount(0);
+static std::atomic<bool> telemetryEnabled(false);
+
+// only touched by the game thread
+static uint64_t tickStart = 0;
+
+uint32_t GetCurrent()
+{
+	return current.load(std::memory_order_relaxed);
+}
+
+void AddRecord(uint64_t size, uint64_t nanoseconds)
+{
+	records.fetch_add(1, std::memory_order_relaxed);
+	bytes.fetch_add(size, std::memory_order_relaxed);
+	moduleTime.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+bool Advance(uint32_t tick, uint64_t now, Frame& frame)
+{
+	uint64_t start = tickStart;
+	frame.tick = current.exchange(tick, std::memory_order_relaxed);
+	frame.records = records.exchange(0, std::memory_order_relaxed);
+	frame.bytes = bytes.exchange(0, std::memory_order_relaxed);
+	frame.moduleTime = moduleTime.exchange(0, std::memory_order_relaxed);
+	tickStart = now;
+	if (start == 0)
+		return false;
+
+	uint64_t threshold = hitchThreshold.load(std::memory_order_relaxed);
+	frame.duration = now - start;
+	frame.hitch = threshold != 0 && frame.duration > threshold;
+	if (frame.hitch)
+		hitchCount.fetch_add(1, std::memory_order_relaxed);
+
+	return true;
+}
+
+void Reset()
+{
+	current.store(0, std::memory_order_relaxed);
+	records.store(0, std::memory_order_relaxed);
+	bytes.store(0, std::memory_order_relaxed);
+	moduleTime.store(0, std::memory_order_relaxed);
+	hitchCount.store(0, std::memory_order_relaxed);
+	tickStart = 0;
+}
+
+uint64_t GetHitchThreshold()
+{
+	return hitchThreshold.load(std::memory_order_relaxed);
+}
+
+void SetHitchThreshold(uint64_t nanoseconds)
+{
+	hitchThreshold.store(nanoseconds, std::memory_order_relaxed);
+}
+
+bool IsTelemetryEnabled()
+{
+	return telemetryEnabled.load(std::memory_order_relaxed);
+}
+
+void SetTelemetryEnabled(bool enabled)
+{
+	telemetryEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t GetHitchCount()
+{
+	return hitchCount.load(std::memory_order_relaxed);
+}
+
+void Format(const Frame& frame, std::string& output)
+{
+	char line[256];
+	std::snprintf(line, sizeof(line), "tick=%u frame_ns=%llu records=%llu bytes=%llu module_ns=%llu hitch=%d\n",
+		frame.tick,
+		static_cast<unsigned long long>(frame.duration),
+		static_cast<unsigned long long>(frame.records),
+		static_cast<unsigned long long>(frame.bytes),
+		static_cast<unsigned long long>(frame.moduleTime),
+		frame.hitch ? 1 : 0);
+	output += line;
+}
+
+} // namespace ticks
+
+} // namespace xconsole
\ No newline at end of file
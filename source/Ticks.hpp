@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace xconsole
+{
+
+namespace ticks
+{
+
+// What happened during one server tick.
+struct Frame
+{
+	uint32_t tick;
+	uint64_t duration;   // from the start of this tick to the start of the next one
+	uint64_t records;    // records logged through the engine logging callback
+	uint64_t bytes;      // encoded size of those records
+	uint64_t moduleTime; // time spent inside the logging callback
+	bool hitch;          // duration went over the hitch threshold
+};
+
+// Number of the tick in progress, stamped on every record. 0 until the
+// first tick.
+uint32_t GetCurrent();
+
+// Accounts a record logged during the tick in progress, from any thread.
+void AddRecord(uint64_t bytes, uint64_t nanoseconds);
+
+// Called by the game thread when tick number tick starts at time now. Fills
+// frame with the totals of the previous tick and returns true, unless this
+// is the first tick since Reset.
+bool Advance(uint32_t tick, uint64_t now, Frame& frame);
+
+// Forgets the tick in progress.
+void Reset();
+
+// Ticks longer than this many nanoseconds are hitches, 0 disables detection.
+uint64_t GetHitchThreshold();
+void SetHitchThreshold(uint64_t nanoseconds);
+
+// Sends a telemetry record for every tick, not just hitches.
+bool IsTelemetryEnabled();
+void SetTelemetryEnabled(bool enabled);
+
+// Hitches detected since Reset.
+uint64_t GetHitchCount();
+
+// Formats a frame as a single line of "name=value" pairs.
+void Format(const Frame& frame, std::string& output);
+
+} // namespace ticks
+
+} // namespace xconsole
\ No newline at end of file
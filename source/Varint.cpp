@@ -0,0 +1,104 @@
+/*************************************************************************
+ * MultiLibrary - danielga.bitbucket.org/multilibrary
+ * A C++ library that covers multiple low level systems.
+ *------------------------------------------------------------------------
+ * Copyright (c) 2015, Daniel Almeida
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *************************************************************************/
+
+#include <Varint.hpp>
+
+namespace MultiLibrary
+{
+
+namespace Varint
+{
+
+static size_t DecodeSlow( const uint8_t *input, size_t size, size_t offset, uint64_t result, uint64_t &value )
+{
+	for( ; offset < size && offset < MaxSize; ++offset )
+	{
+		uint64_t byte = input[offset];
+		if( offset == MaxSize - 1 && byte > 1 )
+			return 0;
+
+		result |= ( byte & 0x7F ) << ( 7 * offset );
+		if( byte < 0x80 )
+		{
+			value = result;
+			return offset + 1;
+		}
+	}
+
+	return 0;
+}
+
+size_t Decode( const uint8_t *input, size_t size, uint64_t &value )
+{
+	if( size < 8 )
+		return DecodeSlow( input, size, 0, 0, value );
+
+	// compilers fold this into a single unaligned little-endian load
+	uint64_t word =
+		static_cast<uint64_t>( input[0] ) |
+		static_cast<uint64_t>( input[1] ) << 8 |
+		static_cast<uint64_t>( input[2] ) << 16 |
+		static_cast<uint64_t>( input[3] ) << 24 |
+		static_cast<uint64_t>( input[4] ) << 32 |
+		static_cast<uint64_t>( input[5] ) << 40 |
+		static_cast<uint64_t>( input[6] ) << 48 |
+		static_cast<uint64_t>( input[7] ) << 56;
+
+	// the high bit of each terminating byte, lowest one marks the end
+	uint64_t stops = ~word & 0x8080808080808080ULL;
+
+	// all bytes up to and including the first terminator (or all of them)
+	uint64_t keep = stops != 0 ? stops ^ ( stops - 1 ) : ~0ULL;
+
+	// sum of the low bit of each kept byte, lands in the top byte
+	size_t length = static_cast<size_t>( ( ( keep & 0x0101010101010101ULL ) * 0x0101010101010101ULL ) >> 56 );
+
+	// squeeze the 7-bit groups together: 8x7 -> 4x14 -> 2x28 -> 1x56
+	uint64_t result = word & keep & 0x7F7F7F7F7F7F7F7FULL;
+	result = ( result & 0x007F007F007F007FULL ) | ( ( result & 0x7F007F007F007F00ULL ) >> 1 );
+	result = ( result & 0x00003FFF00003FFFULL ) | ( ( result & 0x3FFF00003FFF0000ULL ) >> 2 );
+	result = ( result & 0x000000000FFFFFFFULL ) | ( ( result & 0x0FFFFFFF00000000ULL ) >> 4 );
+
+	if( stops == 0 )
+		return DecodeSlow( input, size, 8, result, value );
+
+	value = result;
+	return length;
+}
+
+} // namespace Varint
+
+} // namespace MultiLibrary
\ No newline at end of file
@@ -0,0 +1,141 @@
+/*************************************************************************
+ * MultiLibrary - danielga.bitbucket.org/multilibrary
+ * A C++ library that covers multiple low level systems.
+ *------------------------------------------------------------------------
+ * Copyright (c) 2015, Daniel Almeida
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace MultiLibrary
+{
+
+/*!
+ \brief Primitives for LEB128 variable-length integers and zigzag encoding.
+
+ Values are stored 7 bits per byte, least significant group first, with
+ the high bit of each byte telling if another byte follows.
+ */
+namespace Varint
+{
+
+/*!
+ \brief Maximum amount of bytes an encoded 64-bit value can take.
+ */
+static const size_t MaxSize = 10;
+
+/*!
+ \brief Map a signed integer to an unsigned one so that small magnitudes
+ stay small (0, -1, 1, -2 become 0, 1, 2, 3).
+
+ \param value Signed value.
+
+ \return Zigzag encoded value.
+ */
+inline uint64_t ZigZagEncode( int64_t value )
+{
+	return ( static_cast<uint64_t>( value ) << 1 ) ^ static_cast<uint64_t>( value >> 63 );
+}
+
+/*!
+ \brief Reverse of ZigZagEncode.
+
+ \param value Zigzag encoded value.
+
+ \return Signed value.
+ */
+inline int64_t ZigZagDecode( uint64_t value )
+{
+	return static_cast<int64_t>( value >> 1 ) ^ -static_cast<int64_t>( value & 1 );
+}
+
+/*!
+ \brief Return the amount of bytes needed to encode a value.
+
+ \param value Value to measure.
+
+ \return Encoded size, between 1 and MaxSize.
+ */
+inline size_t EncodedSize( uint64_t value )
+{
+	size_t size = 1;
+	while( value >= 0x80 )
+	{
+		value >>= 7;
+		++size;
+	}
+
+	return size;
+}
+
+/*!
+ \brief Encode a value into the provided buffer.
+
+ \param value Value to encode.
+ \param output Buffer with room for at least MaxSize bytes.
+
+ \return Amount of bytes written.
+ */
+inline size_t Encode( uint64_t value, uint8_t *output )
+{
+	size_t size = 0;
+	while( value >= 0x80 )
+	{
+		output[size++] = static_cast<uint8_t>( value | 0x80 );
+		value >>= 7;
+	}
+
+	output[size++] = static_cast<uint8_t>( value );
+	return size;
+}
+
+/*!
+ \brief Decode a value from the provided buffer.
+
+ When at least 8 bytes are available, values up to 56 bits are decoded
+ without branching on each byte.
+
+ \param input Buffer to decode from.
+ \param size Amount of bytes available in the buffer.
+ \param value Where to store the decoded value.
+
+ \return Amount of bytes consumed, or 0 if the buffer is truncated or the
+ value is malformed (in which case value is left untouched).
+ */
+size_t Decode( const uint8_t *input, size_t size, uint64_t &value );
+
+} // namespace Varint
+
+} // namespace MultiLibrary
\ No newline at end of file
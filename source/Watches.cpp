@@ -0,0 +1,153 @@
+#include <Watches.hpp>
+
+#include <Memory.hpp>
+
+#include <cctype>
+#include <mutex>
+#include <sstream>
+#include <unordered_set>
+
+namespace xconsole
+{
+
+namespace watches
+{
+
+struct Pending
+{
+	std::vector<std::string> names;
+	bool watch;
+	size_t memory;
+};
+
+static std::mutex pendingMutex;
+static std::vector<Pending> pending;
+static size_t pendingNames = 0;
+
+// only touched by the game thread, names are in lower case since convars
+// are case insensitive
+static std::unordered_set<std::string> watched;
+static size_t watchedMemory = 0;
+
+// Charged to the convar memory subsystem for a name in a request or in
+// watched, which also costs a node.
+static size_t GetSize(const std::string& name)
+{
+	return sizeof(std::string) + name.size() + 2 * sizeof(void*);
+}
+
+static std::string ToLower(std::string name)
+{
+	for (char& character : name)
+		character = static_cast<char>(std::tolower(static_cast<unsigned char>(character)));
+
+	return name;
+}
+
+bool Request(const std::string& names, bool watch)
+{
+	Pending request;
+	request.watch = watch;
+	request.memory = 0;
+
+	std::istringstream stream(names);
+	std::string name;
+	while (stream >> name)
+	{
+		request.memory += GetSize(name);
+		request.names.push_back(std::move(name));
+	}
+
+	std::lock_guard<std::mutex> lock(pendingMutex);
+	if (pendingNames + request.names.size() > MAX_WATCHES || !memory::Acquire(memory::SUBSYSTEM_CVARS, request.memory))
+		return false;
+
+	pendingNames += request.names.size();
+	pending.push_back(std::move(request));
+	return true;
+}
+
+static void Unwatch(const std::string& name)
+{
+	if (watched.erase(name) == 0)
+		return;
+
+	memory::Release(memory::SUBSYSTEM_CVARS, GetSize(name));
+	watchedMemory -= GetSize(name);
+}
+
+static void UnwatchAll()
+{
+	memory::Release(memory::SUBSYSTEM_CVARS, watchedMemory);
+	watchedMemory = 0;
+	watched.clear();
+}
+
+void Apply(std::vector<std::string>& names)
+{
+	static std::vector<Pending> requests;
+	requests.clear();
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		if (pending.empty())
+			return;
+
+		requests.swap(pending);
+		pendingNames = 0;
+	}
+
+	for (Pending& request : requests)
+	{
+		memory::Release(memory::SUBSYSTEM_CVARS, request.memory);
+		if (!request.watch && request.names.empty())
+			UnwatchAll();
+
+		for (std::string& name : request.names)
+		{
+			std::string key = ToLower(name);
+			if (!request.watch)
+			{
+				Unwatch(key);
+				continue;
+			}
+
+			// names over the cap or the memory budget aren't watched
+			if (watched.count(key) == 0)
+			{
+				if (watched.size() >= MAX_WATCHES || !memory::Acquire(memory::SUBSYSTEM_CVARS, GetSize(key)))
+					continue;
+
+				watchedMemory += GetSize(key);
+				watched.insert(std::move(key));
+			}
+
+			names.push_back(std::move(name));
+		}
+	}
+}
+
+bool IsWatched(const char* name)
+{
+	if (watched.empty())
+		return false;
+
+	return watched.count(ToLower(name)) != 0;
+}
+
+void Reset()
+{
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		for (const Pending& request : pending)
+			memory::Release(memory::SUBSYSTEM_CVARS, request.memory);
+
+		pending.clear();
+		pendingNames = 0;
+	}
+
+	UnwatchAll();
+}
+
+} // namespace watches
+
+} // namespace xconsole
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace xconsole
+{
+
+namespace watches
+{
+
+// Cap on how many convars can be watched, and on the names waiting to be.
+static const size_t MAX_WATCHES = 1024;
+
+// Queues names, separated by spaces, to be watched or no longer watched,
+// from any thread. No names and watch false stops watching everything.
+// Returns false when too many names are waiting already, or they don't fit
+// in the memory budget.
+bool Request(const std::string& names, bool watch);
+
+// Applies the queued requests, on the game thread once per tick. Every name
+// in a watch request is added to names, even ones watched already, so each
+// console asking gets the current value.
+void Apply(std::vector<std::string>& names);
+
+// Whether changes of the convar named name are sent, on the game thread.
+bool IsWatched(const char* name);
+
+// Stops watching everything and drops the queued requests.
+void Reset();
+
+} // namespace watches
+
+} // namespace xconsole
\ No newline at end of file
@@ -1,322 +1,617 @@
-#ifdef _WIN32
-#include <Windows.h>
-#else
-#include <fcntl.h>
-#include <unistd.h>
-#include <sys/stat.h>
-#endif
-
-#include <cstring>
-#include <cstdint>
-#include <string>
-#include <thread>
-#include <chrono>
-
 #include <GarrysMod/Lua/Interface.h>
 #include <GarrysMod/FactoryLoader.hpp>
-#include <ByteBuffer.hpp>
-#include <Platform.hpp>
-#include <color.h>
+#include <Console.hpp>
+#include <Cvars.hpp>
+#include <Endpoints.hpp>
+#include <Events.hpp>
+#include <Memory.hpp>
+#include <Patterns.hpp>
+#include <Sampling.hpp>
+#include <Stats.hpp>
+#include <Status.hpp>
+#include <Subscriptions.hpp>
+#include <Ticks.hpp>
+#include <Watches.hpp>
 #include <eiface.h>
-#include <tier0/dbg.h>
+#include <icvar.h>
+#include <inetchannelinfo.h>
+#include <game/server/iplayerinfo.h>
+#include <tier1/convar.h>
+#include <tier0/icommandline.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
 
-#if ARCHITECTURE_IS_X86_64
-#include <logging.h>
-#endif
+static IVEngineServer* engineServer = nullptr;
+static IPlayerInfoManager* playerInfoManager = nullptr;
+static ICvar* cvar = nullptr;
 
-#ifdef _WIN32
-static HANDLE serverPipe = INVALID_HANDLE_VALUE;
-#else
-const char* EOL_SEQUENCE = "<EOL>\0";
-const char* PIPE_NAME_OUT = "/tmp/garrysmod_console";
-const char* PIPE_NAME_IN = "/tmp/garrysmod_console_in";
+LUA_FUNCTION_STATIC(GetStats)
+{
+	LUA->CreateTable();
 
-static int serverPipe = -1;
-static int serverPipeIn = -1;
-#endif
+	LUA->PushBool(xconsole::stats::IsEnabled());
+	LUA->SetField(-2, "enabled");
 
-static volatile bool serverShutdown = false;
-static volatile bool serverConnected = false;
-static std::thread serverThread;
+	for (int k = 0; k < xconsole::stats::COUNTER_COUNT; ++k)
+	{
+		xconsole::stats::Counter counter = static_cast<xconsole::stats::Counter>(k);
+		LUA->PushNumber(static_cast<double>(xconsole::stats::Get(counter)));
+		LUA->SetField(-2, xconsole::stats::GetCounterName(counter));
+	}
 
-#if ARCHITECTURE_IS_X86_64
-class XConsoleListener : public ILoggingListener
-{
-public:
-	XConsoleListener(bool bQuietPrintf = false, bool bQuietDebugger = false) {}
+	LUA->PushNumber(static_cast<double>(xconsole::stats::GetMaxQueueDepth()));
+	LUA->SetField(-2, "max_queue_depth");
+
+	LUA->PushNumber(static_cast<double>(xconsole::ticks::GetHitchCount()));
+	LUA->SetField(-2, "hitches");
 
-	void Log(const LoggingContext_t* pContext, const char* pMessage) override
+	// durations are in nanoseconds
+	for (int k = 0; k < xconsole::stats::STAGE_COUNT; ++k)
 	{
-		const CLoggingSystem::LoggingChannel_t* chan = LoggingSystem_GetChannel(pContext->m_ChannelID);
-		const Color* color = &pContext->m_Color;
-		int size = 12 + std::strlen(chan->m_Name) + std::strlen(pMessage);
-#ifndef _WIN32
-		size += 4; // extra 4 for <EOL>\0;
-#endif 
-		MultiLibrary::ByteBuffer buffer;
-		buffer.Reserve(size);
-
-		buffer <<
-			static_cast<int32_t>(chan->m_ID) <<
-			pContext->m_Severity <<
-			chan->m_Name <<
-			color->GetRawColor() <<
-			pMessage;
-
-#ifdef _WIN32
-		if (WriteFile(serverPipe, buffer.GetBuffer(), static_cast<DWORD>(buffer.Size()), nullptr, nullptr) == FALSE)
-			serverConnected = false;
-#else
-		buffer << "<EOL>";
-
-		if (serverPipe == -1)
-		{
-			serverConnected = false;
-			return;
-		}
+		xconsole::stats::Stage stage = static_cast<xconsole::stats::Stage>(k);
+		xconsole::stats::Summary summary = xconsole::stats::Summarize(stage);
+
+		LUA->CreateTable();
+		LUA->PushNumber(static_cast<double>(summary.count));
+		LUA->SetField(-2, "count");
+		LUA->PushNumber(static_cast<double>(summary.p50));
+		LUA->SetField(-2, "p50");
+		LUA->PushNumber(static_cast<double>(summary.p90));
+		LUA->SetField(-2, "p90");
+		LUA->PushNumber(static_cast<double>(summary.p99));
+		LUA->SetField(-2, "p99");
+		LUA->PushNumber(static_cast<double>(summary.p999));
+		LUA->SetField(-2, "p999");
+		LUA->PushNumber(static_cast<double>(summary.max));
+		LUA->SetField(-2, "max");
+		LUA->SetField(-2, xconsole::stats::GetStageName(stage));
+	}
 
-		if (write(serverPipe, buffer.GetBuffer(), buffer.Size()) == -1)
-			serverConnected = false;
-#endif
+	// memory is in bytes, per subsystem and in total
+	LUA->CreateTable();
+	for (int k = 0; k < xconsole::memory::SUBSYSTEM_COUNT; ++k)
+	{
+		xconsole::memory::Subsystem subsystem = static_cast<xconsole::memory::Subsystem>(k);
+		xconsole::memory::Usage usage = xconsole::memory::GetUsage(subsystem);
+
+		LUA->CreateTable();
+		LUA->PushNumber(static_cast<double>(usage.current));
+		LUA->SetField(-2, "current");
+		LUA->PushNumber(static_cast<double>(usage.peak));
+		LUA->SetField(-2, "peak");
+		LUA->PushNumber(static_cast<double>(usage.quota));
+		LUA->SetField(-2, "quota");
+		LUA->SetField(-2, xconsole::memory::GetSubsystemName(subsystem));
 	}
-};
 
-ILoggingListener* listener = new XConsoleListener();
-#else
-static SpewOutputFunc_t spewFunction = nullptr;
-static SpewRetval_t EngineSpewReceiver(SpewType_t type, const char* msg)
-{
-	if (!serverConnected)
-		return spewFunction(type, msg);
-
-	const Color* color = GetSpewOutputColor();
-	MultiLibrary::ByteBuffer buffer;
-	buffer.Reserve(512);
-
-#ifdef _WIN32
-	buffer <<
-		static_cast<int32_t>(type) <<
-		GetSpewOutputLevel() <<
-		GetSpewOutputGroup() <<
-		color->GetRawColor() <<
-		msg;
-
-	if (WriteFile(serverPipe, buffer.GetBuffer(), static_cast<DWORD>(buffer.Size()), nullptr, nullptr) == FALSE)
-		serverConnected = false;
-#else
-	buffer <<
-		static_cast<int32_t>(type) <<
-		GetSpewOutputLevel() <<
-		GetSpewOutputGroup() <<
-		color->GetRawColor() <<
-		msg <<
-		"<EOL>";
-
-	if (serverPipe == -1)
 	{
-		serverConnected = false;
-		return spewFunction(type, msg);
+		xconsole::memory::Usage usage = xconsole::memory::GetTotal();
+
+		LUA->CreateTable();
+		LUA->PushNumber(static_cast<double>(usage.current));
+		LUA->SetField(-2, "current");
+		LUA->PushNumber(static_cast<double>(usage.peak));
+		LUA->SetField(-2, "peak");
+		LUA->PushNumber(static_cast<double>(usage.quota));
+		LUA->SetField(-2, "limit");
+		LUA->SetField(-2, "total");
 	}
+	LUA->SetField(-2, "memory");
 
-	if (write(serverPipe, buffer.GetBuffer(), buffer.Size()) == -1)
-		serverConnected = false;
-#endif
+	return 1;
+}
 
-	return spewFunction(type, msg);
+LUA_FUNCTION_STATIC(SetStatsEnabled)
+{
+	LUA->CheckType(1, GarrysMod::Lua::Type::Bool);
+	xconsole::stats::SetEnabled(LUA->GetBool(1));
+	return 0;
 }
-#endif
 
-static void RunCommand(std::string cmd)
+LUA_FUNCTION_STATIC(ResetStats)
 {
-	// in case the command hasnt been passed with a newline
-	if (cmd[cmd.length() - 1] != '\n')
-		cmd.append("\n");
+	xconsole::stats::Reset();
+	return 0;
+}
 
-	SourceSDK::FactoryLoader engine_loader("engine");
-	IVEngineServer* engine_server = engine_loader.GetInterface<IVEngineServer>(INTERFACEVERSION_VENGINESERVER);
-	engine_server->ServerCommand(cmd.c_str());
+// threshold in milliseconds, 0 disables hitch detection
+LUA_FUNCTION_STATIC(SetHitchThreshold)
+{
+	double milliseconds = LUA->CheckNumber(1);
+	xconsole::ticks::SetHitchThreshold(milliseconds > 0 ? static_cast<uint64_t>(milliseconds * 1000000) : 0);
+	return 0;
+}
+
+LUA_FUNCTION_STATIC(SetTickTelemetry)
+{
+	LUA->CheckType(1, GarrysMod::Lua::Type::Bool);
+	xconsole::ticks::SetTelemetryEnabled(LUA->GetBool(1));
+	return 0;
+}
+
+// rate in records per second, burst defaults to rate; 0 disables sampling
+LUA_FUNCTION_STATIC(SetDefaultBudget)
+{
+	double rate = LUA->CheckNumber(1);
+	double burst = LUA->IsType(2, GarrysMod::Lua::Type::Number) ? LUA->GetNumber(2) : rate;
+	if (!xconsole::sampling::SetDefaultBudget({rate, burst}))
+		LUA->ArgError(std::isfinite(rate) && rate >= 0 ? 2 : 1, "must be a finite number, not negative");
+
+	return 0;
 }
 
-#ifdef _WIN32
-static void ReadIncomingCommands()
+// channel is a name or id, without a rate the channel uses the default budget again
+LUA_FUNCTION_STATIC(SetChannelBudget)
 {
-	MultiLibrary::ByteBuffer buffer;
-	buffer.Reserve(255);
-	buffer.Resize(255);
+	const char* name = LUA->CheckString(1);
+	int32_t channel;
+	if (!xconsole::FindChannel(name, channel))
+		LUA->ArgError(1, "unknown channel");
 
-	if (ReadFile(serverPipe, buffer.GetBuffer(), static_cast<DWORD>(buffer.Size()), nullptr, nullptr) == TRUE)
+	bool result;
+	if (LUA->IsType(2, GarrysMod::Lua::Type::Number))
 	{
-		if (buffer.Size() == 0) return;
+		double rate = LUA->GetNumber(2);
+		double burst = LUA->IsType(3, GarrysMod::Lua::Type::Number) ? LUA->GetNumber(3) : rate;
+		if (!xconsole::sampling::IsValid({rate, burst}))
+			LUA->ArgError(std::isfinite(rate) && rate >= 0 ? 3 : 2, "must be a finite number, not negative");
 
-		std::string cmd;
-		buffer >> cmd;
-		RunCommand(cmd);
+		result = xconsole::sampling::SetBudget(channel, {rate, burst});
+	}
+	else
+	{
+		result = xconsole::sampling::ClearBudget(channel);
 	}
+
+	LUA->PushBool(result);
+	return 1;
 }
 
-static void ServerThread()
+static bool AddEventValue(GarrysMod::Lua::ILuaBase* LUA, xconsole::events::Encoder& event, int index)
 {
-	while (!serverShutdown)
+	switch (LUA->GetType(index))
 	{
-		if (ConnectNamedPipe(serverPipe, nullptr) == FALSE)
-		{
-			DWORD error = GetLastError();
-			if (error == ERROR_NO_DATA)
-			{
-				DisconnectNamedPipe(serverPipe);
-				serverConnected = false;
-			}
-			else if (error == ERROR_PIPE_CONNECTED) {
-				serverConnected = true;
-				ReadIncomingCommands();
-			}
-		}
-		else
-		{
-			serverConnected = true;
-			ReadIncomingCommands();
-		}
+	case GarrysMod::Lua::Type::Bool:
+		event.AddBool(LUA->GetBool(index));
+		return true;
 
-		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	case GarrysMod::Lua::Type::Number:
+		event.AddNumber(LUA->GetNumber(index));
+		return true;
+
+	case GarrysMod::Lua::Type::String:
+	{
+		unsigned int length = 0;
+		const char* value = LUA->GetString(index, &length);
+		event.AddString(value, length);
+		return true;
+	}
+
+	default:
+		return false;
 	}
 }
-#else
-static void ServerThread()
+
+// Sends a flat table of booleans, numbers and strings (keys included) as a
+// binary event record under channel, without going through print
+LUA_FUNCTION_STATIC(Emit)
 {
-	std::vector<uint8_t> dataBuffer(255);
-	std::vector<uint8_t> buffer(255);
+	const char* channel = LUA->CheckString(1);
+	LUA->CheckType(2, GarrysMod::Lua::Type::Table);
+
+	// Lua only runs on the game thread
+	static xconsole::events::Encoder event;
+	event.Clear();
 
-	int eolIndex = 0;
-	while (!serverShutdown && serverPipeIn != -1)
+	LUA->PushNil();
+	while (LUA->Next(2))
 	{
-		int bytesRead = read(serverPipeIn, buffer.data(), buffer.size() - 1);
-		if (bytesRead > 0)
+		if (!AddEventValue(LUA, event, -2) || !AddEventValue(LUA, event, -1))
+			LUA->ArgError(2, "keys and values must be booleans, numbers or strings");
+
+		event.EndField();
+		LUA->Pop();
+	}
+
+	LUA->PushBool(xconsole::Emit(channel, event));
+	return 1;
+}
+
+// callback references of subscriptions, by id
+static std::unordered_map<uint32_t, int> subscribers;
+
+// filter is nil or a table with any of channel (name or id), severity (the
+// lowest one wanted), contains (text the message must contain) and patterns
+// (an array of texts it must also contain one of, ^ and $ anchor them),
+// callback gets an array of the matching records once per tick. Returns an
+// id for Unsubscribe.
+LUA_FUNCTION_STATIC(Subscribe)
+{
+	xconsole::subscriptions::Filter filter = {true, 0, 0, std::string(), -1};
+	std::vector<xconsole::patterns::Pattern> patterns;
+	if (!LUA->IsType(1, GarrysMod::Lua::Type::Nil))
+	{
+		LUA->CheckType(1, GarrysMod::Lua::Type::Table);
+
+		LUA->GetField(1, "channel");
+		if (!LUA->IsType(-1, GarrysMod::Lua::Type::Nil))
 		{
-			for (int i = 0; i < bytesRead; i++)
-			{
-				uint8_t currentByte = buffer[i];
-				dataBuffer.push_back(currentByte);
+			if (!LUA->IsType(-1, GarrysMod::Lua::Type::String) && !LUA->IsType(-1, GarrysMod::Lua::Type::Number))
+				LUA->ArgError(1, "channel must be a name or an id");
 
-				// Check if the current byte matches the next byte in the EOL sequence
-				if (currentByte == EOL_SEQUENCE[eolIndex])
-				{
-					eolIndex++;
-					if (eolIndex == std::strlen(EOL_SEQUENCE)) // Full EOL found
-					{
-						dataBuffer.erase(dataBuffer.end() - eolIndex, dataBuffer.end());
+			if (LUA->IsType(-1, GarrysMod::Lua::Type::Number))
+				filter.channel = static_cast<int32_t>(LUA->GetNumber(-1));
+			else if (!xconsole::FindChannel(LUA->GetString(-1), filter.channel))
+				LUA->ArgError(1, "unknown channel");
+
+			filter.anyChannel = false;
+		}
 
-						std::string cmd(dataBuffer.begin(), dataBuffer.end());
-						RunCommand(cmd);
+		LUA->GetField(1, "severity");
+		if (LUA->IsType(-1, GarrysMod::Lua::Type::Number))
+			filter.severity = static_cast<int32_t>(LUA->GetNumber(-1));
 
-						dataBuffer.clear();
-						eolIndex = 0;
-					}
-				}
-				else
+		LUA->GetField(1, "contains");
+		if (LUA->IsType(-1, GarrysMod::Lua::Type::String))
+			filter.contains = LUA->GetString(-1);
+
+		LUA->GetField(1, "patterns");
+		if (LUA->IsType(-1, GarrysMod::Lua::Type::Table))
+		{
+			for (int k = 1; ; ++k)
+			{
+				LUA->PushNumber(k);
+				LUA->GetTable(-2);
+				if (!LUA->IsType(-1, GarrysMod::Lua::Type::String))
 				{
-					eolIndex = 0;
+					LUA->Pop();
+					break;
 				}
+
+				patterns.push_back(xconsole::patterns::Parse(LUA->GetString(-1)));
+				LUA->Pop();
 			}
 		}
 
-		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		LUA->Pop(4);
 	}
+
+	LUA->CheckType(2, GarrysMod::Lua::Type::Function);
+	if (!patterns.empty())
+	{
+		filter.patterns = xconsole::patterns::Register(patterns);
+		if (filter.patterns == xconsole::patterns::REGISTER_OVER_BUDGET)
+			LUA->ArgError(1, "pattern filters over memory budget");
+		else if (filter.patterns < 0)
+			LUA->ArgError(1, "too many pattern filters");
+	}
+
+	LUA->Push(2);
+	int callback = LUA->ReferenceCreate();
+
+	uint32_t id = xconsole::subscriptions::Add(filter);
+	subscribers[id] = callback;
+	LUA->PushNumber(id);
+	return 1;
 }
 
-static int CreateNamedPipe(GarrysMod::Lua::ILuaBase *LUA, const char* pipeName)
+LUA_FUNCTION_STATIC(Unsubscribe)
 {
-	struct stat sb;
-	if (stat(pipeName, &sb) == 0 && !(sb.st_mode & S_IFDIR))
+	uint32_t id = static_cast<uint32_t>(LUA->CheckNumber(1));
+	auto it = subscribers.find(id);
+	if (it == subscribers.end())
 	{
-		unlink(pipeName);
+		LUA->PushBool(false);
+		return 1;
 	}
 
-   	if (mkfifo(pipeName, 0666) == -1)
+	xconsole::subscriptions::Remove(id);
+	LUA->ReferenceFree(it->second);
+	subscribers.erase(it);
+	LUA->PushBool(true);
+	return 1;
+}
+
+static void PushRecord(GarrysMod::Lua::ILuaBase* LUA, const xconsole::subscriptions::Record& record)
+{
+	LUA->CreateTable();
+	LUA->PushNumber(record.channel);
+	LUA->SetField(-2, "channel");
+	LUA->PushNumber(record.severity);
+	LUA->SetField(-2, "severity");
+	LUA->PushString(record.name.c_str());
+	LUA->SetField(-2, "name");
+	LUA->PushNumber(record.color);
+	LUA->SetField(-2, "color");
+	LUA->PushString(record.message.c_str(), static_cast<unsigned int>(record.message.size()));
+	LUA->SetField(-2, "message");
+	LUA->PushNumber(static_cast<double>(record.timestamp));
+	LUA->SetField(-2, "timestamp");
+	LUA->PushNumber(record.tick);
+	LUA->SetField(-2, "tick");
+}
+
+// Calls every subscriber that has records with all of them at once, so Lua
+// is entered once per subscriber and tick, and only from the game thread.
+// Errors in a callback are reported without stopping the others.
+static void DeliverSubscriptions(GarrysMod::Lua::ILuaBase* LUA)
+{
+	static xconsole::subscriptions::Batch batch;
+	xconsole::subscriptions::Take(batch);
+	for (const xconsole::subscriptions::Match& match : batch.matches)
 	{
-		LUA->ThrowError( "failed to create named pipe (mkfifo)" );
-		return -1;
+		// callbacks can unsubscribe others
+		auto it = subscribers.find(match.subscription);
+		if (it == subscribers.end())
+			continue;
+
+		LUA->ReferencePush(it->second);
+		LUA->CreateTable();
+		for (size_t k = 0; k < match.records.size(); ++k)
+		{
+			LUA->PushNumber(static_cast<double>(k + 1));
+			PushRecord(LUA, batch.records[match.records[k]]);
+			LUA->SetTable(-3);
+		}
+
+		if (LUA->PCall(1, 0, 0) != 0)
+		{
+			LUA->PushSpecial(GarrysMod::Lua::SPECIAL_GLOB);
+			LUA->GetField(-1, "ErrorNoHalt");
+			LUA->Push(-3);
+			LUA->PushString("\n");
+			LUA->Call(2, 0);
+			LUA->Pop(2);
+		}
 	}
-	else
+}
+
+// Goes over every registered command so the index served to consoles stays
+// current, hidden and development only ones are left out
+static void RefreshCvars()
+{
+	uint64_t now = xconsole::stats::Now();
+	if (cvar == nullptr || !xconsole::cvars::IsDue(now))
+		return;
+
+	for (const ConCommandBase* command = cvar->GetCommands(); command != nullptr; command = command->GetNext())
+	{
+		if (command->IsFlagSet(FCVAR_DEVELOPMENTONLY | FCVAR_HIDDEN))
+			continue;
+
+		const char* value = "";
+		if (!command->IsCommand() && !command->IsFlagSet(FCVAR_PROTECTED))
+			value = static_cast<const ConVar*>(command)->GetString();
+
+		const char* help = command->GetHelpText();
+		xconsole::cvars::Update(command->GetName(), command->IsCommand(), command->GetFlags(), value, help != nullptr ? help : "");
+	}
+
+	xconsole::cvars::Commit(now);
+}
+
+// Global change callback, passes on the new value of watched convars when
+// it differs from the old one
+static void OnCvarChanged(IConVar* var, const char* oldValue, float oldNumber)
+{
+	ConVar* convar = static_cast<ConVar*>(var);
+	const char* value = convar->GetString();
+	if ((oldValue != nullptr && std::strcmp(value, oldValue) == 0) || !xconsole::watches::IsWatched(convar->GetName()))
+		return;
+
+	xconsole::SendCvar(convar->GetName(), convar->IsFlagSet(FCVAR_PROTECTED) ? "" : value);
+}
+
+// Starts watching what consoles asked for, each of them gets the current
+// value first
+static void ApplyWatches()
+{
+	static std::vector<std::string> names;
+	names.clear();
+	xconsole::watches::Apply(names);
+	if (cvar == nullptr)
+		return;
+
+	for (const std::string& name : names)
 	{
-		int pipe = open(pipeName, O_RDWR | O_NONBLOCK);
-		if (pipe == -1)
+		const ConVar* convar = cvar->FindVar(name.c_str());
+		if (convar != nullptr)
+			xconsole::SendCvar(convar->GetName(), convar->IsFlagSet(FCVAR_PROTECTED) ? "" : convar->GetString());
+	}
+}
+
+// Fills the answer to status requests with what the status command shows
+static void TakeStatus(xconsole::status::Snapshot& snapshot)
+{
+	CGlobalVars* globals = playerInfoManager != nullptr ? playerInfoManager->GetGlobalVars() : nullptr;
+	if (globals == nullptr)
+		return;
+
+	snapshot.map = STRING(globals->mapname);
+	snapshot.maxPlayers = globals->maxClients;
+	for (int index = 1; index <= globals->maxClients; ++index)
+	{
+		edict_t* edict = engineServer->PEntityOfEntIndex(index);
+		IPlayerInfo* info = edict != nullptr ? playerInfoManager->GetPlayerInfo(edict) : nullptr;
+		if (info == nullptr || !info->IsConnected())
+			continue;
+
+		xconsole::status::Player player;
+		player.userID = info->GetUserID();
+		player.name = info->GetName();
+		player.steamID = info->GetNetworkIDString();
+		player.bot = info->IsFakeClient();
+		player.ping = 0;
+		player.loss = 0;
+		player.connected = 0;
+
+		// bots have no net channel
+		INetChannelInfo* channel = engineServer->GetPlayerNetInfo(index);
+		if (channel != nullptr)
 		{
-			LUA->ThrowError( "failed to create named pipe (open)" );
+			player.ping = static_cast<int32_t>(channel->GetAvgLatency(FLOW_OUTGOING) * 1000.0f);
+			player.loss = static_cast<int32_t>(channel->GetAvgLoss(FLOW_INCOMING) * 100.0f);
+			player.connected = static_cast<int32_t>(channel->GetTimeConnected());
 		}
 
-		serverConnected = pipe != -1;
-		return pipe;
+		snapshot.players.push_back(std::move(player));
 	}
 }
-#endif
+
+// Tick hook, records get stamped with engine.TickCount() and subscribers get
+// what matched during the previous tick
+LUA_FUNCTION_STATIC(OnTick)
+{
+	LUA->PushSpecial(GarrysMod::Lua::SPECIAL_GLOB);
+	LUA->GetField(-1, "engine");
+	LUA->GetField(-1, "TickCount");
+	LUA->Call(0, 1);
+	uint32_t tick = static_cast<uint32_t>(LUA->GetNumber(-1));
+	xconsole::Tick(tick);
+	LUA->Pop(3);
+
+	DeliverSubscriptions(LUA);
+	ApplyWatches();
+	xconsole::status::Serve(tick, TakeStatus, xconsole::SendStatus);
+	RefreshCvars();
+	return 0;
+}
+
+static void SetTickHook(GarrysMod::Lua::ILuaBase* LUA, bool enabled)
+{
+	LUA->PushSpecial(GarrysMod::Lua::SPECIAL_GLOB);
+	LUA->GetField(-1, "hook");
+	if (LUA->IsType(-1, GarrysMod::Lua::Type::Table))
+	{
+		LUA->GetField(-1, enabled ? "Add" : "Remove");
+		LUA->PushString("Tick");
+		LUA->PushString("xconsole");
+		if (enabled)
+			LUA->PushCFunction(OnTick);
+
+		LUA->Call(enabled ? 3 : 2, 0);
+	}
+
+	LUA->Pop(2);
+}
 
 GMOD_MODULE_OPEN()
 {
-#ifdef _WIN32
-	SECURITY_DESCRIPTOR sd;
-	InitializeSecurityDescriptor(&sd, SECURITY_DESCRIPTOR_REVISION);
-	SetSecurityDescriptorDacl(&sd, TRUE, nullptr, FALSE);
-
-	SECURITY_ATTRIBUTES sa;
-	sa.nLength = sizeof(sa);
-	sa.lpSecurityDescriptor = &sd;
-	sa.bInheritHandle = FALSE;
-
-	serverPipe = CreateNamedPipe(
-		"\\\\.\\pipe\\garrysmod_console",
-		PIPE_ACCESS_DUPLEX,
-		PIPE_TYPE_MESSAGE | PIPE_NOWAIT,
-		PIPE_UNLIMITED_INSTANCES,
-		16384,
-		16384,
-		NMPWAIT_USE_DEFAULT_WAIT,
-		&sa
+	SourceSDK::FactoryLoader engine_loader("engine");
+	engineServer = engine_loader.GetInterface<IVEngineServer>(INTERFACEVERSION_VENGINESERVER);
+	if (engineServer == nullptr)
+		LUA->ThrowError("failed to get IVEngineServer interface");
+
+	// status answers only have the map and players with the player info
+	// manager
+	SourceSDK::FactoryLoader server_loader("server");
+	playerInfoManager = server_loader.GetInterface<IPlayerInfoManager>(INTERFACEVERSION_PLAYERINFOMANAGER);
+
+	// the cvar index is optional, cvars requests say so when it's missing
+	SourceSDK::FactoryLoader cvar_loader("vstdlib");
+	cvar = cvar_loader.GetInterface<ICvar>(CVAR_INTERFACE_VERSION);
+
+	// -xconsole_shm <megabytes> publishes records to a shared memory ring too,
+	// -xconsole_nopipe stops writing them to the output pipe and
+	// -xconsole_scrollback <megabytes> sizes the replay buffer (0 disables it),
+	// -xconsole_hitch <milliseconds> sets the hitch threshold (0 disables it)
+	// -xconsole_ticks sends telemetry for every tick and -xconsole_budget
+	// <records per second> sets the default channel budget (0 disables sampling),
+	// -xconsole_memory <megabytes> caps the memory of all buffers,
+	// -xconsole_egress <megabytes> sizes the egress queue and -xconsole_lines
+	// <milliseconds> sets how long partial lines wait for the rest (0 disables it),
+	// -xconsole_endpoint <template> names the endpoints, from {port}, {pid}
+	// and {hostname} (as given with +hostname) and -xconsole_capture <file>
+	// records every command received for the replay tool
+	xconsole::Options options;
+	options.port = CommandLine()->ParmValue("-port", 27015);
+	options.endpointName = xconsole::endpoints::Expand(
+		CommandLine()->ParmValue("-xconsole_endpoint", xconsole::endpoints::DEFAULT_NAME),
+		options.port,
+		CommandLine()->ParmValue("+hostname", "")
 	);
+	options.lineTimeout = static_cast<uint64_t>(CommandLine()->ParmValue("-xconsole_lines", 20)) * 1000000;
+	options.memoryLimit = static_cast<size_t>(CommandLine()->ParmValue("-xconsole_memory", 32)) * 1024 * 1024;
+	options.egressQueueSize = static_cast<size_t>(CommandLine()->ParmValue("-xconsole_egress", 6)) * 1024 * 1024;
+	options.sharedMemorySize = static_cast<size_t>(CommandLine()->ParmValue("-xconsole_shm", 0)) * 1024 * 1024;
+	options.pipeOutput = CommandLine()->CheckParm("-xconsole_nopipe") == nullptr;
+	options.scrollbackSize = static_cast<size_t>(CommandLine()->ParmValue("-xconsole_scrollback", 1)) * 1024 * 1024;
+	options.hitchThreshold = static_cast<uint64_t>(CommandLine()->ParmValue("-xconsole_hitch", 100)) * 1000000;
+	options.tickTelemetry = CommandLine()->CheckParm("-xconsole_ticks") != nullptr;
+	options.channelBudget = std::max(CommandLine()->ParmValue("-xconsole_budget", 1000), 0);
+	options.channelBurst = options.channelBudget * 2;
+	options.capturePath = CommandLine()->ParmValue("-xconsole_capture", "");
+
+	const char* error = nullptr;
+	if (!xconsole::Initialize(engineServer, options, error))
+	{
+		xconsole::Shutdown();
+		LUA->ThrowError(error);
+	}
+
+	if (cvar != nullptr)
+		cvar->InstallGlobalChangeCallback(OnCvarChanged);
+
+	LUA->PushSpecial(GarrysMod::Lua::SPECIAL_GLOB);
+	LUA->CreateTable();
+
+	LUA->PushCFunction(GetStats);
+	LUA->SetField(-2, "GetStats");
+
+	LUA->PushCFunction(SetStatsEnabled);
+	LUA->SetField(-2, "SetStatsEnabled");
 
-	if (serverPipe == INVALID_HANDLE_VALUE)
-		LUA->ThrowError( "failed to create named pipe" );
-#else
-	serverPipe = CreateNamedPipe(LUA, PIPE_NAME_OUT);
-	serverPipeIn = CreateNamedPipe(LUA, PIPE_NAME_IN);
-#endif
+	LUA->PushCFunction(ResetStats);
+	LUA->SetField(-2, "ResetStats");
 
-	serverThread = std::thread(ServerThread);
+	LUA->PushCFunction(SetHitchThreshold);
+	LUA->SetField(-2, "SetHitchThreshold");
 
-#if ARCHITECTURE_IS_X86_64
-	LoggingSystem_PushLoggingState(false, false);
-	LoggingSystem_RegisterLoggingListener(listener);
-#else
-	spewFunction = GetSpewOutputFunc();
-	SpewOutputFunc(EngineSpewReceiver);
-#endif
+	LUA->PushCFunction(SetTickTelemetry);
+	LUA->SetField(-2, "SetTickTelemetry");
 
+	LUA->PushCFunction(SetDefaultBudget);
+	LUA->SetField(-2, "SetDefaultBudget");
+
+	LUA->PushCFunction(SetChannelBudget);
+	LUA->SetField(-2, "SetChannelBudget");
+
+	LUA->PushCFunction(Emit);
+	LUA->SetField(-2, "Emit");
+
+	LUA->PushCFunction(Subscribe);
+	LUA->SetField(-2, "Subscribe");
+
+	LUA->PushCFunction(Unsubscribe);
+	LUA->SetField(-2, "Unsubscribe");
+
+	LUA->SetField(-2, "xconsole");
+	LUA->Pop();
+
+	SetTickHook(LUA, true);
 	return 0;
 }
 
 GMOD_MODULE_CLOSE()
 {
-#if ARCHITECTURE_IS_X86_64
-	LoggingSystem_UnregisterLoggingListener(listener);
-	LoggingSystem_PopLoggingState(false);
-	delete listener;
-#else
-	SpewOutputFunc(spewFunction);
-#endif
-
-	serverShutdown = true;
-	serverThread.join();
-
-#ifdef _WIN32
-	FlushFileBuffers(serverPipe);
-	DisconnectNamedPipe(serverPipe);
-	CloseHandle(serverPipe);
-#else
-	close(serverPipe);
-	unlink(PIPE_NAME_OUT);
-
-	close(serverPipeIn);
-	unlink(PIPE_NAME_IN);
-#endif
-
+	SetTickHook(LUA, false);
+	if (cvar != nullptr)
+		cvar->RemoveGlobalChangeCallback(OnCvarChanged);
+
+	LUA->PushSpecial(GarrysMod::Lua::SPECIAL_GLOB);
+	LUA->PushNil();
+	LUA->SetField(-2, "xconsole");
+	LUA->Pop();
+
+	for (const auto& subscriber : subscribers)
+		LUA->ReferenceFree(subscriber.second);
+
+	subscribers.clear();
+	xconsole::Shutdown();
+	cvar = nullptr;
+	playerInfoManager = nullptr;
 	return 0;
-}
+}
\ No newline at end of file
@@ -0,0 +1,425 @@
+// Unit tests for the parts of xconsole that don't need the engine. Only
+// depends on the sources in /source, like the benchmarks.
+//
+// usage: xconsole_tests [filter]
+//   filter  only run tests whose name contains this string
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <ByteBuffer.hpp>
+#include <InputStream.hpp>
+#include <Memory.hpp>
+#include <Outbound.hpp>
+#include <Patterns.hpp>
+#include <Sampling.hpp>
+#include <Subscriptions.hpp>
+#include <Varint.hpp>
+#include <xconsole/Client.hpp>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+static int failures = 0;
+
+static void Check(bool condition, const char* expression, const char* file, int line)
+{
+	if (condition)
+		return;
+
+	std::printf("  %s:%d: %s\n", file, line, expression);
+	++failures;
+}
+
+#define CHECK(condition) Check((condition), #condition, __FILE__, __LINE__)
+
+// Input stream over a fixed array that goes through the generic
+// InputStream::ReadVarint, unlike ByteBuffer.
+class ArrayStream : public MultiLibrary::InputStream
+{
+public:
+	ArrayStream(const uint8_t* data, size_t size) :
+		data(data),
+		size(size),
+		offset(0)
+	{ }
+
+	bool IsValid() const override { return true; }
+	int64_t Tell() const override { return static_cast<int64_t>(offset); }
+	int64_t Size() const override { return static_cast<int64_t>(size); }
+	bool EndOfFile() const override { return offset >= size; }
+
+	bool Seek(int64_t position, MultiLibrary::SeekMode mode) override
+	{
+		if (mode != MultiLibrary::SEEKMODE_SET || position < 0 || static_cast<size_t>(position) > size)
+			return false;
+
+		offset = static_cast<size_t>(position);
+		return true;
+	}
+
+	size_t Read(void* output, size_t wanted) override
+	{
+		size_t read = std::min(wanted, size - offset);
+		std::memcpy(output, data + offset, read);
+		offset += read;
+		return read;
+	}
+
+private:
+	const uint8_t* data;
+	size_t size;
+	size_t offset;
+};
+
+static const uint64_t VARINT_VALUES[] = {
+	0, 1, 127, 128, 255, 300, 16383, 16384, 2097151, 2097152,
+	0xFFFFFFFFULL, 0x100000000ULL, (1ULL << 56) - 1, 1ULL << 56,
+	1ULL << 63, std::numeric_limits<uint64_t>::max()
+};
+
+static void TestVarintRoundTrip()
+{
+	for (uint64_t value : VARINT_VALUES)
+	{
+		// exact size goes through the byte at a time decoder, padding
+		// through the word at a time one
+		uint8_t encoded[MultiLibrary::Varint::MaxSize + 8] = {};
+		size_t size = MultiLibrary::Varint::Encode(value, encoded);
+		CHECK(size == MultiLibrary::Varint::EncodedSize(value));
+
+		uint64_t decoded = 0;
+		CHECK(MultiLibrary::Varint::Decode(encoded, size, decoded) == size);
+		CHECK(decoded == value);
+
+		decoded = 0;
+		CHECK(MultiLibrary::Varint::Decode(encoded, sizeof(encoded), decoded) == size);
+		CHECK(decoded == value);
+	}
+
+	const int64_t signedValues[] = {0, -1, 1, -64, 64, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max()};
+	for (int64_t value : signedValues)
+		CHECK(MultiLibrary::Varint::ZigZagDecode(MultiLibrary::Varint::ZigZagEncode(value)) == value);
+
+	CHECK(MultiLibrary::Varint::ZigZagEncode(-1) == 1);
+	CHECK(MultiLibrary::Varint::ZigZagEncode(1) == 2);
+}
+
+static void TestVarintMalformed()
+{
+	const uint64_t untouched = 12345;
+
+	// continuation bits all the way, too long for 64 bits
+	uint8_t endless[16];
+	std::memset(endless, 0x80, sizeof(endless));
+	uint64_t value = untouched;
+	CHECK(MultiLibrary::Varint::Decode(endless, sizeof(endless), value) == 0);
+	CHECK(MultiLibrary::Varint::Decode(endless, MultiLibrary::Varint::MaxSize, value) == 0);
+	CHECK(value == untouched);
+
+	// tenth byte carrying more than the last bit
+	uint8_t overflow[MultiLibrary::Varint::MaxSize];
+	std::memset(overflow, 0xFF, sizeof(overflow));
+	overflow[MultiLibrary::Varint::MaxSize - 1] = 0x02;
+	CHECK(MultiLibrary::Varint::Decode(overflow, sizeof(overflow), value) == 0);
+	CHECK(value == untouched);
+
+	// cut short, in both decoders
+	for (size_t size = 0; size < MultiLibrary::Varint::MaxSize; ++size)
+		CHECK(MultiLibrary::Varint::Decode(endless, size, value) == 0);
+
+	CHECK(value == untouched);
+}
+
+static void TestVarintStreams()
+{
+	MultiLibrary::ByteBuffer buffer;
+	for (uint64_t value : VARINT_VALUES)
+		CHECK(buffer.WriteVarint(value) == MultiLibrary::Varint::EncodedSize(value));
+
+	CHECK(buffer.WriteZigZag(-300) == 2);
+
+	buffer.Seek(0);
+	for (uint64_t value : VARINT_VALUES)
+	{
+		uint64_t decoded = 0;
+		CHECK(buffer.ReadVarint(decoded) != 0);
+		CHECK(decoded == value);
+	}
+
+	int64_t negative = 0;
+	CHECK(buffer.ReadZigZag(negative) == 2);
+	CHECK(negative == -300);
+
+	// a truncated value is not consumed, by either implementation
+	const uint8_t truncated[] = {0x05, 0x80, 0x80};
+	MultiLibrary::ByteBuffer cut(truncated, sizeof(truncated));
+	uint64_t value = 0;
+	CHECK(cut.ReadVarint(value) == 1 && value == 5);
+	CHECK(cut.ReadVarint(value) == 0);
+	CHECK(cut.Tell() == 1);
+
+	ArrayStream stream(truncated, sizeof(truncated));
+	MultiLibrary::InputStream& input = stream;
+	CHECK(input.ReadVarint(value) == 1 && value == 5);
+	CHECK(input.ReadVarint(value) == 0);
+	CHECK(input.Tell() == 1);
+
+	uint8_t overflow[MultiLibrary::Varint::MaxSize];
+	std::memset(overflow, 0xFF, sizeof(overflow));
+	overflow[MultiLibrary::Varint::MaxSize - 1] = 0x02;
+	ArrayStream malformed(overflow, sizeof(overflow));
+	MultiLibrary::InputStream& malformedInput = malformed;
+	CHECK(malformedInput.ReadVarint(value) == 0);
+	CHECK(malformedInput.Tell() == 0);
+}
+
+struct Test
+{
+	const char* name;
+	void (*run)();
+};
+
+// Records logged by other threads can reach the sampler with an older
+// timestamp than the last one, that must not refill the bucket.
+static void TestSamplingOutOfOrder()
+{
+	using namespace xconsole;
+
+	sampling::Reset();
+	CHECK(sampling::SetBudget(1, {1, 1}));
+
+	const uint64_t second = 1000000000;
+	uint64_t kept = 0;
+	for (uint64_t i = 0; i < 8; ++i)
+		kept += sampling::Admit(1, false, 10 * second - i * second / 10);
+
+	// the token, then 1 in 2 of the other 7
+	CHECK(kept == 5);
+
+	sampling::Reset();
+}
+
+// Budgets that would leave the bucket empty for good are refused, and a
+// burst under 1 still lets a record through.
+static void TestSamplingInvalidBudget()
+{
+	using namespace xconsole;
+
+	sampling::Reset();
+	CHECK(!sampling::SetBudget(1, {1, -1}));
+	CHECK(!sampling::SetBudget(1, {-1, 1}));
+	CHECK(!sampling::SetBudget(1, {std::nan(""), 1}));
+	CHECK(!sampling::SetBudget(1, {1, std::numeric_limits<double>::infinity()}));
+	CHECK(!sampling::SetDefaultBudget({1, -1}));
+
+	CHECK(sampling::SetBudget(1, {1, 0.5}));
+	CHECK(sampling::Admit(1, false, 1000000000));
+
+	sampling::Reset();
+}
+
+// The automaton in use still matches the patterns of a filter unregistered
+// since, so its bit can't go to a new filter before the next one is built.
+static void TestPatternsOwnerReuse()
+{
+	using namespace xconsole;
+
+	memory::Configure(1024 * 1024);
+	int first = patterns::Register({patterns::Parse("old")});
+	CHECK(first >= 0);
+	CHECK(patterns::Compile());
+
+	patterns::Unregister(first);
+	int second = patterns::Register({patterns::Parse("new")});
+	CHECK(second >= 0 && second != first);
+	CHECK((patterns::GetAutomaton()->Match("old\n", 4) & (uint64_t(1) << second)) == 0);
+
+	CHECK(patterns::Compile());
+	CHECK(patterns::Register({patterns::Parse("reused")}) == first);
+
+	patterns::Reset();
+}
+
+// A filter whose automaton doesn't fit when the writer thread first gets to
+// it is compiled once there is room, and a filter whose automaton can't fit
+// next to the one in use is refused up front.
+static void TestPatternsCompileRetry()
+{
+	using namespace xconsole;
+
+	memory::Configure(1024 * 1024);
+	memory::SetQuota(memory::SUBSYSTEM_PATTERNS, 64 * 1024);
+	int owner = patterns::Register({patterns::Parse("late")});
+	CHECK(owner >= 0);
+
+	CHECK(memory::Acquire(memory::SUBSYSTEM_PATTERNS, 64 * 1024 - 16));
+	CHECK(!patterns::Compile());
+	memory::Release(memory::SUBSYSTEM_PATTERNS, 64 * 1024 - 16);
+
+	CHECK(patterns::Compile());
+	std::shared_ptr<const patterns::Automaton> automaton = patterns::GetAutomaton();
+	CHECK(automaton != nullptr && (automaton->Match("too late\n", 9) & (uint64_t(1) << owner)) != 0);
+
+	memory::SetQuota(memory::SUBSYSTEM_PATTERNS, memory::GetUsage(memory::SUBSYSTEM_PATTERNS).current + 64);
+	CHECK(patterns::Register({patterns::Parse(std::string(200, 'x'))}) == patterns::REGISTER_OVER_BUDGET);
+
+	automaton.reset();
+	patterns::Reset();
+}
+
+// contains is required on top of the patterns, not one more of them.
+static void TestSubscriptionContainsAndPatterns()
+{
+	using namespace xconsole;
+
+	memory::Configure(1024 * 1024);
+	subscriptions::Filter filter = {true, 0, 0, "X", patterns::Register({patterns::Parse("A")})};
+	CHECK(filter.patterns >= 0);
+	CHECK(patterns::Compile());
+	subscriptions::Add(filter);
+
+	const char* messages[] = {"only A\n", "only X\n", "A and X\n", "neither\n"};
+	for (const char* message : messages)
+		subscriptions::Offer(0, 0, "test", 0, message, 0, 0);
+
+	subscriptions::Batch batch;
+	subscriptions::Take(batch);
+	CHECK(batch.records.size() == 1);
+	CHECK(batch.records.size() == 1 && batch.records[0].message == "A and X\n");
+
+	subscriptions::Reset();
+	patterns::Reset();
+}
+
+#ifndef _WIN32
+// A record given up on goes out as as many bytes, zeros but for its tail,
+// even when the tail is spread over several vectors.
+static void TestOutboundPad()
+{
+	using namespace xconsole;
+
+	int descriptors[2];
+	CHECK(pipe(descriptors) == 0);
+
+	std::string record = std::string(100, 'x') + "tail<EOL>";
+	record.push_back('\0');
+	iovec vectors[] = {
+		{&record[0], 95},
+		{&record[95], 10},
+		{&record[105], record.size() - 105}
+	};
+
+	OutboundBuffer outbound;
+	outbound.Pad(vectors, 3);
+	CHECK(outbound.Size() == record.size());
+	CHECK(outbound.Drain(descriptors[1]));
+	CHECK(outbound.IsEmpty());
+
+	std::string expected = std::string(record.size() - OutboundBuffer::PAD_TAIL_SIZE, '\0') + record.substr(record.size() - OutboundBuffer::PAD_TAIL_SIZE);
+	std::string written(record.size() + 1, ' ');
+	CHECK(read(descriptors[0], &written[0], written.size()) == static_cast<ssize_t>(record.size()));
+	written.resize(record.size());
+	CHECK(written == expected);
+
+	close(descriptors[0]);
+	close(descriptors[1]);
+}
+#endif
+
+// A record in format 1: channel, severity, name, colour, message, terminator.
+static void AppendRecord(std::string& stream, int32_t channel, const char* name, const std::string& message)
+{
+	const int32_t zero = 0;
+	stream.append(reinterpret_cast<const char*>(&channel), sizeof(channel));
+	stream.append(reinterpret_cast<const char*>(&zero), sizeof(zero));
+	stream.append(name, std::strlen(name) + 1);
+	stream.append(reinterpret_cast<const char*>(&zero), sizeof(zero));
+	stream.append(message.c_str(), message.size() + 1);
+	stream.append(xconsole::client::TERMINATOR, xconsole::client::TERMINATOR_SIZE);
+}
+
+// Records handed out in one call stay valid when the block they came from
+// runs out before the batch is full, the next block isn't decompressed over
+// them.
+static void TestClientBlockBoundary()
+{
+	using namespace xconsole;
+
+	std::string stream;
+	AppendRecord(stream, client::CONTROL_CHANNEL, "xconsole", "compress on\n");
+	std::vector<std::string> expected;
+	for (char prefix : {'A', 'B'})
+	{
+		std::string records;
+		for (int k = 0; k < 64; ++k)
+		{
+			expected.push_back(prefix + std::to_string(k) + "\n");
+			AppendRecord(records, 0, "test", expected.back());
+		}
+
+		// stored as is, with the same size for the records and the payload
+		uint8_t header[2 * MultiLibrary::Varint::MaxSize];
+		size_t size = MultiLibrary::Varint::Encode(records.size(), header);
+		size += MultiLibrary::Varint::Encode(records.size(), header + size);
+		stream.append(reinterpret_cast<const char*>(header), size);
+		stream += records;
+	}
+
+	client::Decoder decoder;
+	size_t room;
+	char* target = decoder.Prepare(room);
+	CHECK(room >= stream.size());
+	std::memcpy(target, stream.data(), stream.size());
+	decoder.Commit(stream.size());
+
+	client::Record records[10];
+	std::vector<std::string> decoded;
+	while (size_t count = decoder.Decode(records, 10))
+		for (size_t k = 0; k < count; ++k)
+			if (records[k].channel == 0)
+				decoded.emplace_back(records[k].message);
+
+	CHECK(decoded == expected);
+	CHECK(decoder.GetMalformed() == 0);
+}
+
+static const Test TESTS[] = {
+	{"varint/round_trip", TestVarintRoundTrip},
+	{"varint/malformed", TestVarintMalformed},
+	{"varint/streams", TestVarintStreams},
+	{"sampling/out_of_order", TestSamplingOutOfOrder},
+	{"sampling/invalid_budget", TestSamplingInvalidBudget},
+	{"patterns/owner_reuse", TestPatternsOwnerReuse},
+	{"patterns/compile_retry", TestPatternsCompileRetry},
+	{"subscriptions/contains_and_patterns", TestSubscriptionContainsAndPatterns},
+	{"client/block_boundary", TestClientBlockBoundary},
+#ifndef _WIN32
+	{"outbound/pad", TestOutboundPad},
+#endif
+};
+
+int main(int argc, char** argv)
+{
+	const char* filter = argc > 1 ? argv[1] : "";
+	int failed = 0;
+	for (const Test& test : TESTS)
+	{
+		if (std::strstr(test.name, filter) == nullptr)
+			continue;
+
+		int before = failures;
+		test.run();
+		std::printf("%s %s\n", failures == before ? "ok  " : "FAIL", test.name);
+		failed += failures != before;
+	}
+
+	return failed == 0 ? 0 : 1;
+}
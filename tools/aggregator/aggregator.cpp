@@ -0,0 +1,673 @@
+// Aggregator for the servers of a host. Discovers every xconsole instance
+// from its discovery file, reads all of their output pipes from a single
+// epoll loop, and re-publishes their records as one stream merged in
+// timestamp order, each tagged with the id of the server it came from.
+//
+// Every record on the output socket is a varint server id, the varint
+// sequence number, tick and timestamp of the record on its server, then the
+// record in the legacy layout with its <EOL>\0 terminator (format 3 with the
+// server id in front). Server id 0 is the aggregator itself, it sends an
+// "attach <id> <endpoint> <pid> <port>" record when it starts reading a
+// server and "detach <id>" when it stops, on channel -1 like replies. Ids
+// stay the same for an endpoint when its server restarts.
+//
+// Records are held for the reorder window and released oldest first, so the
+// stream is in timestamp order unless a record arrives later than that.
+//
+// usage: xconsole_aggregator [options]
+//   --socket PATH   unix stream socket to serve the merged stream on (default /tmp/xconsole_aggregate)
+//   --shm N         also publish to a shared memory ring of N megabytes (default 0, off)
+//   --ring NAME     name of that ring (default /xconsole_aggregate)
+//   --window N      reorder window in milliseconds (default 20)
+//   --backlog N     megabytes of records held back at most, the oldest go out
+//                   early past that (default 16)
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <Endpoints.hpp>
+#include <SharedRing.hpp>
+#include <Varint.hpp>
+
+static const char EOL_SEQUENCE[] = "<EOL>";
+
+// what the module is asked for when the aggregator attaches to it, anything
+// it sent before the format 3 reply is skipped
+static const char SETUP_REQUEST[] = "\x01" "compress off<EOL>" "\x01" "filter<EOL>" "\x01" "format 3<EOL>";
+static const char SETUP_REPLY[] = "\xff\xff\xff\xff\0\0\0\0xconsole\0\0\0\0\0format 3\n\0<EOL>";
+
+static const int32_t CONTROL_CHANNEL_ID = -1;
+static const char CONTROL_CHANNEL_NAME[] = "xconsole";
+
+// past this a server buffer holding no whole record is out of sync
+static const size_t MAX_SERVER_BUFFER = 4 * 1024 * 1024;
+// past this a client stops getting records until it catches up
+static const size_t MAX_CLIENT_BUFFER = 8 * 1024 * 1024;
+static const size_t READ_SIZE = 256 * 1024;
+static const int MAX_EVENTS = 64;
+
+// epoll tags, servers use their id
+static const uint64_t TAG_DISCOVERY = 1ULL << 32;
+static const uint64_t TAG_LISTENER = 2ULL << 32;
+static const uint64_t TAG_CLIENT = 3ULL << 32;
+
+struct Options
+{
+	std::string socketPath = "/tmp/xconsole_aggregate";
+	std::string ringName = "/xconsole_aggregate";
+	size_t sharedMemory = 0;
+	uint64_t window = 20000000;
+	size_t backlog = 16 * 1024 * 1024;
+};
+
+struct Server
+{
+	uint32_t id;
+	std::string name;
+	uint32_t pid;
+	int32_t port;
+	std::string input;
+	int output;
+	bool synced;
+	std::vector<char> buffer;
+	size_t used;
+};
+
+struct Client
+{
+	int descriptor;
+	std::string pending;
+	bool polling; // for room to write the rest of pending
+};
+
+// Record held in the reorder window. data is the record in the legacy layout
+// with its terminator.
+struct Held
+{
+	uint64_t timestamp;
+	uint64_t order;
+	uint32_t server;
+	uint64_t sequence;
+	uint32_t tick;
+	std::string data;
+};
+
+struct HeldLater
+{
+	bool operator()(const Held& left, const Held& right) const
+	{
+		return left.timestamp != right.timestamp ? left.timestamp > right.timestamp : left.order > right.order;
+	}
+};
+
+struct Totals
+{
+	uint64_t records = 0;
+	uint64_t bytes = 0;
+	uint64_t late = 0;
+	uint64_t early = 0;
+	uint64_t dropped = 0;
+	uint64_t resyncs = 0;
+};
+
+static volatile sig_atomic_t running = 1;
+
+static Options options;
+static int poller = -1;
+static std::map<std::string, uint32_t> serverIds;
+static std::map<uint32_t, Server> servers;
+static std::map<uint64_t, Client> clients;
+static uint64_t nextClient = 0;
+static std::priority_queue<Held, std::vector<Held>, HeldLater> held;
+static size_t heldBytes = 0;
+static uint64_t nextOrder = 0;
+static uint64_t lastReleased = 0;
+static xconsole::SharedRing ring;
+static Totals totals;
+
+static uint64_t Now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void Stop(int)
+{
+	running = 0;
+}
+
+static bool ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const char* name = argv[i];
+		const char* value = argv[i + 1];
+		if (std::strcmp(name, "--socket") == 0)
+			options.socketPath = value;
+		else if (std::strcmp(name, "--shm") == 0)
+			options.sharedMemory = std::strtoull(value, nullptr, 10) * 1024 * 1024;
+		else if (std::strcmp(name, "--ring") == 0)
+			options.ringName = value[0] == '/' ? value : std::string("/") + value;
+		else if (std::strcmp(name, "--window") == 0)
+			options.window = std::strtoull(value, nullptr, 10) * 1000000;
+		else if (std::strcmp(name, "--backlog") == 0)
+			options.backlog = std::max<size_t>(1, std::strtoull(value, nullptr, 10)) * 1024 * 1024;
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", name);
+			return false;
+		}
+	}
+
+	return argc % 2 == 1;
+}
+
+// Puts a record in the reorder window.
+static void Hold(uint32_t server, uint64_t sequence, uint32_t tick, uint64_t timestamp, const char* data, size_t size)
+{
+	held.push(Held{timestamp, nextOrder++, server, sequence, tick, std::string(data, size)});
+	heldBytes += size;
+}
+
+// Sends a record of the aggregator itself, stamped now.
+static void Announce(const std::string& message)
+{
+	std::string record(reinterpret_cast<const char*>(&CONTROL_CHANNEL_ID), sizeof(CONTROL_CHANNEL_ID));
+	record.append(4, '\0');
+	record.append(CONTROL_CHANNEL_NAME, sizeof(CONTROL_CHANNEL_NAME));
+	record.append(4, '\0');
+	record.append(message.c_str(), message.size() + 1);
+	record.append(EOL_SEQUENCE, sizeof(EOL_SEQUENCE));
+	Hold(0, 0, 0, Now(), record.data(), record.size());
+}
+
+static void Detach(Server& server)
+{
+	epoll_ctl(poller, EPOLL_CTL_DEL, server.output, nullptr);
+	close(server.output);
+	Announce("detach " + std::to_string(server.id) + "\n");
+	std::printf("detached %s (server %u)\n", server.name.c_str(), server.id);
+	servers.erase(server.id);
+}
+
+// Asks the module for the layout the aggregator reads, the records that
+// follow the format 3 reply are in it.
+static void Setup(Server& server)
+{
+	server.synced = false;
+	server.used = 0;
+	int descriptor = open(server.input.c_str(), O_WRONLY | O_NONBLOCK);
+	if (descriptor == -1 || write(descriptor, SETUP_REQUEST, sizeof(SETUP_REQUEST) - 1) != static_cast<ssize_t>(sizeof(SETUP_REQUEST) - 1))
+		std::fprintf(stderr, "failed to set up %s through %s\n", server.name.c_str(), server.input.c_str());
+
+	if (descriptor != -1)
+		close(descriptor);
+}
+
+static void Attach(const std::string& name)
+{
+	xconsole::endpoints::Instance instance;
+	if (!xconsole::endpoints::Read(name, instance) || instance.endpoints.output.empty())
+		return;
+
+	auto known = serverIds.find(name);
+	if (known != serverIds.end())
+	{
+		auto attached = servers.find(known->second);
+		if (attached != servers.end())
+		{
+			if (attached->second.pid == instance.pid)
+				return;
+
+			Detach(attached->second);
+		}
+	}
+	else
+	{
+		known = serverIds.emplace(name, static_cast<uint32_t>(serverIds.size() + 1)).first;
+	}
+
+	int output = open(instance.endpoints.output.c_str(), O_RDONLY | O_NONBLOCK);
+	if (output == -1)
+	{
+		std::fprintf(stderr, "failed to open %s\n", instance.endpoints.output.c_str());
+		return;
+	}
+
+	Server& server = servers[known->second];
+	server = Server{known->second, name, instance.pid, instance.port, instance.endpoints.input, output, false, std::vector<char>(READ_SIZE), 0};
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.u64 = server.id;
+	epoll_ctl(poller, EPOLL_CTL_ADD, output, &event);
+
+	Setup(server);
+	Announce("attach " + std::to_string(server.id) + " " + name + " " + std::to_string(instance.pid) + " " + std::to_string(instance.port) + "\n");
+	std::printf("attached %s (server %u, pid %u, port %d)\n", name.c_str(), server.id, instance.pid, static_cast<int>(instance.port));
+}
+
+static bool IsDiscoveryFile(const char* name)
+{
+	size_t length = std::strlen(name);
+	return name[0] != '.' && (length < 4 || std::strcmp(name + length - 4, ".tmp") != 0);
+}
+
+static void Discover()
+{
+	DIR* directory = opendir(xconsole::endpoints::DISCOVERY_DIRECTORY);
+	if (directory == nullptr)
+		return;
+
+	while (dirent* entry = readdir(directory))
+		if (IsDiscoveryFile(entry->d_name))
+			Attach(entry->d_name);
+
+	closedir(directory);
+}
+
+static void ServeDiscovery(int descriptor)
+{
+	alignas(inotify_event) char events[16384];
+	ssize_t size;
+	while ((size = read(descriptor, events, sizeof(events))) > 0)
+	{
+		for (ssize_t offset = 0; offset < size; )
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(events + offset);
+			offset += sizeof(inotify_event) + event->len;
+			if (event->len == 0 || !IsDiscoveryFile(event->name))
+				continue;
+
+			if ((event->mask & (IN_MOVED_TO | IN_CLOSE_WRITE)) != 0)
+			{
+				Attach(event->name);
+				continue;
+			}
+
+			// a server going away unlinks its file, the pipe reaching its end
+			// covers those that die without doing it
+			auto known = serverIds.find(event->name);
+			auto attached = known != serverIds.end() ? servers.find(known->second) : servers.end();
+			xconsole::endpoints::Instance instance;
+			if (attached != servers.end() && !xconsole::endpoints::Read(event->name, instance))
+				Detach(attached->second);
+		}
+	}
+}
+
+// Moves the whole records read from a server into the reorder window.
+static void Parse(Server& server)
+{
+	size_t offset = 0;
+	if (!server.synced)
+	{
+		const char* end = server.buffer.data() + server.used;
+		const char* begin = server.buffer.data();
+		const char* reply = std::search(begin, end, SETUP_REPLY, SETUP_REPLY + sizeof(SETUP_REPLY));
+		if (reply == end)
+		{
+			// keep what could be the start of the reply
+			offset = server.used - std::min(server.used, sizeof(SETUP_REPLY) - 1);
+		}
+		else
+		{
+			offset = static_cast<size_t>(reply - begin) + sizeof(SETUP_REPLY);
+			server.synced = true;
+		}
+	}
+
+	while (server.synced && offset != server.used)
+	{
+		const uint8_t* begin = reinterpret_cast<const uint8_t*>(server.buffer.data() + offset);
+		size_t available = server.used - offset;
+		uint64_t values[3];
+		size_t prefix = 0;
+		for (uint64_t& value : values)
+		{
+			size_t size = prefix < available ? MultiLibrary::Varint::Decode(begin + prefix, available - prefix, value) : 0;
+			if (size == 0)
+			{
+				prefix = 0;
+				break;
+			}
+
+			prefix += size;
+		}
+
+		if (prefix == 0)
+			break;
+
+		const char* record = reinterpret_cast<const char*>(begin) + prefix;
+		const char* end = reinterpret_cast<const char*>(begin) + available;
+		const char* eol = std::search(record, end, EOL_SEQUENCE, EOL_SEQUENCE + sizeof(EOL_SEQUENCE));
+		if (eol == end)
+			break;
+
+		size_t size = static_cast<size_t>(eol - record) + sizeof(EOL_SEQUENCE);
+		Hold(server.id, values[0], static_cast<uint32_t>(values[1]), values[2], record, size);
+		offset += prefix + size;
+	}
+
+	if (offset != 0)
+	{
+		std::memmove(server.buffer.data(), server.buffer.data() + offset, server.used - offset);
+		server.used -= offset;
+	}
+}
+
+// Returns false once the server is gone.
+static bool ServeServer(Server& server)
+{
+	while (true)
+	{
+		if (server.buffer.size() - server.used < READ_SIZE / 4)
+		{
+			if (server.buffer.size() >= MAX_SERVER_BUFFER)
+			{
+				// garbage or a record bigger than any the module writes
+				++totals.resyncs;
+				Setup(server);
+			}
+			else
+			{
+				server.buffer.resize(server.buffer.size() * 2);
+			}
+		}
+
+		ssize_t size = read(server.output, server.buffer.data() + server.used, server.buffer.size() - server.used);
+		if (size > 0)
+		{
+			server.used += static_cast<size_t>(size);
+			Parse(server);
+			continue;
+		}
+
+		// the module holds its end open, so the end of the pipe means it's gone
+		return size == -1 && (errno == EAGAIN || errno == EINTR);
+	}
+}
+
+static void ServeListener(int listener)
+{
+	int descriptor;
+	while ((descriptor = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1)
+	{
+		uint64_t tag = TAG_CLIENT | nextClient++;
+		clients[tag] = Client{descriptor, std::string(), false};
+		epoll_event event = {};
+		event.events = EPOLLRDHUP;
+		event.data.u64 = tag;
+		epoll_ctl(poller, EPOLL_CTL_ADD, descriptor, &event);
+	}
+}
+
+static void CloseClient(uint64_t tag)
+{
+	auto client = clients.find(tag);
+	if (client == clients.end())
+		return;
+
+	epoll_ctl(poller, EPOLL_CTL_DEL, client->second.descriptor, nullptr);
+	close(client->second.descriptor);
+	clients.erase(client);
+}
+
+// Writes what a client has pending, and only asks to hear about room when
+// some is left over.
+static bool FlushClient(uint64_t tag, Client& client)
+{
+	size_t written = 0;
+	while (written != client.pending.size())
+	{
+		ssize_t size = send(client.descriptor, client.pending.data() + written, client.pending.size() - written, MSG_NOSIGNAL);
+		if (size > 0)
+			written += static_cast<size_t>(size);
+		else if (size == -1 && errno == EINTR)
+			continue;
+		else if (size == -1 && errno == EAGAIN)
+			break;
+		else
+			return false;
+	}
+
+	client.pending.erase(0, written);
+	if (client.polling != !client.pending.empty())
+	{
+		client.polling = !client.pending.empty();
+		epoll_event event = {};
+		event.events = client.polling ? EPOLLRDHUP | EPOLLOUT : EPOLLRDHUP;
+		event.data.u64 = tag;
+		epoll_ctl(poller, EPOLL_CTL_MOD, client.descriptor, &event);
+	}
+
+	return true;
+}
+
+// Sends out the records that have been held for the whole window, and the
+// oldest ones past the backlog. Returns how long until the next one is due.
+static int Release()
+{
+	const uint64_t now = Now();
+	std::string batch;
+	std::vector<Held> released;
+	while (!held.empty())
+	{
+		const Held& record = held.top();
+		const bool due = record.timestamp + options.window <= now;
+		if (!due && heldBytes <= options.backlog)
+			break;
+
+		if (!due)
+			++totals.early;
+
+		if (record.timestamp < lastReleased)
+			++totals.late;
+		else
+			lastReleased = record.timestamp;
+
+		uint8_t prefix[4 * MultiLibrary::Varint::MaxSize];
+		size_t size = MultiLibrary::Varint::Encode(record.server, prefix);
+		size += MultiLibrary::Varint::Encode(record.sequence, prefix + size);
+		size += MultiLibrary::Varint::Encode(record.tick, prefix + size);
+		size += MultiLibrary::Varint::Encode(record.timestamp, prefix + size);
+		batch.append(reinterpret_cast<const char*>(prefix), size);
+		batch.append(record.data);
+
+		heldBytes -= record.data.size();
+		++totals.records;
+		totals.bytes += record.data.size();
+
+		// the priority queue only hands out const references to its elements,
+		// moving the data out leaves what it orders them by alone
+		released.push_back(std::move(const_cast<Held&>(record)));
+		held.pop();
+	}
+
+	if (!released.empty())
+	{
+		std::vector<uint64_t> gone;
+		for (auto& client : clients)
+		{
+			if (client.second.pending.size() + batch.size() > MAX_CLIENT_BUFFER)
+			{
+				totals.dropped += released.size();
+				continue;
+			}
+
+			client.second.pending.append(batch);
+			if (!FlushClient(client.first, client.second))
+				gone.push_back(client.first);
+		}
+
+		for (uint64_t tag : gone)
+			CloseClient(tag);
+
+		if (ring.IsOpen())
+		{
+			// ring records are the server id followed by the record, the rest
+			// goes in their header
+			std::vector<std::string> payloads(released.size());
+			std::vector<xconsole::EgressQueue::Entry> entries(released.size());
+			for (size_t k = 0; k < released.size(); ++k)
+			{
+				uint8_t id[MultiLibrary::Varint::MaxSize];
+				payloads[k].assign(reinterpret_cast<const char*>(id), MultiLibrary::Varint::Encode(released[k].server, id));
+				payloads[k].append(released[k].data);
+				entries[k] = {reinterpret_cast<const uint8_t*>(payloads[k].data()), payloads[k].size(), released[k].timestamp, released[k].sequence, released[k].tick, 0};
+			}
+
+			ring.Publish(entries.data(), entries.size());
+		}
+	}
+
+	if (held.empty())
+		return 1000;
+
+	uint64_t due = held.top().timestamp + options.window;
+	return due <= now ? 0 : static_cast<int>(std::min<uint64_t>((due - now + 999999) / 1000000, 1000));
+}
+
+static int Listen(const std::string& path)
+{
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path))
+		return -1;
+
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listener == -1)
+		return -1;
+
+	unlink(path.c_str());
+	if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 || listen(listener, 64) == -1)
+	{
+		close(listener);
+		return -1;
+	}
+
+	return listener;
+}
+
+int main(int argc, char** argv)
+{
+	if (!ParseOptions(argc, argv))
+	{
+		std::fprintf(stderr, "usage: %s [--socket PATH] [--shm N] [--ring NAME] [--window N] [--backlog N]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::signal(SIGINT, Stop);
+	std::signal(SIGTERM, Stop);
+	std::signal(SIGPIPE, SIG_IGN);
+
+	int listener = Listen(options.socketPath);
+	if (listener == -1)
+	{
+		std::fprintf(stderr, "failed to listen on %s\n", options.socketPath.c_str());
+		return EXIT_FAILURE;
+	}
+
+	const char* error = nullptr;
+	if (options.sharedMemory != 0 && !ring.Create(options.ringName.c_str(), options.sharedMemory, error))
+	{
+		std::fprintf(stderr, "%s\n", error);
+		return EXIT_FAILURE;
+	}
+
+	// same as the module does, the directory is shared by every user
+	if (mkdir(xconsole::endpoints::DISCOVERY_DIRECTORY, 01777) == 0)
+		chmod(xconsole::endpoints::DISCOVERY_DIRECTORY, 01777);
+
+	int discovery = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (discovery == -1 || inotify_add_watch(discovery, xconsole::endpoints::DISCOVERY_DIRECTORY, IN_MOVED_TO | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_DELETE) == -1)
+	{
+		std::fprintf(stderr, "failed to watch %s\n", xconsole::endpoints::DISCOVERY_DIRECTORY);
+		return EXIT_FAILURE;
+	}
+
+	poller = epoll_create1(EPOLL_CLOEXEC);
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.u64 = TAG_DISCOVERY;
+	epoll_ctl(poller, EPOLL_CTL_ADD, discovery, &event);
+	event.data.u64 = TAG_LISTENER;
+	epoll_ctl(poller, EPOLL_CTL_ADD, listener, &event);
+
+	std::printf("serving %s%s%s\n", options.socketPath.c_str(), ring.IsOpen() ? " and " : "", ring.IsOpen() ? options.ringName.c_str() : "");
+	Discover();
+
+	epoll_event events[MAX_EVENTS];
+	int timeout = 0;
+	while (running)
+	{
+		int count = epoll_wait(poller, events, MAX_EVENTS, timeout);
+		for (int k = 0; k < count; ++k)
+		{
+			const uint64_t tag = events[k].data.u64;
+			if (tag == TAG_DISCOVERY)
+				ServeDiscovery(discovery);
+			else if (tag == TAG_LISTENER)
+				ServeListener(listener);
+			else if ((tag & ~0xffffffffULL) == TAG_CLIENT)
+			{
+				auto client = clients.find(tag);
+				if (client == clients.end())
+					continue;
+
+				if ((events[k].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0 || !FlushClient(tag, client->second))
+					CloseClient(tag);
+			}
+			else
+			{
+				auto server = servers.find(static_cast<uint32_t>(tag));
+				if (server != servers.end() && !ServeServer(server->second))
+					Detach(server->second);
+			}
+		}
+
+		timeout = Release();
+	}
+
+	// whatever is still held goes out before leaving
+	options.window = 0;
+	Release();
+	for (auto& client : clients)
+		FlushClient(client.first, client.second);
+
+	std::printf("records %llu (%.1f MB), late %llu, released early %llu, dropped for slow clients %llu, resyncs %llu\n",
+		static_cast<unsigned long long>(totals.records), totals.bytes / 1e6, static_cast<unsigned long long>(totals.late),
+		static_cast<unsigned long long>(totals.early), static_cast<unsigned long long>(totals.dropped),
+		static_cast<unsigned long long>(totals.resyncs));
+
+	while (!servers.empty())
+		Detach(servers.begin()->second);
+
+	while (!clients.empty())
+		CloseClient(clients.begin()->first);
+
+	ring.Destroy();
+	close(poller);
+	close(discovery);
+	close(listener);
+	unlink(options.socketPath.c_str());
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
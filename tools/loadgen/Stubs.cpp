@@ -0,0 +1,121 @@
+// Minimal implementations of the engine interfaces xconsole talks to, so the
+// module core can run outside of srcds.
+
+#include "Stubs.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+static std::mutex listenersMutex;
+static std::vector<ILoggingListener*> listeners;
+static std::vector<CLoggingSystem::LoggingChannel_t> channels;
+
+static void RegisterChannel(const char* name, const Color& color)
+{
+	CLoggingSystem::LoggingChannel_t channel = {};
+	channel.m_ID = static_cast<LoggingChannelID_t>(channels.size());
+	channel.m_MinimumVerbosity = LS_MESSAGE;
+	channel.m_SpewColor = color;
+	std::snprintf(channel.m_Name, sizeof(channel.m_Name), "%s", name);
+	channels.push_back(channel);
+}
+
+namespace stub
+{
+
+void RegisterChannels()
+{
+	if (!channels.empty())
+		return;
+
+	RegisterChannel("General", Color(255, 255, 255));
+	RegisterChannel("Console", Color(255, 255, 255));
+	RegisterChannel("Developer", Color(200, 200, 200));
+	RegisterChannel("Lua", Color(137, 222, 255));
+	RegisterChannel("Physics", Color(255, 160, 0));
+	RegisterChannel("Networking", Color(130, 255, 130));
+}
+
+int ChannelCount()
+{
+	return static_cast<int>(channels.size());
+}
+
+void Log(LoggingChannelID_t channelID, LoggingSeverity_t severity, const char* message)
+{
+	LoggingContext_t context;
+	context.m_ChannelID = channelID;
+	context.m_Flags = static_cast<LoggingChannelFlags_t>(0);
+	context.m_Severity = severity;
+	context.m_Color = channels[channelID].m_SpewColor;
+
+	// listeners are only (un)registered while no producer is running, so
+	// unlike the engine this doesn't lock while dispatching
+	for (ILoggingListener* listener : listeners)
+		listener->Log(&context, message);
+}
+
+class EngineServer : public IVEngineServer
+{
+public:
+	void ServerCommand(const char*) override
+	{
+		commands.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	std::atomic<uint64_t> commands{0};
+};
+
+static EngineServer engineServer;
+
+IVEngineServer* GetEngineServer()
+{
+	return &engineServer;
+}
+
+uint64_t CommandCount()
+{
+	return engineServer.commands.load(std::memory_order_relaxed);
+}
+
+} // namespace stub
+
+const CLoggingSystem::LoggingChannel_t* LoggingSystem_GetChannel(LoggingChannelID_t channelID)
+{
+	return &channels[channelID];
+}
+
+LoggingChannelID_t LoggingSystem_FindChannel(const char* pChannelName)
+{
+	for (const CLoggingSystem::LoggingChannel_t& channel : channels)
+		if (std::strcmp(channel.m_Name, pChannelName) == 0)
+			return channel.m_ID;
+
+	return INVALID_LOGGING_CHANNEL_ID;
+}
+
+void LoggingSystem_PushLoggingState(bool, bool)
+{ }
+
+void LoggingSystem_PopLoggingState(bool)
+{ }
+
+void LoggingSystem_RegisterLoggingListener(ILoggingListener* pListener)
+{
+	std::lock_guard<std::mutex> lock(listenersMutex);
+	listeners.push_back(pListener);
+}
+
+void LoggingSystem_UnregisterLoggingListener(ILoggingListener* pListener)
+{
+	std::lock_guard<std::mutex> lock(listenersMutex);
+	for (auto it = listeners.begin(); it != listeners.end(); ++it)
+		if (*it == pListener)
+		{
+			listeners.erase(it);
+			break;
+		}
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <eiface.h>
+#include <logging.h>
+
+namespace stub
+{
+
+// Creates the fake engine logging channels, ids start at 0.
+void RegisterChannels();
+
+int ChannelCount();
+
+// Dispatches a message to every registered ILoggingListener, like the
+// engine's LoggingSystem_Log does.
+void Log(LoggingChannelID_t channelID, LoggingSeverity_t severity, const char* message);
+
+// Engine interface that only counts the commands it is asked to run.
+IVEngineServer* GetEngineServer();
+
+uint64_t CommandCount();
+
+} // namespace stub
\ No newline at end of file
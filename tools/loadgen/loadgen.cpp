@@ -0,0 +1,606 @@
+// Load generator for the xconsole module core. Runs the real listener and
+// console transport against stub engine interfaces, floods it from several
+// producer threads and reads everything back like a console would.
+//
+// usage: xconsole_loadgen [options]
+//   --threads N      producer threads (default 4)
+//   --rate N         records per second per thread, 0 for unlimited (default 10000)
+//   --duration N     seconds to produce for (default 10)
+//   --sizes LIST     message sizes as size:weight pairs (default 48:70,160:25,2048:4,16384:1)
+//   --shm N          also publish to a shared memory ring of N megabytes (default 0, off)
+//   --consumer NAME  read back from "pipe" or "shm" (default pipe), reading from
+//                    the shared memory ring turns the pipe output off
+//   --tickrate N     server ticks per second to simulate, 0 for none (default 66)
+//   --budget N       per-channel budget in records per second, 0 to not sample (default 0)
+//   --fragments N    log every record as N fragments, only the last ending the line (default 1)
+//   --compress on    ask for compressed blocks on the pipe and decompress them (default off)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <Compression.hpp>
+#include <Console.hpp>
+#include <Memory.hpp>
+#include <SharedRing.hpp>
+#include <Stats.hpp>
+#include <Ticks.hpp>
+#include <Varint.hpp>
+#include "Stubs.hpp"
+
+static const char* PIPE_NAME_OUT = "/tmp/garrysmod_console";
+static const char* PIPE_NAME_IN = "/tmp/garrysmod_console_in";
+static const char* SHARED_RING_NAME = "/garrysmod_console";
+static const char EOL_SEQUENCE[] = "<EOL>";
+
+struct Options
+{
+	int threads = 4;
+	uint64_t rate = 10000;
+	int duration = 10;
+	size_t sharedMemory = 0;
+	bool sharedMemoryConsumer = false;
+	int tickrate = 66;
+	double budget = 0;
+	int fragments = 1;
+	bool compress = false;
+	std::vector<std::pair<size_t, unsigned>> sizes = {{48, 70}, {160, 25}, {2048, 4}, {16384, 1}};
+};
+
+struct ProducerResult
+{
+	uint64_t produced = 0;
+	uint64_t bytes = 0;
+	std::vector<uint32_t> logNanoseconds;
+};
+
+struct ConsumerResult
+{
+	uint64_t received = 0;
+	uint64_t bytes = 0;
+	uint64_t malformed = 0;
+	uint64_t lapped = 0;
+	uint64_t moduleRecords = 0;
+	uint64_t blocks = 0;
+	uint64_t blockBytes = 0;
+	uint64_t blockRawBytes = 0;
+	uint64_t decompressNanoseconds = 0;
+	std::vector<uint32_t> latencyNanoseconds;
+	std::vector<uint32_t> errorLatencyNanoseconds;
+};
+
+static std::atomic<bool> producing(true);
+static std::atomic<bool> consuming(true);
+
+static uint64_t Now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static bool ParseSizes(const char* list, std::vector<std::pair<size_t, unsigned>>& sizes)
+{
+	sizes.clear();
+	std::string value(list);
+	size_t start = 0;
+	while (start < value.size())
+	{
+		size_t end = value.find(',', start);
+		if (end == std::string::npos)
+			end = value.size();
+
+		unsigned long size = 0, weight = 0;
+		if (std::sscanf(value.substr(start, end - start).c_str(), "%lu:%lu", &size, &weight) != 2 || size < 64 || weight == 0)
+			return false;
+
+		sizes.emplace_back(size, static_cast<unsigned>(weight));
+		start = end + 1;
+	}
+
+	return !sizes.empty();
+}
+
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const char* name = argv[i];
+		const char* value = argv[i + 1];
+		if (std::strcmp(name, "--threads") == 0)
+			options.threads = std::max(1, std::atoi(value));
+		else if (std::strcmp(name, "--rate") == 0)
+			options.rate = std::strtoull(value, nullptr, 10);
+		else if (std::strcmp(name, "--duration") == 0)
+			options.duration = std::max(1, std::atoi(value));
+		else if (std::strcmp(name, "--shm") == 0)
+			options.sharedMemory = std::strtoull(value, nullptr, 10) * 1024 * 1024;
+		else if (std::strcmp(name, "--budget") == 0)
+			options.budget = std::max(0.0, std::atof(value));
+		else if (std::strcmp(name, "--compress") == 0 && (std::strcmp(value, "on") == 0 || std::strcmp(value, "off") == 0))
+			options.compress = std::strcmp(value, "on") == 0;
+		else if (std::strcmp(name, "--fragments") == 0)
+			options.fragments = std::max(1, std::atoi(value));
+		else if (std::strcmp(name, "--tickrate") == 0)
+			options.tickrate = std::max(0, std::atoi(value));
+		else if (std::strcmp(name, "--consumer") == 0 && (std::strcmp(value, "pipe") == 0 || std::strcmp(value, "shm") == 0))
+			options.sharedMemoryConsumer = std::strcmp(value, "shm") == 0;
+		else if (std::strcmp(name, "--sizes") == 0)
+		{
+			if (!ParseSizes(value, options.sizes))
+			{
+				std::fprintf(stderr, "invalid --sizes, expected size:weight pairs with sizes of at least 64\n");
+				return false;
+			}
+		}
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", name);
+			return false;
+		}
+	}
+
+	return argc % 2 == 1;
+}
+
+static void Producer(const Options& options, int index, ProducerResult& result)
+{
+	std::mt19937 random(static_cast<unsigned>(index) * 7919 + 1);
+	std::vector<unsigned> weights;
+	for (const auto& size : options.sizes)
+		weights.push_back(size.second);
+
+	std::discrete_distribution<size_t> sizeDistribution(weights.begin(), weights.end());
+	std::uniform_int_distribution<int> channelDistribution(0, stub::ChannelCount() - 1);
+
+	std::string fragment;
+	std::string message;
+	message.reserve(options.sizes.size() != 0 ? std::max_element(options.sizes.begin(), options.sizes.end())->first + 1 : 0);
+
+	const uint64_t start = Now();
+	const uint64_t interval = options.rate != 0 ? 1000000000ULL / options.rate : 0;
+	uint64_t sequence = 0;
+	while (producing.load(std::memory_order_relaxed))
+	{
+		if (interval != 0)
+		{
+			uint64_t due = start + sequence * interval;
+			uint64_t now = Now();
+			if (due > now)
+				std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+		}
+
+		size_t size = options.sizes[sizeDistribution(random)].first;
+		uint64_t sent = Now();
+
+		// "loadgen <thread> <sequence> <timestamp> " then padding up to the size
+		char prefix[64];
+		int length = std::snprintf(prefix, sizeof(prefix), "loadgen %d %llu %llu ",
+			index, static_cast<unsigned long long>(sequence), static_cast<unsigned long long>(sent));
+		message.assign(prefix, static_cast<size_t>(length));
+		message.resize(size - 1, 'x');
+		message += '\n';
+
+		LoggingSeverity_t severity = sequence % 1000 == 0 ? LS_ERROR : sequence % 100 == 0 ? LS_WARNING : LS_MESSAGE;
+		// like a line printed with several Msg calls, only the last one with
+		// the newline
+		LoggingChannelID_t channel = channelDistribution(random);
+		uint64_t before = Now();
+		if (options.fragments == 1)
+			stub::Log(channel, severity, message.c_str());
+		else
+		{
+			size_t step = message.size() / options.fragments;
+			for (int k = 0; k < options.fragments; ++k)
+			{
+				size_t begin = k * step;
+				size_t end = k + 1 == options.fragments ? message.size() : begin + step;
+				fragment.assign(message, begin, end - begin);
+				stub::Log(channel, severity, fragment.c_str());
+			}
+		}
+		uint64_t after = Now();
+
+		result.logNanoseconds.push_back(static_cast<uint32_t>(std::min<uint64_t>(after - before, UINT32_MAX)));
+		result.bytes += message.size();
+		++result.produced;
+		++sequence;
+	}
+}
+
+// Decodes a record in the legacy layout, without its <EOL> terminator:
+// int32 channel, int32 severity, name\0, int32 colour, message\0
+// Records the module sends on its own (negative) channels are only counted.
+static void ConsumeRecord(const char* begin, const char* end, ConsumerResult& result)
+{
+	int32_t channel = 0;
+	int32_t severity = 0;
+	if (end - begin >= 8)
+	{
+		std::memcpy(&channel, begin, sizeof(channel));
+		std::memcpy(&severity, begin + 4, sizeof(severity));
+	}
+
+	if (channel < 0)
+	{
+		++result.moduleRecords;
+		return;
+	}
+
+	uint64_t received = Now();
+	const char* name = begin + 8;
+	const char* nameEnd = name < end ? static_cast<const char*>(std::memchr(name, '\0', end - name)) : nullptr;
+	const char* message = nameEnd != nullptr ? nameEnd + 1 + 4 : nullptr;
+	int thread = 0;
+	unsigned long long sequence = 0, sent = 0;
+	if (message != nullptr && message < end && std::sscanf(message, "loadgen %d %llu %llu ", &thread, &sequence, &sent) == 3 && sent <= received)
+	{
+		uint32_t latency = static_cast<uint32_t>(std::min<uint64_t>(received - sent, UINT32_MAX));
+		result.latencyNanoseconds.push_back(latency);
+		if (severity >= LS_ASSERT)
+			result.errorLatencyNanoseconds.push_back(latency);
+	}
+	else
+		++result.malformed;
+
+	++result.received;
+	result.bytes += static_cast<uint64_t>(end - begin) + sizeof(EOL_SEQUENCE);
+}
+
+// Whether a record is the reply of the module to a control request.
+static bool IsReply(const char* begin, const char* end, const char* reply)
+{
+	static const char prefix[] = "\xff\xff\xff\xff\0\0\0\0xconsole\0\0\0\0\0";
+	const size_t prefixSize = sizeof(prefix) - 1;
+	const size_t replySize = std::strlen(reply) + 1;
+	return static_cast<size_t>(end - begin) == prefixSize + replySize &&
+		std::memcmp(begin, prefix, prefixSize) == 0 &&
+		std::memcmp(begin + prefixSize, reply, replySize) == 0;
+}
+
+// Consumes the records of data, split on the <EOL>\0 terminator, and returns
+// how many bytes that took. Sets compressed once the module acknowledged
+// that it is switching to compressed blocks, the rest isn't records anymore.
+static size_t ConsumeRecords(const char* data, size_t size, bool& compressed, ConsumerResult& result)
+{
+	size_t offset = 0;
+	while (!compressed)
+	{
+		const char* begin = data + offset;
+		const char* end = data + size;
+		const char* eol = std::search(begin, end, EOL_SEQUENCE, EOL_SEQUENCE + sizeof(EOL_SEQUENCE));
+		if (eol == end)
+			break;
+
+		ConsumeRecord(begin, eol, result);
+		compressed = IsReply(begin, eol, "compress on\n");
+		offset = static_cast<size_t>(eol - data) + sizeof(EOL_SEQUENCE);
+	}
+
+	return offset;
+}
+
+// Decompresses the complete blocks of data, each a varint raw size, a varint
+// payload size and the payload, and consumes their records. Returns how
+// many bytes that took.
+static size_t ConsumeBlocks(const char* data, size_t size, ConsumerResult& result)
+{
+	static std::vector<char> raw;
+	size_t offset = 0;
+	while (offset != size)
+	{
+		const uint8_t* block = reinterpret_cast<const uint8_t*>(data + offset);
+		uint64_t rawSize = 0, payloadSize = 0;
+		size_t header = MultiLibrary::Varint::Decode(block, size - offset, rawSize);
+		size_t payloadHeader = header != 0 ? MultiLibrary::Varint::Decode(block + header, size - offset - header, payloadSize) : 0;
+		if (payloadHeader == 0 || size - offset - header - payloadHeader < payloadSize)
+			break;
+
+		header += payloadHeader;
+		raw.resize(static_cast<size_t>(rawSize));
+		uint64_t start = Now();
+		if (payloadSize == rawSize)
+			std::memcpy(raw.data(), block + header, static_cast<size_t>(rawSize));
+		else if (!xconsole::compression::Decompress(block + header, static_cast<size_t>(payloadSize), reinterpret_cast<uint8_t*>(raw.data()), raw.size()))
+			++result.malformed;
+
+		result.decompressNanoseconds += Now() - start;
+		++result.blocks;
+		result.blockBytes += header + payloadSize;
+		result.blockRawBytes += rawSize;
+
+		// blocks hold whole records, anything left over is garbage
+		bool compressed = false;
+		if (ConsumeRecords(raw.data(), raw.size(), compressed, result) != raw.size())
+			++result.malformed;
+
+		offset += static_cast<size_t>(header + payloadSize);
+	}
+
+	return offset;
+}
+
+// Reads the pipe stream, switching to compressed blocks when asked to.
+static void PipeConsumer(int pipe, ConsumerResult& result)
+{
+	bool compressed = false;
+	std::vector<char> buffer(1 << 20);
+	size_t used = 0;
+	uint64_t idleSince = Now();
+	while (true)
+	{
+		pollfd descriptor = {pipe, POLLIN, 0};
+		if (poll(&descriptor, 1, 50) > 0)
+		{
+			if (used == buffer.size())
+				buffer.resize(buffer.size() * 2);
+
+			ssize_t bytesRead = read(pipe, buffer.data() + used, buffer.size() - used);
+			if (bytesRead > 0)
+			{
+				used += static_cast<size_t>(bytesRead);
+				idleSince = Now();
+			}
+		}
+		else if (!consuming.load(std::memory_order_relaxed) && Now() - idleSince > 500000000ULL)
+		{
+			break;
+		}
+
+		size_t offset = ConsumeRecords(buffer.data(), used, compressed, result);
+		if (compressed)
+			offset += ConsumeBlocks(buffer.data() + offset, used - offset, result);
+
+		if (offset != 0)
+		{
+			std::memmove(buffer.data(), buffer.data() + offset, used - offset);
+			used -= offset;
+		}
+	}
+}
+
+// Follows the shared memory ring like an out of process reader would, see
+// SharedRingHeader for the protocol.
+static void SharedRingConsumer(ConsumerResult& result)
+{
+	int descriptor = shm_open(SHARED_RING_NAME, O_RDONLY, 0);
+	struct stat information;
+	if (descriptor == -1 || fstat(descriptor, &information) == -1)
+	{
+		std::fprintf(stderr, "failed to open shared memory ring %s\n", SHARED_RING_NAME);
+		return;
+	}
+
+	size_t regionSize = static_cast<size_t>(information.st_size);
+	void* region = mmap(nullptr, regionSize, PROT_READ, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if (region == MAP_FAILED)
+	{
+		std::fprintf(stderr, "failed to map shared memory ring %s\n", SHARED_RING_NAME);
+		return;
+	}
+
+	const xconsole::SharedRingHeader* header = static_cast<const xconsole::SharedRingHeader*>(region);
+	const uint8_t* data = static_cast<const uint8_t*>(region) + xconsole::SHARED_RING_DATA_OFFSET;
+	const uint64_t capacity = header->capacity;
+	uint64_t position = header->committed.load(std::memory_order_acquire);
+	uint64_t idleSince = Now();
+	std::vector<char> record;
+	while (true)
+	{
+		uint64_t committed = header->committed.load(std::memory_order_acquire);
+		if (position == committed)
+		{
+			if (!consuming.load(std::memory_order_relaxed) && Now() - idleSince > 500000000ULL)
+				break;
+
+#ifdef __linux__
+			uint32_t value = header->futex.load(std::memory_order_acquire);
+			if (header->committed.load(std::memory_order_acquire) == position)
+			{
+				timespec timeout = {0, 50000000};
+				syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&header->futex), FUTEX_WAIT, value, &timeout, nullptr, 0);
+			}
+#else
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+			continue;
+		}
+
+		idleSince = Now();
+		while (position < committed)
+		{
+			size_t offset = static_cast<size_t>(position & (capacity - 1));
+			size_t remaining = static_cast<size_t>(capacity) - offset;
+			xconsole::SharedRingRecord entry;
+			std::memcpy(&entry, data + offset, sizeof(entry));
+			if (remaining < sizeof(entry) || (entry.flags & xconsole::SHARED_RING_FLAG_PAD) != 0)
+			{
+				position += remaining;
+				continue;
+			}
+
+			bool sane = entry.size + entry.spans <= remaining - sizeof(entry);
+			if (sane)
+				record.assign(data + offset + sizeof(entry), data + offset + sizeof(entry) + entry.size);
+
+			// anything the producer reserved past a full lap may have changed under us
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (!sane || header->reserved.load(std::memory_order_relaxed) > position + capacity)
+			{
+				++result.lapped;
+				position = header->committed.load(std::memory_order_acquire);
+				break;
+			}
+
+			if (record.size() >= sizeof(EOL_SEQUENCE))
+				ConsumeRecord(record.data(), record.data() + record.size() - sizeof(EOL_SEQUENCE), result);
+
+			position += sizeof(entry) + ((entry.size + entry.spans + 7) & ~7u);
+		}
+	}
+
+	munmap(region, regionSize);
+}
+
+static void PrintPercentiles(const char* name, std::vector<uint32_t>& samples)
+{
+	if (samples.empty())
+	{
+		std::printf("%-22s no samples\n", name);
+		return;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	auto percentile = [&samples](double fraction) {
+		size_t index = static_cast<size_t>(fraction * (samples.size() - 1));
+		return samples[index] / 1000.0;
+	};
+
+	std::printf("%-22s p50 %9.1f us  p99 %9.1f us  p999 %9.1f us  max %9.1f us\n",
+		name, percentile(0.5), percentile(0.99), percentile(0.999), samples.back() / 1000.0);
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		std::fprintf(stderr, "usage: %s [--threads N] [--rate N] [--duration N] [--sizes size:weight,...] [--shm N] [--consumer pipe|shm] [--tickrate N] [--budget N] [--fragments N] [--compress on|off]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	stub::RegisterChannels();
+
+	if (options.sharedMemoryConsumer && options.sharedMemory == 0)
+		options.sharedMemory = 16 * 1024 * 1024;
+
+	xconsole::Options moduleOptions;
+	moduleOptions.sharedMemorySize = options.sharedMemory;
+	moduleOptions.pipeOutput = !options.sharedMemoryConsumer;
+	moduleOptions.channelBudget = options.budget;
+	moduleOptions.channelBurst = options.budget * 2;
+
+	const char* error = nullptr;
+	if (!xconsole::Initialize(stub::GetEngineServer(), moduleOptions, error))
+	{
+		std::fprintf(stderr, "xconsole failed to initialize: %s\n", error);
+		xconsole::Shutdown();
+		return EXIT_FAILURE;
+	}
+
+	int pipe = open(PIPE_NAME_OUT, O_RDONLY | O_NONBLOCK);
+	if (pipe == -1)
+	{
+		std::fprintf(stderr, "failed to open %s\n", PIPE_NAME_OUT);
+		xconsole::Shutdown();
+		return EXIT_FAILURE;
+	}
+
+	if (options.compress)
+	{
+		static const char request[] = "\x01" "compress on<EOL>";
+		int input = open(PIPE_NAME_IN, O_WRONLY | O_NONBLOCK);
+		if (input == -1 || write(input, request, sizeof(request) - 1) != static_cast<ssize_t>(sizeof(request) - 1))
+			std::fprintf(stderr, "failed to ask for compression on %s\n", PIPE_NAME_IN);
+
+		if (input != -1)
+			close(input);
+	}
+
+	ConsumerResult consumed;
+	std::thread consumer;
+	if (options.sharedMemoryConsumer)
+		consumer = std::thread(SharedRingConsumer, std::ref(consumed));
+	else
+		consumer = std::thread(PipeConsumer, pipe, std::ref(consumed));
+
+	// stands in for the game thread
+	std::thread ticker([&options] {
+		uint32_t tick = 0;
+		while (options.tickrate != 0 && producing.load(std::memory_order_relaxed))
+		{
+			xconsole::Tick(++tick);
+			std::this_thread::sleep_for(std::chrono::microseconds(1000000 / options.tickrate));
+		}
+	});
+
+	std::vector<ProducerResult> produced(static_cast<size_t>(options.threads));
+	std::vector<std::thread> producers;
+	uint64_t start = Now();
+	for (int i = 0; i < options.threads; ++i)
+		producers.emplace_back(Producer, std::cref(options), i, std::ref(produced[static_cast<size_t>(i)]));
+
+	std::this_thread::sleep_for(std::chrono::seconds(options.duration));
+	producing = false;
+	for (std::thread& producer : producers)
+		producer.join();
+
+	ticker.join();
+
+	double elapsed = (Now() - start) / 1e9;
+	consuming = false;
+	consumer.join();
+
+	xconsole::Shutdown();
+	close(pipe);
+
+	ProducerResult total;
+	for (ProducerResult& result : produced)
+	{
+		total.produced += result.produced;
+		total.bytes += result.bytes;
+		total.logNanoseconds.insert(total.logNanoseconds.end(), result.logNanoseconds.begin(), result.logNanoseconds.end());
+	}
+
+	uint64_t dropped = total.produced > consumed.received ? total.produced - consumed.received : 0;
+	std::printf("producers %d, rate %llu/s each, %.1f s\n", options.threads, static_cast<unsigned long long>(options.rate), elapsed);
+	std::printf("produced %llu records (%.1f MB), %.0f records/s\n",
+		static_cast<unsigned long long>(total.produced), total.bytes / 1e6, total.produced / elapsed);
+	std::printf("received %llu records (%.1f MB on the wire), %.0f records/s, %.1f MB/s\n",
+		static_cast<unsigned long long>(consumed.received), consumed.bytes / 1e6, consumed.received / elapsed, consumed.bytes / 1e6 / elapsed);
+	std::printf("dropped %llu (%.3f%%), malformed %llu, lapped %llu\n", static_cast<unsigned long long>(dropped),
+		total.produced != 0 ? 100.0 * dropped / total.produced : 0.0, static_cast<unsigned long long>(consumed.malformed),
+		static_cast<unsigned long long>(consumed.lapped));
+	std::printf("module records %llu, hitches %llu\n", static_cast<unsigned long long>(consumed.moduleRecords),
+		static_cast<unsigned long long>(xconsole::ticks::GetHitchCount()));
+
+	if (consumed.blocks != 0)
+	{
+		uint64_t compressIn = xconsole::stats::Get(xconsole::stats::COUNTER_COMPRESS_IN);
+		uint64_t compressTime = xconsole::stats::Get(xconsole::stats::COUNTER_COMPRESS_NS);
+		std::printf("compressed blocks %llu, %.1f MB into %.1f MB on the wire, ratio %.2f\n",
+			static_cast<unsigned long long>(consumed.blocks), consumed.blockRawBytes / 1e6, consumed.blockBytes / 1e6,
+			consumed.blockBytes != 0 ? static_cast<double>(consumed.blockRawBytes) / consumed.blockBytes : 0.0);
+		std::printf("compression %.0f MB/s, decompression %.0f MB/s\n",
+			compressTime != 0 ? compressIn / 1e6 / (compressTime / 1e9) : 0.0,
+			consumed.decompressNanoseconds != 0 ? consumed.blockRawBytes / 1e6 / (consumed.decompressNanoseconds / 1e9) : 0.0);
+	}
+
+	PrintPercentiles("time in Log()", total.logNanoseconds);
+	PrintPercentiles("end to end latency", consumed.latencyNanoseconds);
+	PrintPercentiles("  errors only", consumed.errorLatencyNanoseconds);
+
+	std::string stats;
+	xconsole::stats::Format(stats);
+	xconsole::memory::Format(stats);
+	std::printf("\nmodule stats:\n%s", stats.c_str());
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,6 @@
+// Stand-in for garrysmod_common's Platform.hpp, the load generator always
+// emulates the x86-64 LoggingSystem API.
+#pragma once
+
+#define ARCHITECTURE_IS_X86_64 1
+#define ARCHITECTURE_IS_X86 0
\ No newline at end of file
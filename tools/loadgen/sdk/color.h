@@ -0,0 +1,20 @@
+// Stand-in for the Source SDK Color class, same memory layout.
+#pragma once
+
+class Color
+{
+public:
+	Color() : _color{255, 255, 255, 255} {}
+	Color(int r, int g, int b, int a = 255) :
+		_color{static_cast<unsigned char>(r), static_cast<unsigned char>(g), static_cast<unsigned char>(b), static_cast<unsigned char>(a)} {}
+
+	int r() const { return _color[0]; }
+	int g() const { return _color[1]; }
+	int b() const { return _color[2]; }
+	int a() const { return _color[3]; }
+
+	int GetRawColor() const { return _color[0] | _color[1] << 8 | _color[2] << 16 | _color[3] << 24; }
+
+private:
+	unsigned char _color[4];
+};
\ No newline at end of file
@@ -0,0 +1,11 @@
+// Stand-in for the subset of IVEngineServer (public/eiface.h) used by
+// xconsole. Implemented by the load generator.
+#pragma once
+
+#define INTERFACEVERSION_VENGINESERVER "VEngineServer021"
+
+class IVEngineServer
+{
+public:
+	virtual void ServerCommand(const char* str) = 0;
+};
\ No newline at end of file
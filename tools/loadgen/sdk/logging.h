@@ -0,0 +1,58 @@
+// Stand-in for the subset of the Source SDK logging system (tier0/logging.h)
+// used by xconsole. Implemented by the load generator.
+#pragma once
+
+#include <color.h>
+
+typedef int LoggingChannelID_t;
+
+const LoggingChannelID_t INVALID_LOGGING_CHANNEL_ID = -1;
+
+enum LoggingSeverity_t
+{
+	LS_MESSAGE = 0,
+	LS_WARNING = 1,
+	LS_ASSERT = 2,
+	LS_ERROR = 3,
+	LS_HIGHEST_SEVERITY = 4
+};
+
+enum LoggingChannelFlags_t
+{
+	LCF_CONSOLE_ONLY = 0x00000001,
+	LCF_DO_NOT_ECHO = 0x00000002
+};
+
+struct LoggingContext_t
+{
+	LoggingChannelID_t m_ChannelID;
+	LoggingChannelFlags_t m_Flags;
+	LoggingSeverity_t m_Severity;
+	Color m_Color;
+};
+
+class ILoggingListener
+{
+public:
+	virtual void Log(const LoggingContext_t* pContext, const char* pMessage) = 0;
+};
+
+class CLoggingSystem
+{
+public:
+	struct LoggingChannel_t
+	{
+		LoggingChannelID_t m_ID;
+		LoggingChannelFlags_t m_Flags;
+		LoggingSeverity_t m_MinimumVerbosity;
+		Color m_SpewColor;
+		char m_Name[64];
+	};
+};
+
+const CLoggingSystem::LoggingChannel_t* LoggingSystem_GetChannel(LoggingChannelID_t channelID);
+LoggingChannelID_t LoggingSystem_FindChannel(const char* pChannelName);
+void LoggingSystem_PushLoggingState(bool bThreadLocal = false, bool bClearState = true);
+void LoggingSystem_PopLoggingState(bool bThreadLocal = false);
+void LoggingSystem_RegisterLoggingListener(ILoggingListener* pListener);
+void LoggingSystem_UnregisterLoggingListener(ILoggingListener* pListener);
\ No newline at end of file
@@ -0,0 +1,5 @@
+// Stand-in for tier0/dbg.h, the x86-64 logging path doesn't use anything
+// from it.
+#pragma once
+
+#include <color.h>
\ No newline at end of file
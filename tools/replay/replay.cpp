@@ -0,0 +1,437 @@
+// Replays a capture made with -xconsole_capture or "\x01capture <name>"
+// against a server, for load testing. Commands are written to the input
+// pipe of the server in the order and with the spacing they were received
+// in, or that many times faster, and the tool reports how long they took to
+// reach the game thread and how much longer ticks got meanwhile.
+//
+// After each command (or each N with --probe) the tool asks for
+// "\x01status replay:<n>", which the game thread answers at the next tick,
+// along with the commands that came in since the last one. The latency is
+// from writing the command to the timestamp of that answer, both on the
+// steady clock. Tick telemetry is turned on for the run and off at the end,
+// and ticks are measured for a while before replaying as a baseline.
+//
+// The tool reads the output pipe of the server, so it takes the place of
+// any console reading it. Requests in the capture that would change the
+// output stream (format, compress, filter, ticks and capture) are skipped.
+//
+// usage: xconsole_replay [options] CAPTURE
+//   --endpoint NAME  endpoint name of the server (default garrysmod_console)
+//   --speed N        replays N times faster than captured, 0 sends every
+//                    command as fast as the server takes them (default 1)
+//   --client N       only replays the commands of client N
+//   --probe N        measures the latency of every Nth command (default 1)
+//   --baseline N     seconds of ticks measured before replaying (default 2)
+//   --drain N        seconds to wait for the last answers (default 2)
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <Capture.hpp>
+#include <Endpoints.hpp>
+#include <xconsole/Client.hpp>
+
+static const char EOL_SEQUENCE[] = "<EOL>";
+
+// what the server is asked for before replaying, anything it sent before the
+// format 5 reply is skipped
+static const char SETUP_REQUEST[] = "\x01" "compress off<EOL>" "\x01" "filter<EOL>" "\x01" "format 5<EOL>" "\x01" "ticks on<EOL>";
+static const char SETUP_REPLY[] = "\xff\xff\xff\xff\0\0\0\0xconsole\0\0\0\0\0format 5\n\0<EOL>";
+static const char TEARDOWN_REQUEST[] = "\x01" "ticks off<EOL>";
+
+static const char STATUS_EVENT_NAME[] = "xconsole_status";
+static const char PROBE_PREFIX[] = "replay:";
+
+// requests that would change what the tool reads
+static const char* const SKIPPED_REQUESTS[] = {"\x01" "format", "\x01" "compress", "\x01" "filter", "\x01" "ticks", "\x01" "capture"};
+
+static const size_t MAX_RECORDS = 256;
+static const int POLL_INTERVAL = 10;
+static const uint64_t SETUP_TIMEOUT = 5000000000;
+
+struct Options
+{
+	std::string endpoint = xconsole::endpoints::DEFAULT_NAME;
+	std::string capture;
+	double speed = 1;
+	int64_t client = -1;
+	uint64_t probe = 1;
+	uint64_t baseline = 2000000000;
+	uint64_t drain = 2000000000;
+};
+
+// Command, with the probe after it when it has one, as written in one go.
+struct Unit
+{
+	uint64_t due;
+	uint64_t probe; // 0 for none
+	std::string data;
+};
+
+enum Phase
+{
+	PHASE_SYNC,
+	PHASE_BASELINE,
+	PHASE_REPLAY,
+	PHASE_DRAIN
+};
+
+static Options options;
+static std::map<uint64_t, uint64_t> probes; // sent at, by probe
+static std::vector<uint64_t> latencies;
+static std::vector<uint64_t> baselineTicks;
+static std::vector<uint64_t> replayTicks;
+static uint64_t baselineHitches = 0;
+static uint64_t replayHitches = 0;
+static Phase phase = PHASE_SYNC;
+
+static uint64_t Now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static bool ParseOptions(int argc, char** argv)
+{
+	int i = 1;
+	for (; i + 1 < argc; i += 2)
+	{
+		const char* name = argv[i];
+		const char* value = argv[i + 1];
+		if (std::strcmp(name, "--endpoint") == 0)
+			options.endpoint = value;
+		else if (std::strcmp(name, "--speed") == 0)
+			options.speed = std::max(0.0, std::strtod(value, nullptr));
+		else if (std::strcmp(name, "--client") == 0)
+			options.client = std::strtoll(value, nullptr, 10);
+		else if (std::strcmp(name, "--probe") == 0)
+			options.probe = std::strtoull(value, nullptr, 10);
+		else if (std::strcmp(name, "--baseline") == 0)
+			options.baseline = std::strtoull(value, nullptr, 10) * 1000000000;
+		else if (std::strcmp(name, "--drain") == 0)
+			options.drain = std::strtoull(value, nullptr, 10) * 1000000000;
+		else if (name[0] == '-' && name[1] == '-')
+		{
+			std::fprintf(stderr, "unknown option %s\n", name);
+			return false;
+		}
+		else
+			break;
+	}
+
+	if (i + 1 != argc)
+		return false;
+
+	options.capture = argv[i];
+	return true;
+}
+
+static bool IsSkipped(const std::string& command)
+{
+	for (const char* request : SKIPPED_REQUESTS)
+		if (command.rfind(request, 0) == 0)
+			return true;
+
+	return false;
+}
+
+// Turns the capture into what gets written, due relative to the start of
+// the replay.
+static bool Load(std::vector<Unit>& units, uint64_t& skipped, uint64_t& span, std::set<uint32_t>& clients)
+{
+	xconsole::capture::Reader reader;
+	if (!reader.Open(options.capture.c_str()))
+		return false;
+
+	xconsole::capture::Command command;
+	uint64_t first = 0;
+	uint64_t count = 0;
+	while (reader.Next(command))
+	{
+		if (options.client >= 0 && command.client != static_cast<uint64_t>(options.client))
+			continue;
+
+		if (IsSkipped(command.text))
+		{
+			++skipped;
+			continue;
+		}
+
+		if (units.empty())
+			first = command.timestamp;
+
+		clients.insert(command.client);
+		span = command.timestamp - first;
+
+		Unit unit;
+		unit.due = options.speed == 0 ? 0 : static_cast<uint64_t>(static_cast<double>(command.timestamp - first) / options.speed);
+		unit.probe = options.probe != 0 && ++count % options.probe == 0 ? count : 0;
+		unit.data = command.text + EOL_SEQUENCE;
+		if (unit.probe != 0)
+			unit.data += "\x01" "status " + std::string(PROBE_PREFIX) + std::to_string(unit.probe) + EOL_SEQUENCE;
+
+		units.push_back(std::move(unit));
+	}
+
+	return true;
+}
+
+static void HandleStatus(const xconsole::client::Record& record)
+{
+	xconsole::client::FieldReader fields(record.payload);
+	xconsole::client::Value key;
+	xconsole::client::Value value;
+	if (!fields.Next(key, value) || key.string != "id" || value.type != xconsole::client::VALUE_STRING || value.string.rfind(PROBE_PREFIX, 0) != 0)
+		return;
+
+	uint64_t probe = std::strtoull(std::string(value.string.substr(sizeof(PROBE_PREFIX) - 1)).c_str(), nullptr, 10);
+	auto sent = probes.find(probe);
+	if (sent == probes.end())
+		return;
+
+	latencies.push_back(record.timestamp > sent->second ? record.timestamp - sent->second : 0);
+	probes.erase(sent);
+}
+
+static void HandleTick(const xconsole::client::Record& record)
+{
+	unsigned int tick;
+	unsigned long long duration;
+	int hitch = 0;
+	std::string message(record.message);
+	if (std::sscanf(message.c_str(), "tick=%u frame_ns=%llu", &tick, &duration) != 2)
+		return;
+
+	const char* flag = std::strstr(message.c_str(), "hitch=");
+	if (flag != nullptr)
+		hitch = std::atoi(flag + 6);
+
+	if (phase == PHASE_BASELINE)
+	{
+		baselineTicks.push_back(duration);
+		baselineHitches += hitch;
+	}
+	else if (phase != PHASE_SYNC)
+	{
+		replayTicks.push_back(duration);
+		replayHitches += hitch;
+	}
+}
+
+// Reads what the server sent, skipping up to the reply to the setup first.
+static bool ReadOutput(int output, std::string& skipped, xconsole::client::Decoder& decoder)
+{
+	if (phase == PHASE_SYNC)
+	{
+		char buffer[4096];
+		ssize_t result = read(output, buffer, sizeof(buffer));
+		if (result <= 0)
+			return result == 0 || errno == EAGAIN;
+
+		skipped.append(buffer, static_cast<size_t>(result));
+		size_t found = skipped.find(std::string(SETUP_REPLY, sizeof(SETUP_REPLY)));
+		if (found == std::string::npos)
+		{
+			// keep what could be the start of the reply
+			if (skipped.size() > sizeof(SETUP_REPLY))
+				skipped.erase(0, skipped.size() - sizeof(SETUP_REPLY));
+
+			return true;
+		}
+
+		size_t rest = skipped.size() - found - sizeof(SETUP_REPLY);
+		size_t room;
+		char* target = decoder.Prepare(room);
+		std::memcpy(target, skipped.data() + found + sizeof(SETUP_REPLY), rest);
+		decoder.Commit(rest);
+		phase = PHASE_BASELINE;
+	}
+	else if (decoder.Read(output) < 0 && errno != EAGAIN)
+	{
+		return false;
+	}
+
+	xconsole::client::Record records[MAX_RECORDS];
+	for (size_t count; (count = decoder.Decode(records, MAX_RECORDS)) != 0; )
+		for (size_t k = 0; k < count; ++k)
+		{
+			if (records[k].channel == xconsole::client::EVENT_CHANNEL && records[k].name == STATUS_EVENT_NAME)
+				HandleStatus(records[k]);
+			else if (records[k].channel == xconsole::client::TICK_CHANNEL)
+				HandleTick(records[k]);
+		}
+
+	return true;
+}
+
+static double Percentile(std::vector<uint64_t>& values, double percentile)
+{
+	if (values.empty())
+		return 0;
+
+	std::sort(values.begin(), values.end());
+	size_t index = static_cast<size_t>(percentile * static_cast<double>(values.size() - 1) + 0.5);
+	return static_cast<double>(values[index]) / 1000000.0;
+}
+
+static void PrintTicks(const char* name, std::vector<uint64_t>& ticks, uint64_t hitches)
+{
+	std::printf("%s ticks: %zu, frame ms p50 %.3f p99 %.3f max %.3f, hitches %llu\n",
+		name,
+		ticks.size(),
+		Percentile(ticks, 0.5),
+		Percentile(ticks, 0.99),
+		Percentile(ticks, 1),
+		static_cast<unsigned long long>(hitches));
+}
+
+int main(int argc, char** argv)
+{
+	if (!ParseOptions(argc, argv))
+	{
+		std::fprintf(stderr, "usage: %s [--endpoint NAME] [--speed N] [--client N] [--probe N] [--baseline N] [--drain N] CAPTURE\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<Unit> units;
+	uint64_t skipped = 0;
+	uint64_t span = 0;
+	std::set<uint32_t> clients;
+	if (!Load(units, skipped, span, clients))
+	{
+		std::fprintf(stderr, "failed to read capture %s\n", options.capture.c_str());
+		return EXIT_FAILURE;
+	}
+
+	xconsole::endpoints::Endpoints endpoints = xconsole::endpoints::Resolve(options.endpoint);
+	int output = open(endpoints.output.c_str(), O_RDONLY | O_NONBLOCK);
+	int input = open(endpoints.input.c_str(), O_WRONLY | O_NONBLOCK);
+	if (output == -1 || input == -1)
+	{
+		std::fprintf(stderr, "failed to open the pipes of %s, is the server running?\n", options.endpoint.c_str());
+		return EXIT_FAILURE;
+	}
+
+	std::printf("replaying %zu commands from %zu clients (%llu skipped) at speed %g\n", units.size(), clients.size(), static_cast<unsigned long long>(skipped), options.speed);
+
+	std::string pending(SETUP_REQUEST, sizeof(SETUP_REQUEST) - 1);
+	std::string skippedOutput;
+	xconsole::client::Decoder decoder(5);
+	const uint64_t launched = Now();
+	uint64_t baselineEnd = 0;
+	uint64_t start = 0;
+	uint64_t finished = 0;
+	uint64_t behind = 0;
+	size_t next = 0;
+	size_t written = 0;
+	while (true)
+	{
+		const uint64_t now = Now();
+		if (phase == PHASE_SYNC && now - launched >= SETUP_TIMEOUT)
+		{
+			std::fprintf(stderr, "no reply from the server\n");
+			return EXIT_FAILURE;
+		}
+
+		if (phase == PHASE_BASELINE && baselineEnd == 0)
+			baselineEnd = now + options.baseline;
+
+		if (phase == PHASE_BASELINE && now >= baselineEnd)
+		{
+			phase = PHASE_REPLAY;
+			start = now;
+		}
+
+		// queues what is due, written as units so a probe never gets split
+		// from its command by another console writing at the same time
+		if (phase == PHASE_REPLAY && pending.empty() && next < units.size() && start + units[next].due <= now)
+		{
+			behind = std::max(behind, now - start - units[next].due);
+			pending = units[next].data;
+			written = 0;
+		}
+
+		if (phase == PHASE_REPLAY && pending.empty() && next == units.size())
+		{
+			phase = PHASE_DRAIN;
+			finished = now;
+		}
+
+		if (phase == PHASE_DRAIN && (probes.empty() || now - finished >= options.drain))
+			break;
+
+		pollfd descriptors[2] = {{output, POLLIN, 0}, {input, static_cast<short>(pending.empty() ? 0 : POLLOUT), 0}};
+		int timeout = POLL_INTERVAL;
+		if (phase == PHASE_REPLAY && pending.empty() && next < units.size() && start + units[next].due > now)
+			timeout = static_cast<int>(std::min<uint64_t>(POLL_INTERVAL, (start + units[next].due - now) / 1000000));
+
+		poll(descriptors, 2, timeout);
+		if (!ReadOutput(output, skippedOutput, decoder))
+		{
+			std::fprintf(stderr, "failed to read from the server\n");
+			return EXIT_FAILURE;
+		}
+
+		if (pending.empty())
+			continue;
+
+		// up to PIPE_BUF bytes a write goes through whole or not at all
+		ssize_t result = write(input, pending.data() + written, std::min<size_t>(pending.size() - written, PIPE_BUF));
+		if (result < 0 && errno != EAGAIN)
+		{
+			std::fprintf(stderr, "failed to write to the server\n");
+			return EXIT_FAILURE;
+		}
+
+		written += result > 0 ? static_cast<size_t>(result) : 0;
+		if (written != pending.size())
+			continue;
+
+		if (phase == PHASE_REPLAY)
+		{
+			if (units[next].probe != 0)
+				probes[units[next].probe] = Now();
+
+			++next;
+		}
+
+		pending.clear();
+		written = 0;
+	}
+
+	if (write(input, TEARDOWN_REQUEST, sizeof(TEARDOWN_REQUEST) - 1) < 0)
+		std::fprintf(stderr, "failed to turn tick telemetry off\n");
+
+	const uint64_t elapsed = finished - start;
+	std::printf("sent %zu commands in %.3f s (the capture spans %.3f s), at most %.3f ms behind schedule\n",
+		units.size(),
+		static_cast<double>(elapsed) / 1e9,
+		static_cast<double>(span) / 1e9,
+		static_cast<double>(behind) / 1e6);
+
+	size_t answered = latencies.size();
+	std::printf("latency to the game thread: %zu of %zu probes answered, ms p50 %.3f p90 %.3f p99 %.3f max %.3f\n",
+		answered,
+		answered + probes.size(),
+		Percentile(latencies, 0.5),
+		Percentile(latencies, 0.9),
+		Percentile(latencies, 0.99),
+		Percentile(latencies, 1));
+
+	PrintTicks("baseline", baselineTicks, baselineHitches);
+	PrintTicks("replay", replayTicks, replayHitches);
+	return EXIT_SUCCESS;
+}
\ No newline at end of file